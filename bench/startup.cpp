@@ -0,0 +1,171 @@
+#include "numbers.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <optional>
+#include <spawn.h>
+#include <string>
+#include <string_view>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Measures what users wait for when the editor opens: the time from
+// spawning the server to reading its answer to `initialize`.
+//
+//   startup-benchmark [--runs=N] SERVER [SERVER ARGS..]
+
+extern char **environ;
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+constexpr std::string_view INITIALIZE =
+    R"({"jsonrpc":"2.0","id":1,"method":"initialize",)"
+    R"("params":{"processId":null,"rootUri":null,"capabilities":{}}})";
+constexpr std::string_view SHUTDOWN =
+    R"({"jsonrpc":"2.0","id":2,"method":"shutdown"})";
+constexpr std::string_view EXIT = R"({"jsonrpc":"2.0","method":"exit"})";
+
+bool write_message(int fd, std::string_view content) {
+  auto const message =
+      fmt::format("Content-Length: {}\r\n\r\n{}", content.size(), content);
+  std::string_view rest(message);
+  while (!rest.empty()) {
+    auto const count = ::write(fd, rest.data(), rest.size());
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    rest.remove_prefix(static_cast<u64>(count));
+  }
+  return true;
+}
+
+// Reads messages from `fd` until the response with `id`.
+bool read_response(int fd, std::string &buffer, std::string_view id) {
+  // as the server writes it, before the result or the error.
+  auto const result = fmt::format("\"id\":{},\"result\"", id);
+  auto const error = fmt::format("\"id\":{},\"error\"", id);
+  for (;;) {
+    auto const end = buffer.find("\r\n\r\n");
+    if (end != std::string::npos) {
+      auto const header = buffer.find("Content-Length: ");
+      u64 length = 0;
+      if (header == std::string::npos || header > end)
+        return false;
+      std::from_chars(buffer.data() + header + 16, buffer.data() + end,
+                      length);
+      if (buffer.size() >= end + 4 + length) {
+        auto const content = buffer.substr(end + 4, length);
+        buffer.erase(0, end + 4 + length);
+        if (content.find(result) != std::string::npos ||
+            content.find(error) != std::string::npos)
+          return true;
+        continue;
+      }
+    }
+    char chunk[4096];
+    auto const count = ::read(fd, chunk, sizeof(chunk));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    buffer.append(chunk, static_cast<u64>(count));
+  }
+}
+
+// One startup, in seconds, or nothing if the server didn't answer.
+std::optional<f64> measure(std::vector<char *> const &argv) {
+  int in[2], out[2];
+  if (::pipe2(in, O_CLOEXEC) != 0)
+    return std::nullopt;
+  if (::pipe2(out, O_CLOEXEC) != 0) {
+    ::close(in[0]);
+    ::close(in[1]);
+    return std::nullopt;
+  }
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_adddup2(&actions, in[0], 0);
+  ::posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+  ::posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+  auto const start = clock_type::now();
+  pid_t pid;
+  auto const spawned =
+      ::posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(in[0]);
+  ::close(out[1]);
+  if (spawned != 0) {
+    ::close(in[1]);
+    ::close(out[0]);
+    return std::nullopt;
+  }
+
+  std::string buffer;
+  auto const answered =
+      write_message(in[1], INITIALIZE) && read_response(out[0], buffer, "1");
+  auto const elapsed =
+      std::chrono::duration<f64>(clock_type::now() - start).count();
+  if (answered && write_message(in[1], SHUTDOWN) &&
+      read_response(out[0], buffer, "2"))
+    write_message(in[1], EXIT);
+  ::close(in[1]);
+  ::close(out[0]);
+  int status;
+  while (::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    ;
+  if (!answered)
+    return std::nullopt;
+  return elapsed;
+}
+} // namespace
+
+auto main(int const argc, char const *const *const argv) -> int {
+  u64 runs = 20;
+  int first = 1;
+  if (first != argc && std::strncmp(argv[first], "--runs=", 7) == 0) {
+    auto const value = argv[first] + 7;
+    auto const end = value + std::strlen(value);
+    auto const [ptr, error] = std::from_chars(value, end, runs);
+    if (error != std::errc{} || ptr != end || runs == 0) {
+      std::fprintf(stderr, "error: invalid number of runs '%s'.\n", value);
+      return 1;
+    }
+    ++first;
+  }
+  if (first == argc) {
+    std::fprintf(stderr, "USAGE: %s [--runs=N] SERVER [SERVER ARGS..]\n",
+                 argv[0]);
+    return 1;
+  }
+  std::vector<std::string> arguments(argv + first, argv + argc);
+  std::vector<char *> server;
+  for (auto &argument : arguments)
+    server.push_back(argument.data());
+  server.push_back(nullptr);
+
+  std::vector<f64> times;
+  for (u64 run = 0; run != runs; ++run) {
+    auto const time = measure(server);
+    if (!time) {
+      std::fprintf(stderr, "error: %s didn't answer initialize.\n",
+                   server[0]);
+      return 1;
+    }
+    times.push_back(*time);
+  }
+  std::sort(times.begin(), times.end());
+  fmt::print("initialize answered after {:.2f} ms (min {:.2f}, max {:.2f}, "
+             "{} runs)\n",
+             times[times.size() / 2] * 1e3, times.front() * 1e3,
+             times.back() * 1e3, runs);
+  return 0;
+}
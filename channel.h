@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Multiple producer, single consumer queue used to talk to the main thread
+// (see the architecture notes in the README).
+template <typename T> class Channel {
+  std::mutex m_mutex;
+  std::condition_variable m_available;
+  std::deque<T> m_queue;
+
+public:
+  void send(T value) {
+    {
+      std::lock_guard lock(m_mutex);
+      m_queue.emplace_back(std::move(value));
+    }
+    m_available.notify_one();
+  }
+
+  // Blocks until there is something to receive.
+  T receive() {
+    std::unique_lock lock(m_mutex);
+    m_available.wait(lock, [&] { return !m_queue.empty(); });
+    auto value = std::move(m_queue.front());
+    m_queue.pop_front();
+    return value;
+  }
+
+  std::optional<T> try_receive() {
+    std::lock_guard lock(m_mutex);
+    if (m_queue.empty())
+      return std::nullopt;
+    auto value = std::move(m_queue.front());
+    m_queue.pop_front();
+    return value;
+  }
+
+  // Takes everything sent so far, without blocking.
+  std::vector<T> drain() {
+    std::lock_guard lock(m_mutex);
+    std::vector<T> values(std::make_move_iterator(m_queue.begin()),
+                          std::make_move_iterator(m_queue.end()));
+    m_queue.clear();
+    return values;
+  }
+};
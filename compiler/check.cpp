@@ -0,0 +1,247 @@
+#include <cerrno>
+#include <compiler/check.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory/accounting.h>
+#include <poll.h>
+#include <rpc/base.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <workspace/hash.h>
+#include <workspace/mapped_file.h>
+
+extern char **environ;
+
+namespace compiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+// how long a running compiler goes without being asked whether to stop
+constexpr int STOP_POLL_MS = 20;
+
+fs::path temporaries(std::error_code &error) {
+  return fs::temp_directory_path(error) /
+         fmt::format("jakt-lsp-{}", ::getpid());
+}
+
+bool write_file(fs::path const &path, documents::Rope const &text) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  text.visit_chunks(0, text.size(), [&](std::string_view chunk) {
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    return !out.fail();
+  });
+  return !out.fail();
+}
+
+// Whether `snapshot` is what's saved at `path`: by size first, then by
+// `saved`, and only then by the bytes, chunk by chunk.
+bool is_saved(fs::path const &path, documents::Snapshot const &snapshot,
+              std::optional<Saved> &saved) {
+  auto const &text = snapshot.text;
+  auto const stamp = symbols::Stamp::stat(path);
+  if (!stamp || stamp->size != text.size())
+    return false;
+  if (saved && saved->version == snapshot.version &&
+      saved->stamp.same_times(*stamp))
+    return true;
+  auto const same = workspace::with_mapped_file(
+      path, [&](std::string_view bytes) {
+        if (bytes.size() != text.size())
+          return false;
+        auto equal = true;
+        text.visit_chunks(0, text.size(), [&](std::string_view chunk) {
+          equal = bytes.substr(0, chunk.size()) == chunk;
+          bytes.remove_prefix(chunk.size());
+          return equal;
+        });
+        return equal;
+      });
+  if (!same || !*same)
+    return false;
+  saved = Saved{snapshot.version, *stamp};
+  return true;
+}
+
+// The file to give the compiler for `snapshot`, and what to remove after,
+// if it had to be written.
+std::optional<std::pair<fs::path, fs::path>>
+source_of(fs::path const &path, documents::Snapshot const &snapshot,
+          std::optional<Saved> &saved) {
+  if (is_saved(path, snapshot, saved))
+    return std::pair{path, fs::path()};
+
+  // one directory per document, which is never checked twice at once. the
+  // file keeps its name, which the compiler names its module after.
+  std::error_code error;
+  auto const directory =
+      temporaries(error) /
+      fmt::format("{:016x}", workspace::hash_bytes(path.native()));
+  if (error || (fs::create_directories(directory, error), error))
+    return std::nullopt;
+  auto source = directory / (path.has_filename() ? path.stem().native()
+                                                  : std::string("main"));
+  source += ".jakt";
+  if (!write_file(source, snapshot.text))
+    return std::nullopt;
+  return std::pair{std::move(source), directory};
+}
+
+rpc::lsp::DiagnosticSeverity severity_of(std::u16string_view name) noexcept {
+  using rpc::lsp::DiagnosticSeverity;
+  if (name == u"Warning")
+    return DiagnosticSeverity::Warning;
+  if (name == u"Information")
+    return DiagnosticSeverity::Information;
+  if (name == u"Hint")
+    return DiagnosticSeverity::Hint;
+  return DiagnosticSeverity::Error;
+}
+
+// One line of `--json-errors` output, such as
+//   {"type":"diagnostic","message":"...","severity":"Error",
+//    "span":{"start":12,"end":15}}
+// with spans in bytes of the checked file.
+std::optional<rpc::lsp::Diagnostic>
+diagnostic_of(std::string_view line, documents::Snapshot const &snapshot) {
+  auto value = json::parse_single(line);
+  if (!value || !value->is_object())
+    return std::nullopt;
+  auto &obj = value->as_object();
+  auto const type = obj.remove(u"type");
+  if (!type || !type->is_string() || type->as_string() != u"diagnostic")
+    return std::nullopt;
+  auto message = obj.remove(u"message");
+  if (!message || !message->is_string())
+    return std::nullopt;
+  auto const severity = obj.remove(u"severity");
+  auto span = obj.remove(u"span");
+  if (!span || !span->is_object())
+    return std::nullopt;
+  auto const start = span->as_object().remove(u"start");
+  auto const end = span->as_object().remove(u"end");
+  auto const start_offset =
+      start ? start->try_integer(INT_CONVERSION_TOLERANCE) : std::nullopt;
+  auto const end_offset =
+      end ? end->try_integer(INT_CONVERSION_TOLERANCE) : std::nullopt;
+  if (!start_offset || !end_offset || *start_offset < 0 || *end_offset < 0)
+    return std::nullopt;
+
+  auto const &text = snapshot.text;
+  auto const first = std::min(static_cast<u64>(*start_offset), text.size());
+  auto const last =
+      std::clamp(static_cast<u64>(*end_offset), first, text.size());
+  return rpc::lsp::Diagnostic{
+      {snapshot.lines.position_of(text, first),
+       snapshot.lines.position_of(text, last)},
+      severity && severity->is_string() ? severity_of(severity->as_string())
+                                        : rpc::lsp::DiagnosticSeverity::Error,
+      json::string(message->as_string())};
+}
+} // namespace
+
+std::optional<Checked> check(fs::path const &compiler,
+                             std::string_view import_path_flag,
+                             fs::path const &path,
+                             documents::Snapshot const &snapshot,
+                             std::optional<Saved> &saved,
+                             std::stop_token const &stop) {
+  memory::Tagged tagged(memory::Subsystem::Compiler);
+  auto const source = source_of(path, snapshot, saved);
+  if (!source)
+    return std::nullopt;
+  auto const cleanup = [&] {
+    std::error_code error;
+    if (!source->second.empty())
+      fs::remove_all(source->second, error);
+  };
+
+  int pipe[2];
+  if (::pipe2(pipe, O_CLOEXEC) != 0) {
+    cleanup();
+    return std::nullopt;
+  }
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+  ::posix_spawn_file_actions_adddup2(&actions, pipe[1], 1);
+  ::posix_spawn_file_actions_adddup2(&actions, pipe[1], 2);
+  std::string program = compiler.native(), file = source->first.native();
+  std::string check_only = "--check-only", json_errors = "--json-errors";
+  std::string flag(import_path_flag), directory = path.parent_path().native();
+  std::vector<char *> argv{program.data(), check_only.data(),
+                           json_errors.data()};
+  // a copy is elsewhere: its imports are next to the document.
+  if (!source->second.empty() && !flag.empty() && !directory.empty()) {
+    argv.push_back(flag.data());
+    argv.push_back(directory.data());
+  }
+  argv.push_back(file.data());
+  argv.push_back(nullptr);
+  auto const start = std::chrono::steady_clock::now();
+  pid_t pid;
+  auto const spawned =
+      ::posix_spawn(&pid, program.c_str(), &actions, nullptr, argv.data(),
+                     environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(pipe[1]);
+  if (spawned != 0) {
+    ::close(pipe[0]);
+    cleanup();
+    return std::nullopt;
+  }
+
+  std::string output;
+  auto stopped = false;
+  for (;;) {
+    if (stop.stop_requested()) {
+      ::kill(pid, SIGKILL);
+      stopped = true;
+      break;
+    }
+    pollfd readable{pipe[0], POLLIN, 0};
+    auto const ready = ::poll(&readable, 1, STOP_POLL_MS);
+    if (ready == 0 || (ready < 0 && errno == EINTR))
+      continue;
+    if (ready < 0)
+      break;
+    char buffer[4096];
+    auto const count = ::read(pipe[0], buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      break;
+    output.append(buffer, static_cast<u64>(count));
+  }
+  ::close(pipe[0]);
+  int status;
+  while (::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    ;
+  Checked checked{{}, std::chrono::steady_clock::now() - start};
+  cleanup();
+  if (stopped)
+    return std::nullopt;
+
+  std::string_view rest(output);
+  while (!rest.empty()) {
+    auto const end = std::min(rest.find('\n'), rest.size());
+    auto const line = rest.substr(0, end);
+    rest.remove_prefix(std::min(end + 1, rest.size()));
+    if (line.starts_with('{'))
+      if (auto diagnostic = diagnostic_of(line, snapshot))
+        checked.diagnostics.push_back(std::move(*diagnostic));
+  }
+  return checked;
+}
+
+void remove_temporaries() noexcept {
+  std::error_code error;
+  auto const directory = temporaries(error);
+  if (!error)
+    fs::remove_all(directory, error);
+}
+
+} // namespace compiler
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <documents/store.h>
+#include <filesystem>
+#include <optional>
+#include <rpc/lsp.h>
+#include <stop_token>
+#include <string_view>
+#include <symbols/disk_index.h>
+#include <vector>
+
+// Running the Jakt compiler, for what only it can tell.
+namespace compiler {
+
+// What a compiler run found in a document.
+struct Checked {
+  std::vector<rpc::lsp::Diagnostic> diagnostics;
+  // how long the compiler took
+  std::chrono::steady_clock::duration elapsed;
+};
+
+// What a document was last found to be the same as on disk: its version,
+// and the stamp of the file at its path then.
+struct Saved {
+  i64 version;
+  symbols::Stamp stamp;
+};
+
+// Checks a document with `compiler --check-only --json-errors`, reading the
+// diagnostics it prints as JSON lines.
+//
+// The compiler reads the file at `path` when the document is the same as
+// what's saved there, which `saved` can tell without reading it again, and
+// is updated with. Otherwise the document is written to the temporary
+// directory first, and the directory of `path` is given to the compiler
+// with `import_path_flag` so that its imports resolve all the same.
+//
+// The compiler is killed as soon as `stop` is requested, and nothing is
+// returned then, nor when it can't be run.
+std::optional<Checked> check(std::filesystem::path const &compiler,
+                             std::string_view import_path_flag,
+                             std::filesystem::path const &path,
+                             documents::Snapshot const &snapshot,
+                             std::optional<Saved> &saved,
+                             std::stop_token const &stop);
+// Removes what `check` left in the temporary directory, once no check runs.
+void remove_temporaries() noexcept;
+
+} // namespace compiler
@@ -0,0 +1,233 @@
+#include "numbers.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <compiler/probe.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace compiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr auto PROBE_TIMEOUT = std::chrono::seconds(10);
+// first line of a cache file, to change along with its layout
+constexpr std::string_view CACHE_MAGIC = "jakt-lsp compiler probe 1";
+
+// What `program option` prints on its output and error together, whatever
+// it exits with.
+std::optional<std::string> output_of(fs::path const &program,
+                                     char const *option) {
+  int pipe[2];
+  if (::pipe2(pipe, O_CLOEXEC) != 0)
+    return std::nullopt;
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+  ::posix_spawn_file_actions_adddup2(&actions, pipe[1], 1);
+  ::posix_spawn_file_actions_adddup2(&actions, pipe[1], 2);
+  std::string name = program.native(), argument = option;
+  char *argv[] = {name.data(), argument.data(), nullptr};
+  pid_t pid;
+  auto const spawned =
+      ::posix_spawn(&pid, name.c_str(), &actions, nullptr, argv, environ);
+  ::posix_spawn_file_actions_destroy(&actions);
+  ::close(pipe[1]);
+  if (spawned != 0) {
+    ::close(pipe[0]);
+    return std::nullopt;
+  }
+
+  auto const deadline = std::chrono::steady_clock::now() + PROBE_TIMEOUT;
+  std::string output;
+  auto timed_out = false;
+  for (;;) {
+    auto const left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) {
+      ::kill(pid, SIGKILL);
+      timed_out = true;
+      break;
+    }
+    pollfd readable{pipe[0], POLLIN, 0};
+    auto const ready = ::poll(&readable, 1, static_cast<int>(left.count()));
+    if (ready == 0 || (ready < 0 && errno == EINTR))
+      continue;
+    if (ready < 0)
+      break;
+    char buffer[4096];
+    auto const count = ::read(pipe[0], buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      break;
+    output.append(buffer, static_cast<u64>(count));
+  }
+  ::close(pipe[0]);
+  int status;
+  while (::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    ;
+  if (timed_out)
+    return std::nullopt;
+  return output;
+}
+
+// The long options in `help`, such as "--check-only" out of
+//   -c,--check-only    Only check the code for errors
+std::vector<std::string> flags_in(std::string_view help) {
+  std::vector<std::string> flags;
+  for (u64 i = help.find("--"); i != std::string_view::npos;
+       i = help.find("--", i)) {
+    auto const starts_word =
+        i == 0 || help[i - 1] == ' ' || help[i - 1] == ',' ||
+        help[i - 1] == '\t' || help[i - 1] == '\n' || help[i - 1] == '[';
+    auto end = i + 2;
+    while (end != help.size() &&
+           (std::isalnum(static_cast<unsigned char>(help[end])) ||
+            help[end] == '-'))
+      ++end;
+    if (starts_word && end > i + 2)
+      flags.emplace_back(help.substr(i, end - i));
+    i = end;
+  }
+  std::sort(flags.begin(), flags.end());
+  flags.erase(std::unique(flags.begin(), flags.end()), flags.end());
+  return flags;
+}
+
+// Where the runtime usually is relative to the compiler, in a build tree or
+// once installed.
+fs::path runtime_near(fs::path const &compiler) {
+  auto const directory = compiler.parent_path();
+  for (auto const &candidate :
+       {directory / "runtime", directory.parent_path() / "runtime",
+        directory.parent_path() / "share" / "jakt" / "runtime",
+        directory.parent_path() / "include" / "runtime"}) {
+    std::error_code error;
+    if (fs::is_directory(candidate, error))
+      return candidate.lexically_normal();
+  }
+  return {};
+}
+
+// What a probe depends on: the size and modification time of the compiler.
+struct Stamp {
+  u64 size;
+  i64 modified;
+
+  static std::optional<Stamp> stat(fs::path const &path) noexcept {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+      return std::nullopt;
+    return Stamp{static_cast<u64>(info.st_size),
+                 static_cast<i64>(info.st_mtim.tv_sec) * 1'000'000'000 +
+                     info.st_mtim.tv_nsec};
+  }
+};
+
+// A cache file is a line per field:
+//   the magic, the compiler's path, its size and modification time, the
+//   version, the runtime, then a line per flag.
+std::optional<Capabilities> read_cache(fs::path const &cache,
+                                       fs::path const &compiler,
+                                       Stamp stamp) {
+  std::ifstream in(cache);
+  std::string magic, path, times, version, runtime;
+  if (!std::getline(in, magic) || magic != CACHE_MAGIC ||
+      !std::getline(in, path) || path != compiler.native() ||
+      !std::getline(in, times) ||
+      times != fmt::format("{} {}", stamp.size, stamp.modified) ||
+      !std::getline(in, version) || !std::getline(in, runtime))
+    return std::nullopt;
+  Capabilities capabilities{std::move(version), {}, std::move(runtime)};
+  for (std::string flag; std::getline(in, flag);)
+    capabilities.flags.push_back(std::move(flag));
+  return capabilities;
+}
+
+void write_cache(fs::path const &cache, fs::path const &compiler, Stamp stamp,
+                 Capabilities const &capabilities) {
+  // written next to the cache, then moved over it.
+  std::error_code error;
+  fs::create_directories(cache.parent_path(), error);
+  auto temporary = cache;
+  temporary += ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(temporary, std::ios::trunc);
+    out << CACHE_MAGIC << '\n'
+        << compiler.native() << '\n'
+        << stamp.size << ' ' << stamp.modified << '\n'
+        << capabilities.version << '\n'
+        << capabilities.runtime.native() << '\n';
+    for (auto const &flag : capabilities.flags)
+      out << flag << '\n';
+    if (!out.flush()) {
+      fs::remove(temporary, error);
+      return;
+    }
+  }
+  fs::rename(temporary, cache, error);
+  if (error)
+    fs::remove(temporary, error);
+}
+} // namespace
+
+bool Capabilities::supports(std::string_view flag) const noexcept {
+  return std::binary_search(flags.begin(), flags.end(), flag);
+}
+
+std::string_view Capabilities::import_path_flag() const noexcept {
+  // as the compiler's versions named it.
+  for (std::string_view const flag :
+       {"--import-path", "--module-path", "--include-path"})
+    if (supports(flag))
+      return flag;
+  return {};
+}
+
+std::optional<Capabilities> probe(fs::path const &compiler) {
+  auto const version = output_of(compiler, "--version");
+  if (!version)
+    return std::nullopt;
+  auto const help = output_of(compiler, "--help");
+  if (!help)
+    return std::nullopt;
+  std::string_view first_line(*version);
+  first_line = first_line.substr(0, first_line.find('\n'));
+  while (!first_line.empty() && std::isspace(static_cast<unsigned char>(
+                                    first_line.back())))
+    first_line.remove_suffix(1);
+  return Capabilities{std::string(first_line), flags_in(*help),
+                      runtime_near(compiler)};
+}
+
+std::optional<Capabilities> probe_cached(fs::path const &compiler,
+                                         fs::path const &cache) {
+  auto const stamp = Stamp::stat(compiler);
+  if (!stamp)
+    return probe(compiler);
+  if (auto cached = read_cache(cache, compiler, *stamp))
+    return cached;
+  auto capabilities = probe(compiler);
+  // a compiler replaced while it was probed is probed again next time.
+  if (capabilities) {
+    auto const after = Stamp::stat(compiler);
+    if (after && after->size == stamp->size &&
+        after->modified == stamp->modified)
+      write_cache(cache, compiler, *stamp, *capabilities);
+  }
+  return capabilities;
+}
+
+} // namespace compiler
@@ -0,0 +1,35 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace compiler {
+
+// What the compiler tells about itself, which takes running it.
+struct Capabilities {
+  // the first line of `--version`, empty if it has none
+  std::string version;
+  // long options listed by `--help`, sorted
+  std::vector<std::string> flags;
+  // the runtime directory next to the compiler, empty if there's none
+  std::filesystem::path runtime;
+
+  bool supports(std::string_view flag) const noexcept;
+  // The option that adds a directory to where imports are looked up, empty
+  // if none is listed.
+  std::string_view import_path_flag() const noexcept;
+};
+
+// Runs `compiler --version` and `compiler --help`, giving up on a compiler
+// that doesn't answer in `PROBE_TIMEOUT`. Nothing if it can't be run.
+std::optional<Capabilities> probe(std::filesystem::path const &compiler);
+
+// Like `probe`, but what it finds is kept in `cache` for the next runs, for
+// as long as the compiler's path, size and modification time stay the same.
+std::optional<Capabilities>
+probe_cached(std::filesystem::path const &compiler,
+             std::filesystem::path const &cache);
+
+} // namespace compiler
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <compiler/scheduler.h>
+
+namespace compiler {
+
+Scheduler::Scheduler(std::filesystem::path compiler,
+                     std::string import_path_flag, Publish publish)
+    : m_compiler(std::move(compiler)),
+      m_import_path_flag(std::move(import_path_flag)),
+      m_publish(std::move(publish)) {
+  // compiles are heavy: half of the cores, the rest being for requests.
+  auto const workers = std::max(1u, std::thread::hardware_concurrency() / 2);
+  for (u32 i = 0; i != workers; ++i)
+    m_workers.emplace_back(
+        [this](std::stop_token stop) { work(std::move(stop)); });
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard lock(m_mutex);
+    for (auto &[file, running] : m_running)
+      running.stop.request_stop();
+  }
+  for (auto &worker : m_workers)
+    worker.request_stop();
+  m_workers.clear();
+  remove_temporaries();
+}
+
+auto Scheduler::delay_of(workspace::FileId file) const noexcept
+    -> clock::duration {
+  auto const found = m_estimates.find(file);
+  auto const estimate =
+      found == m_estimates.end() ? FIRST_ESTIMATE : found->second;
+  // each check waiting or running per worker stretches the window as much
+  // again.
+  auto const load = static_cast<f64>(m_pending.size() + m_running.size()) /
+                    static_cast<f64>(m_workers.size());
+  auto const delay =
+      std::chrono::duration_cast<clock::duration>(estimate * (1 + load));
+  return std::clamp(delay, MIN_DELAY, MAX_DELAY);
+}
+
+void Scheduler::schedule(workspace::FileId file,
+                         documents::SnapshotPtr snapshot, bool visible) {
+  {
+    std::lock_guard lock(m_mutex);
+    // whatever it finds is already out of date.
+    if (auto const running = m_running.find(file); running != m_running.end())
+      running->second.stop.request_stop();
+    auto const due = clock::now() + delay_of(file);
+    m_pending.insert_or_assign(file,
+                               Pending{std::move(snapshot), due, visible});
+    ++m_generation;
+  }
+  m_changed.notify_all();
+}
+
+void Scheduler::expedite(workspace::FileId file) {
+  {
+    std::lock_guard lock(m_mutex);
+    auto const pending = m_pending.find(file);
+    if (pending == m_pending.end())
+      return;
+    pending->second.due = std::min(pending->second.due, clock::now());
+    ++m_generation;
+  }
+  m_changed.notify_all();
+}
+
+void Scheduler::cancel(workspace::FileId file) {
+  {
+    std::lock_guard lock(m_mutex);
+    m_pending.erase(file);
+    m_saved.erase(file);
+    if (auto const running = m_running.find(file); running != m_running.end())
+      running->second.stop.request_stop();
+    ++m_generation;
+  }
+  m_changed.notify_all();
+}
+
+void Scheduler::work(std::stop_token stop) {
+  std::unique_lock lock(m_mutex);
+  while (!stop.stop_requested()) {
+    // visible documents first, then the longest waiting. A document is only
+    // checked once at a time: a newer version waits for the older one to
+    // be killed.
+    auto const now = clock::now();
+    auto next = m_pending.end();
+    auto wake = clock::time_point::max();
+    for (auto pending = m_pending.begin(); pending != m_pending.end();
+         ++pending) {
+      if (m_running.contains(pending->first))
+        continue;
+      if (pending->second.due > now) {
+        wake = std::min(wake, pending->second.due);
+        continue;
+      }
+      if (next == m_pending.end() ||
+          std::pair(!pending->second.visible, pending->second.due) <
+              std::pair(!next->second.visible, next->second.due))
+        next = pending;
+    }
+    if (next == m_pending.end()) {
+      auto const generation = m_generation;
+      m_changed.wait_until(lock, stop, wake,
+                           [&] { return m_generation != generation; });
+      continue;
+    }
+
+    auto const file = next->first;
+    auto const snapshot = std::move(next->second.snapshot);
+    m_pending.erase(next);
+    auto &running = m_running[file];
+    running.version = snapshot->version;
+    auto const token = running.stop.get_token();
+    std::optional<Saved> saved;
+    if (auto const found = m_saved.find(file); found != m_saved.end())
+      saved = found->second;
+    lock.unlock();
+
+    std::optional<Checked> checked;
+    if (auto const &path = workspace::file_ids().path(file))
+      checked = check(m_compiler, m_import_path_flag, *path, *snapshot, saved,
+                      token);
+
+    lock.lock();
+    m_running.erase(file);
+    if (saved)
+      m_saved.insert_or_assign(file, *saved);
+    ++m_generation;
+    m_changed.notify_all();
+    if (!checked)
+      continue;
+    auto [estimate, first] = m_estimates.try_emplace(file, checked->elapsed);
+    if (!first)
+      estimate->second = (3 * estimate->second + checked->elapsed) / 4;
+    // a newer version is on its way.
+    if (token.stop_requested() || m_pending.contains(file))
+      continue;
+    lock.unlock();
+    m_publish(file, snapshot, std::move(*checked));
+    lock.lock();
+  }
+}
+
+} // namespace compiler
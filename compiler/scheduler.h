@@ -0,0 +1,84 @@
+#pragma once
+#include <compiler/check.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <workspace/file_ids.h>
+
+namespace compiler {
+
+// Checks open documents with the compiler once the client stops editing
+// them, rather than on every change.
+//
+// A change only schedules a check after a debounce window, which a newer
+// version restarts. The window follows how long checking that document took
+// lately (running an expensive compile on a mere break between keystrokes
+// wastes more) and grows with the number of checks already queued or
+// running. Checks of visible documents are started before the others, and a
+// check still running when a newer version arrives is killed.
+class Scheduler {
+public:
+  using clock = std::chrono::steady_clock;
+  // Called from the scheduler's threads with the latest version of a
+  // document and what the compiler found in it.
+  using Publish = std::function<void(workspace::FileId,
+                                     documents::SnapshotPtr, Checked)>;
+
+  static constexpr clock::duration MIN_DELAY = std::chrono::milliseconds(150);
+  static constexpr clock::duration MAX_DELAY = std::chrono::seconds(2);
+  // what a document is expected to take to check before it ever was
+  static constexpr clock::duration FIRST_ESTIMATE =
+      std::chrono::milliseconds(300);
+
+  // `import_path_flag` is as `check` takes it.
+  Scheduler(std::filesystem::path compiler, std::string import_path_flag,
+            Publish publish);
+  ~Scheduler();
+
+  // Checks `snapshot` once the debounce window passed, unless a newer
+  // version comes first. `visible` is whether the client shows the document.
+  void schedule(workspace::FileId file, documents::SnapshotPtr snapshot,
+                bool visible);
+  // Starts the check scheduled for `file` without waiting for the rest of
+  // its debounce window, once the client is known to be idle.
+  void expedite(workspace::FileId file);
+  // Drops whatever was scheduled or running for `file`.
+  void cancel(workspace::FileId file);
+
+private:
+  struct Pending {
+    documents::SnapshotPtr snapshot;
+    clock::time_point due;
+    bool visible;
+  };
+  struct Running {
+    i64 version;
+    std::stop_source stop;
+  };
+
+  void work(std::stop_token stop);
+  // The debounce window of `file`, with `m_mutex` held.
+  clock::duration delay_of(workspace::FileId file) const noexcept;
+
+  std::filesystem::path m_compiler;
+  std::string m_import_path_flag;
+  Publish m_publish;
+
+  std::mutex m_mutex;
+  // for workers: a check was scheduled, cancelled or finished
+  std::condition_variable_any m_changed;
+  std::unordered_map<workspace::FileId, Pending> m_pending;
+  std::unordered_map<workspace::FileId, Running> m_running;
+  // by document, a moving average of how long checking it took
+  std::unordered_map<workspace::FileId, clock::duration> m_estimates;
+  // by document, what it was last found the same as on disk
+  std::unordered_map<workspace::FileId, Saved> m_saved;
+  // bumped on every change to the above, for idle workers to look again
+  u64 m_generation = 0;
+
+  std::vector<std::jthread> m_workers;
+};
+
+} // namespace compiler
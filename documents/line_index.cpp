@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <bit>
+#include <documents/line_index.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace documents {
+
+namespace {
+// Splits bytes into lines, flagging the ones that are pure ASCII.
+struct LineScanner {
+  struct Line {
+    u64 length;
+    bool ascii;
+  };
+  std::vector<Line> lines;
+  // bytes scanned so far, and where the current line starts in them
+  u64 offset = 0;
+  u64 line_start = 0;
+  bool ascii = true;
+
+  void end_line(u64 newline) {
+    lines.push_back({newline + 1 - line_start, ascii});
+    line_start = newline + 1;
+    ascii = true;
+  }
+
+  void scan(std::string_view bytes);
+};
+
+void LineScanner::scan(std::string_view bytes) {
+  u64 i = 0;
+
+  // For each block, `newlines` has a bit set for every '\n' and `high` for
+  // every non-ASCII byte. Blocks without either are skipped whole.
+  [[maybe_unused]] auto const record = [&](u32 newlines, u32 high) {
+    while (newlines) {
+      auto const bit = std::countr_zero(newlines);
+      auto const before = (u64(1) << bit) - 1;
+      if (high & before)
+        ascii = false;
+      high &= ~(before << 1 | 1);
+      end_line(offset + i + bit);
+      newlines &= newlines - 1;
+    }
+    if (high)
+      ascii = false;
+  };
+
+#if defined(__AVX2__)
+  auto const newline = _mm256_set1_epi8('\n');
+  for (; i + 32 <= bytes.size(); i += 32) {
+    auto const block = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(bytes.data() + i));
+    auto const newlines = static_cast<u32>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+    auto const high = static_cast<u32>(_mm256_movemask_epi8(block));
+    if (newlines | high)
+      record(newlines, high);
+  }
+#elif defined(__SSE2__)
+  auto const newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= bytes.size(); i += 16) {
+    auto const block =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(bytes.data() + i));
+    auto const newlines =
+        static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+    auto const high = static_cast<u32>(_mm_movemask_epi8(block));
+    if (newlines | high)
+      record(newlines, high);
+  }
+#endif
+
+  for (; i != bytes.size(); ++i) {
+    auto const byte = static_cast<u8>(bytes[i]);
+    if (byte == '\n')
+      end_line(offset + i);
+    else if (byte >= 0x80)
+      ascii = false;
+  }
+  offset += bytes.size();
+}
+} // namespace
+
+LineIndex::LineIndex() {
+  auto root = std::make_shared<Node>();
+  root->length = 0;
+  root->ascii = true;
+  root->priority = m_priorities.next();
+  root->update();
+  m_root = std::move(root);
+}
+
+LineIndex::LineIndex(Rope const &text)
+    : m_root(build(text, 0, text.size(), true)) {}
+
+auto LineIndex::build(Rope const &text, u64 offset, u64 count,
+                      bool keep_tail) -> NodePtr {
+  LineScanner scanner;
+  text.visit_chunks(offset, count, [&](std::string_view chunk) {
+    scanner.scan(chunk);
+    return true;
+  });
+  if (keep_tail)
+    scanner.lines.push_back(
+        {scanner.offset - scanner.line_start, scanner.ascii});
+
+  std::vector<std::shared_ptr<Node>> nodes;
+  nodes.reserve(scanner.lines.size());
+  for (auto const &line : scanner.lines) {
+    auto node = std::make_shared<Node>();
+    node->length = line.length;
+    node->ascii = line.ascii;
+    node->priority = m_priorities.next();
+    nodes.emplace_back(std::move(node));
+  }
+  return treap::build(std::move(nodes));
+}
+
+auto LineIndex::split(NodePtr const &node, u64 count)
+    -> std::pair<NodePtr, NodePtr> {
+  // splitting at either end keeps the whole subtree as is.
+  if (!node || count == 0)
+    return {nullptr, node};
+  if (count >= node->count)
+    return {node, nullptr};
+
+  auto const left_count = count_of(node->left.get());
+  auto copy = std::make_shared<Node>(*node);
+  if (count <= left_count) {
+    auto [left, right] = split(node->left, count);
+    copy->left = std::move(right);
+    copy->update();
+    return {std::move(left), std::move(copy)};
+  }
+  auto [left, right] = split(node->right, count - left_count - 1);
+  copy->right = std::move(left);
+  copy->update();
+  return {std::move(copy), std::move(right)};
+}
+
+auto LineIndex::find_line(u64 line) const noexcept -> Found {
+  Found found{nullptr, line, 0};
+  auto node = m_root.get();
+  while (node) {
+    auto const left_count = count_of(node->left.get());
+    if (line < left_count) {
+      node = node->left.get();
+      continue;
+    }
+    found.start += size_of(node->left.get());
+    if (line == left_count) {
+      found.node = node;
+      break;
+    }
+    found.start += node->length;
+    line -= left_count + 1;
+    node = node->right.get();
+  }
+  return found;
+}
+
+auto LineIndex::find_offset(u64 offset) const noexcept -> Found {
+  if (offset >= size_of(m_root.get()))
+    return find_line(line_count() - 1);
+
+  Found found{nullptr, 0, 0};
+  auto node = m_root.get();
+  while (node) {
+    auto const left_size = size_of(node->left.get());
+    if (offset < left_size) {
+      node = node->left.get();
+      continue;
+    }
+    found.line += count_of(node->left.get());
+    found.start += left_size;
+    offset -= left_size;
+    if (offset < node->length) {
+      found.node = node;
+      break;
+    }
+    ++found.line;
+    found.start += node->length;
+    offset -= node->length;
+    node = node->right.get();
+  }
+  return found;
+}
+
+u64 LineIndex::line_end(Found const &found) const noexcept {
+  // every line but the last one ends with a '\n'.
+  auto const is_last = found.line + 1 == line_count();
+  return found.start + found.node->length - (is_last ? 0 : 1);
+}
+
+std::vector<u32> const &LineIndex::columns(Rope const &text,
+                                           Found const &found) const {
+  auto &cached = found.node->columns;
+  if (auto const table = cached.load(std::memory_order_acquire); table)
+    return *table;
+
+  auto table = std::make_unique<std::vector<u32>>();
+  u32 offset = 0;
+  text.visit_chunks(found.start, line_end(found) - found.start,
+                    [&](std::string_view chunk) {
+                      for (auto const c : chunk) {
+                        auto const byte = static_cast<u8>(c);
+                        // continuation bytes belong to the code unit of their
+                        // lead byte, and 4-byte sequences are encoded as two
+                        // code units in UTF-16.
+                        if ((byte & 0xc0) != 0x80) {
+                          table->push_back(offset);
+                          if (byte >= 0xf0)
+                            table->push_back(offset);
+                        }
+                        ++offset;
+                      }
+                      return true;
+                    });
+  table->push_back(offset);
+
+  // another reader may have built it meanwhile, in which case theirs wins.
+  std::vector<u32> const *expected = nullptr;
+  if (cached.compare_exchange_strong(expected, table.get(),
+                                     std::memory_order_acq_rel,
+                                     std::memory_order_acquire))
+    return *table.release();
+  return *expected;
+}
+
+u64 LineIndex::offset_of(Rope const &text,
+                         rpc::lsp::Position position) const {
+  if (position.line >= line_count())
+    return text.size();
+  auto const found = find_line(position.line);
+  if (found.node->ascii)
+    // saturated, for ends of lines given as the largest character.
+    return found.start + std::min(position.character,
+                                  line_end(found) - found.start);
+
+  auto const &table = columns(text, found);
+  return found.start +
+         table[std::min<u64>(position.character, table.size() - 1)];
+}
+
+rpc::lsp::Position LineIndex::position_of(Rope const &text,
+                                          u64 offset) const {
+  offset = std::min(offset, text.size());
+  auto const found = find_offset(offset);
+  auto const column = offset - found.start;
+  if (found.node->ascii)
+    return {found.line, column};
+
+  auto const &table = columns(text, found);
+  return {found.line,
+          static_cast<u64>(
+              std::lower_bound(table.begin(), table.end(), column) -
+              table.begin())};
+}
+
+void LineIndex::edit(Rope const &text, u64 offset, u64 removed,
+                     u64 inserted) {
+  // the lines touched by the edit, as they were before it.
+  auto const first = find_offset(offset);
+  auto const last = find_offset(offset + removed);
+  auto const region_start = first.start;
+  auto const region_end = last.start + last.node->length + inserted - removed;
+
+  auto [before, rest] = split(m_root, first.line);
+  auto [replaced, after] = split(rest, last.line - first.line + 1);
+
+  // the region ends with the '\n' of its last line, unless it was the last
+  // line of the text, in which case what follows is still a line.
+  auto lines = build(text, region_start, region_end - region_start, !after);
+  m_root = treap::merge(treap::merge(std::move(before), std::move(lines)),
+                        std::move(after));
+}
+
+} // namespace documents
@@ -0,0 +1,105 @@
+#pragma once
+#include <documents/rope.h>
+#include <documents/treap.h>
+#include <atomic>
+#include <rpc/lsp.h>
+#include <vector>
+
+namespace documents {
+
+// Where each line of a document starts, to translate between LSP positions
+// (line, UTF-16 code unit) and the byte offsets used by the rope and the
+// compiler.
+//
+// Lines are the nodes of a treap keyed implicitly by line number, with the
+// byte lengths summed up the tree. A line start is then the sum of the
+// lengths before it, so an edit only rescans the lines it touches and the
+// starts of the lines after it shift without being visited.
+//
+// Lines made only of ASCII bytes are flagged, since for those a column is
+// the same in bytes and in UTF-16 code units. Other lines get a column table
+// built the first time they are asked about.
+//
+// Like `Rope`, line indexes are persistent and cheap to copy. Lookups don't
+// modify anything but the column tables, which are published atomically, so
+// they're safe to run from any number of threads.
+class LineIndex {
+public:
+  LineIndex();
+  explicit LineIndex(Rope const &text);
+
+  u64 line_count() const noexcept { return count_of(m_root.get()); }
+
+  // Lines past the end resolve to the end of the text, and characters past
+  // the end of a line to the end of the line.
+  u64 offset_of(Rope const &text, rpc::lsp::Position position) const;
+  // Offsets inside a multi-byte character resolve to the next character.
+  rpc::lsp::Position position_of(Rope const &text, u64 offset) const;
+
+  // Updates the index after `removed` bytes at `offset` were replaced with
+  // `inserted` bytes. `text` is the already edited text.
+  void edit(Rope const &text, u64 offset, u64 removed, u64 inserted);
+
+private:
+  struct Node {
+    // bytes in the line, including its '\n' if it has one
+    u64 length;
+    bool ascii;
+    // lines and bytes in this subtree
+    u64 count;
+    u64 size;
+    u32 priority;
+    std::shared_ptr<Node const> left, right;
+    // see `columns`. Built by whichever reader needs it first.
+    mutable std::atomic<std::vector<u32> const *> columns = nullptr;
+
+    Node() = default;
+    // the copy builds its own columns, to not share their ownership.
+    Node(Node const &other) noexcept
+        : length(other.length), ascii(other.ascii), count(other.count),
+          size(other.size), priority(other.priority), left(other.left),
+          right(other.right) {}
+    ~Node() { delete columns.load(std::memory_order_relaxed); }
+
+    void update() noexcept {
+      count = count_of(left.get()) + 1 + count_of(right.get());
+      size = size_of(left.get()) + length + size_of(right.get());
+    }
+  };
+  using NodePtr = std::shared_ptr<Node const>;
+
+  // A line found in the tree, with its number and where it starts.
+  struct Found {
+    Node const *node;
+    u64 line;
+    u64 start;
+  };
+
+  static u64 count_of(Node const *node) noexcept {
+    return node ? node->count : 0;
+  }
+  static u64 size_of(Node const *node) noexcept {
+    return node ? node->size : 0;
+  }
+
+  Found find_line(u64 line) const noexcept;
+  // The last line contains the end of the text.
+  Found find_offset(u64 offset) const noexcept;
+  // Byte end of `found`, without its line terminator.
+  u64 line_end(Found const &found) const noexcept;
+  // Byte offset from the line start of every UTF-16 code unit in `found`,
+  // plus one past the end.
+  std::vector<u32> const &columns(Rope const &text, Found const &found) const;
+
+  // Builds the lines of [offset, offset + count) in `text`. The bytes after
+  // the last '\n' make up a last line, even if empty, when `keep_tail`.
+  NodePtr build(Rope const &text, u64 offset, u64 count, bool keep_tail);
+  // Splits into the first `count` lines and the rest.
+  static std::pair<NodePtr, NodePtr> split(NodePtr const &node, u64 count);
+
+  // before `m_root`, which is built with it.
+  treap::Priorities m_priorities;
+  NodePtr m_root;
+};
+
+} // namespace documents
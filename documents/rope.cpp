@@ -0,0 +1,157 @@
+#include <documents/rope.h>
+#include <vector>
+
+namespace documents {
+
+Rope::Rope(std::string_view text) : m_root(build(text)) {}
+
+auto Rope::make_node(std::string chunk) -> std::shared_ptr<Node> {
+  auto node = std::make_shared<Node>();
+  node->chunk = std::make_shared<std::string const>(std::move(chunk));
+  node->priority = m_priorities.next();
+  node->update();
+  return node;
+}
+
+auto Rope::build(std::string_view text) -> NodePtr {
+  std::vector<std::shared_ptr<Node>> nodes;
+  nodes.reserve((text.size() + MAX_CHUNK - 1) / MAX_CHUNK);
+  while (!text.empty()) {
+    auto const length = std::min<u64>(text.size(), MAX_CHUNK);
+    nodes.emplace_back(make_node(std::string(text.substr(0, length))));
+    text.remove_prefix(length);
+  }
+  return treap::build(std::move(nodes));
+}
+
+auto Rope::split(NodePtr const &node, u64 offset)
+    -> std::pair<NodePtr, NodePtr> {
+  // splitting at either end keeps the whole subtree as is.
+  if (!node || offset == 0)
+    return {nullptr, node};
+  if (offset >= node->size)
+    return {node, nullptr};
+
+  auto const left_size = size_of(node->left.get());
+  auto const chunk_end = left_size + node->chunk->size();
+  auto copy = std::make_shared<Node>(*node);
+  if (offset <= left_size) {
+    auto [left, right] = split(node->left, offset);
+    copy->left = std::move(right);
+    copy->update();
+    return {std::move(left), std::move(copy)};
+  }
+  if (offset >= chunk_end) {
+    auto [left, right] = split(node->right, offset - chunk_end);
+    copy->right = std::move(left);
+    copy->update();
+    return {std::move(copy), std::move(right)};
+  }
+
+  // `offset` is inside this chunk: the tail becomes its own node, merged
+  // back so that it respects the heap order of what was our right subtree.
+  auto const cut = offset - left_size;
+  NodePtr tail = make_node(node->chunk->substr(cut));
+  copy->chunk =
+      std::make_shared<std::string const>(node->chunk->substr(0, cut));
+  copy->right = nullptr;
+  copy->update();
+  return {std::move(copy), treap::merge(std::move(tail), node->right)};
+}
+
+auto Rope::insert_in_place(Node const *node, u64 offset,
+                           std::string_view text) -> NodePtr {
+  if (!node)
+    return nullptr;
+  auto const left_size = size_of(node->left.get());
+  auto const chunk_end = left_size + node->chunk->size();
+  auto copy = std::make_shared<Node>(*node);
+  if (offset < left_size) {
+    copy->left = insert_in_place(node->left.get(), offset, text);
+    if (!copy->left)
+      return nullptr;
+  } else if (offset > chunk_end) {
+    copy->right = insert_in_place(node->right.get(), offset - chunk_end, text);
+    if (!copy->right)
+      return nullptr;
+  } else if (node->chunk->size() + text.size() <= MAX_CHUNK) {
+    auto chunk = *node->chunk;
+    chunk.insert(offset - left_size, text);
+    copy->chunk = std::make_shared<std::string const>(std::move(chunk));
+  } else {
+    return nullptr;
+  }
+  copy->update();
+  return copy;
+}
+
+auto Rope::erase_in_place(Node const *node, u64 offset, u64 count)
+    -> NodePtr {
+  if (!node)
+    return nullptr;
+  auto const left_size = size_of(node->left.get());
+  auto const chunk_end = left_size + node->chunk->size();
+  auto copy = std::make_shared<Node>(*node);
+  if (offset < left_size) {
+    copy->left = erase_in_place(node->left.get(), offset, count);
+    if (!copy->left)
+      return nullptr;
+  } else if (offset >= chunk_end) {
+    copy->right = erase_in_place(node->right.get(), offset - chunk_end, count);
+    if (!copy->right)
+      return nullptr;
+  } else if (offset + count <= chunk_end && count < node->chunk->size()) {
+    // only when the chunk survives, to not leave empty nodes behind.
+    auto chunk = *node->chunk;
+    chunk.erase(offset - left_size, count);
+    copy->chunk = std::make_shared<std::string const>(std::move(chunk));
+  } else {
+    return nullptr;
+  }
+  copy->update();
+  return copy;
+}
+
+void Rope::insert(u64 offset, std::string_view text) {
+  if (text.empty())
+    return;
+  offset = std::min(offset, size());
+  if (auto root = insert_in_place(m_root.get(), offset, text); root) {
+    m_root = std::move(root);
+    return;
+  }
+  auto [left, right] = split(m_root, offset);
+  m_root = treap::merge(treap::merge(std::move(left), build(text)),
+                        std::move(right));
+}
+
+void Rope::erase(u64 offset, u64 count) {
+  offset = std::min(offset, size());
+  count = std::min(count, size() - offset);
+  if (count == 0)
+    return;
+  if (auto root = erase_in_place(m_root.get(), offset, count); root) {
+    m_root = std::move(root);
+    return;
+  }
+  auto [left, rest] = split(m_root, offset);
+  auto [erased, right] = split(rest, count);
+  m_root = treap::merge(std::move(left), std::move(right));
+}
+
+void Rope::replace(u64 offset, u64 count, std::string_view text) {
+  erase(offset, count);
+  insert(offset, text);
+}
+
+std::string Rope::substr(u64 offset, u64 count) const {
+  std::string out;
+  out.reserve(std::min(count, size()));
+  visit_chunks(offset, count, [&](std::string_view chunk) {
+    out.append(chunk);
+    return true;
+  });
+  return out;
+}
+
+} // namespace documents
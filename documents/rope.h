@@ -0,0 +1,108 @@
+#pragma once
+#include "numbers.h"
+#include <algorithm>
+#include <documents/treap.h>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace documents {
+
+// Text of a document as UTF-8 bytes, split in chunks of at most `MAX_CHUNK`
+// bytes. Chunks are the nodes of a treap keyed implicitly by byte offset, so
+// inserting or erasing a range costs O(log n) instead of a copy of the whole
+// text.
+//
+// Ropes are persistent: copying one is O(1), and edits on the copy share
+// every node and chunk they don't touch with the original.
+class Rope {
+public:
+  static constexpr u64 MAX_CHUNK = 1024;
+
+  Rope() noexcept = default;
+  explicit Rope(std::string_view text);
+
+  u64 size() const noexcept { return size_of(m_root.get()); }
+  bool empty() const noexcept { return size() == 0; }
+
+  // `offset` and `offset + count` are clamped to `size()`.
+  void insert(u64 offset, std::string_view text);
+  void erase(u64 offset, u64 count);
+  void replace(u64 offset, u64 count, std::string_view text);
+
+  std::string substr(u64 offset, u64 count) const;
+  std::string to_string() const { return substr(0, size()); }
+
+  // Calls `visit(std::string_view)` for every chunk overlapping
+  // [offset, offset + count), in order, with the chunks trimmed to the range.
+  // Stops early if `visit` returns false.
+  template <typename Visitor>
+  void visit_chunks(u64 offset, u64 count, Visitor &&visit) const {
+    visit_chunks(m_root.get(), offset, count, visit);
+  }
+
+private:
+  struct Node {
+    std::shared_ptr<std::string const> chunk;
+    // total bytes in this subtree
+    u64 size;
+    u32 priority;
+    std::shared_ptr<Node const> left, right;
+
+    void update() noexcept {
+      size = size_of(left.get()) + chunk->size() + size_of(right.get());
+    }
+  };
+  using NodePtr = std::shared_ptr<Node const>;
+
+  static u64 size_of(Node const *node) noexcept {
+    return node ? node->size : 0;
+  }
+
+  template <typename Visitor>
+  static bool visit_chunks(Node const *node, u64 offset, u64 count,
+                           Visitor &visit) {
+    if (!node || count == 0)
+      return true;
+    auto const left_size = size_of(node->left.get());
+    auto const chunk_end = left_size + node->chunk->size();
+    if (offset < left_size) {
+      auto const taken = std::min(count, left_size - offset);
+      if (!visit_chunks(node->left.get(), offset, taken, visit))
+        return false;
+      offset += taken;
+      count -= taken;
+    }
+    if (count != 0 && offset < chunk_end) {
+      auto const view =
+          std::string_view(*node->chunk).substr(offset - left_size, count);
+      if (!visit(view))
+        return false;
+      offset += view.size();
+      count -= view.size();
+    }
+    if (count == 0)
+      return true;
+    return visit_chunks(node->right.get(), offset - chunk_end, count, visit);
+  }
+
+  std::shared_ptr<Node> make_node(std::string chunk);
+  // Builds a treap out of `text` in linear time.
+  NodePtr build(std::string_view text);
+  // Splits into [0, offset) and [offset, size), cutting a chunk in two if
+  // `offset` falls inside of it.
+  std::pair<NodePtr, NodePtr> split(NodePtr const &node, u64 offset);
+  // Inserts into the chunk containing `offset` if it has room for `text`.
+  // Returns the new tree, or nothing if it didn't fit.
+  static NodePtr insert_in_place(Node const *node, u64 offset,
+                                 std::string_view text);
+  // Erases from a single chunk if the range doesn't cross chunk boundaries.
+  // Returns the new tree, or nothing if it did.
+  static NodePtr erase_in_place(Node const *node, u64 offset, u64 count);
+
+  // before `m_root`, which is built with it.
+  treap::Priorities m_priorities;
+  NodePtr m_root;
+};
+
+} // namespace documents
@@ -0,0 +1,88 @@
+#include <documents/store.h>
+#include <memory/accounting.h>
+
+namespace documents {
+
+bool Store::open(workspace::FileId file, i64 version, std::string_view text) {
+  memory::Tagged tagged(memory::Subsystem::Documents);
+  Rope rope(text);
+  LineIndex lines(rope);
+  syntax::Tokens tokens(rope);
+  auto const [found, inserted] = m_documents.try_emplace(
+      file, std::make_shared<Snapshot const>(
+                Snapshot{version, std::move(rope), std::move(lines),
+                         std::move(tokens)}));
+  if (inserted)
+    m_usage += usage_of(*found->second);
+  return inserted;
+}
+
+bool Store::change(
+    workspace::FileId file, i64 version,
+    std::vector<rpc::lsp::TextDocumentContentChangeEvent> const &changes) {
+  memory::Tagged tagged(memory::Subsystem::Documents);
+  auto const found = m_documents.find(file);
+  if (found == m_documents.end())
+    return false;
+
+  // start from the current version; copies share all of its nodes.
+  auto text = found->second->text;
+  auto lines = found->second->lines;
+  auto tokens = found->second->tokens;
+  for (auto const &change : changes) {
+    auto const bytes = json::to_utf8(change.text);
+    if (!change.range) {
+      text = Rope(bytes);
+      lines = LineIndex(text);
+      tokens = syntax::Tokens(text);
+      continue;
+    }
+    auto const start = lines.offset_of(text, change.range->start);
+    auto const end = std::max(start, lines.offset_of(text, change.range->end));
+    text.replace(start, end - start, bytes);
+    lines.edit(text, start, end - start, bytes.size());
+    tokens.edit(text, start, end - start, bytes.size());
+  }
+
+  m_usage -= usage_of(*found->second);
+  found->second = std::make_shared<Snapshot const>(Snapshot{
+      version, std::move(text), std::move(lines), std::move(tokens)});
+  m_usage += usage_of(*found->second);
+  return true;
+}
+
+bool Store::close(workspace::FileId file) noexcept {
+  auto const found = m_documents.find(file);
+  if (found == m_documents.end())
+    return false;
+  m_usage -= usage_of(*found->second);
+  m_documents.erase(found);
+  return true;
+}
+
+SnapshotPtr Store::find(workspace::FileId file) const noexcept {
+  auto const found = m_documents.find(file);
+  return found == m_documents.end() ? nullptr : found->second;
+}
+
+std::vector<workspace::FileId> Store::files() const {
+  std::vector<workspace::FileId> files;
+  files.reserve(m_documents.size());
+  for (auto const &[file, snapshot] : m_documents)
+    files.push_back(file);
+  return files;
+}
+
+u64 Store::usage_of(Snapshot const &snapshot) noexcept {
+  // text plus a rough per line and per chunk cost for the tree nodes, and
+  // the packed tokens.
+  static constexpr u64 LINE_COST = 96;
+  static constexpr u64 CHUNK_COST = 128;
+  static constexpr u64 TOKEN_COST = 12;
+  auto const bytes = snapshot.text.size();
+  return bytes + snapshot.lines.line_count() * LINE_COST +
+         (bytes / Rope::MAX_CHUNK + 1) * CHUNK_COST +
+         snapshot.tokens.size() * TOKEN_COST;
+}
+
+} // namespace documents
@@ -0,0 +1,64 @@
+#pragma once
+#include "json.h"
+#include <documents/line_index.h>
+#include <documents/rope.h>
+#include <memory>
+#include <memory/budget.h>
+#include <rpc/lsp.h>
+#include <syntax/tokens.h>
+#include <unordered_map>
+#include <workspace/file_ids.h>
+
+namespace documents {
+
+// A version of an open document. Snapshots are never modified: every change
+// makes a new one, which shares with the previous version everything the
+// change didn't touch. Handing one to a worker is then a reference count
+// increment, and it stays consistent however many changes arrive while the
+// worker uses it. A version is freed when its last holder drops it.
+struct Snapshot {
+  i64 version;
+  Rope text;
+  LineIndex lines;
+  syntax::Tokens tokens;
+};
+using SnapshotPtr = std::shared_ptr<Snapshot const>;
+
+// Documents the client has opened, keyed by file id. With incremental sync,
+// each `textDocument/didChange` only carries the edited ranges, which are
+// applied on the rope without touching the rest of the document.
+//
+// The store belongs to the main thread, which is the one applying changes.
+// Workers never look into it: they get the snapshot they work on pinned when
+// their task is created.
+//
+// Open documents count against the memory budget, but are never evicted.
+class Store : public memory::Consumer {
+  std::unordered_map<workspace::FileId, SnapshotPtr> m_documents;
+  // of the latest versions, as `usage_of` counts them
+  u64 m_usage = 0;
+
+  static u64 usage_of(Snapshot const &snapshot) noexcept;
+
+public:
+  // Returns false if the document was already open.
+  bool open(workspace::FileId file, i64 version, std::string_view text);
+  // Applies `changes` in order and publishes the result as `version`.
+  // Returns false if the document isn't open.
+  bool change(workspace::FileId file, i64 version,
+              std::vector<rpc::lsp::TextDocumentContentChangeEvent> const
+                  &changes);
+  // Returns false if the document wasn't open.
+  bool close(workspace::FileId file) noexcept;
+
+  // The latest version of `file`, or nothing if it isn't open.
+  SnapshotPtr find(workspace::FileId file) const noexcept;
+  // Every open document, in no particular order.
+  std::vector<workspace::FileId> files() const;
+
+  // memory::Consumer
+  std::string_view name() const noexcept override { return "documents"; }
+  u64 usage() const noexcept override { return m_usage; }
+};
+
+} // namespace documents
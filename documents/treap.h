@@ -0,0 +1,83 @@
+#pragma once
+#include "numbers.h"
+#include <memory>
+#include <vector>
+
+// Helpers shared by the implicitly keyed treaps of this directory. Nodes
+// need a `priority`, `left` and `right` children and an `update()` that
+// recomputes their subtree aggregates from the children.
+//
+// The treaps are persistent: a node is never modified once it's part of a
+// tree, so that copies of a tree share all of their nodes. Operations copy
+// the path down to what they change instead, which keeps them O(log n).
+namespace documents::treap {
+
+// xorshift64, good enough to keep the treaps balanced.
+class Priorities {
+  u64 m_seed = 0x9e3779b97f4a7c15;
+
+public:
+  u32 next() noexcept {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 7;
+    m_seed ^= m_seed << 17;
+    return static_cast<u32>(m_seed >> 32);
+  }
+};
+
+template <typename Node>
+std::shared_ptr<Node const> merge(std::shared_ptr<Node const> left,
+                                  std::shared_ptr<Node const> right) {
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+  if (left->priority > right->priority) {
+    auto copy = std::make_shared<Node>(*left);
+    copy->right = merge(left->right, std::move(right));
+    copy->update();
+    return copy;
+  }
+  auto copy = std::make_shared<Node>(*right);
+  copy->left = merge(std::move(left), right->left);
+  copy->update();
+  return copy;
+}
+
+// Builds a treap out of `nodes`, keeping their order, in linear time.
+template <typename Node>
+std::shared_ptr<Node const> build(std::vector<std::shared_ptr<Node>> nodes) {
+  if (nodes.empty())
+    return nullptr;
+
+  // Cartesian tree construction: keep the right spine in a stack, popping
+  // the nodes with lower priority than the new one into its left child.
+  static constexpr u64 none = ~u64(0);
+  std::vector<u64> left(nodes.size(), none), right(nodes.size(), none);
+  std::vector<u64> spine;
+  for (u64 i = 0; i != nodes.size(); ++i) {
+    auto last = none;
+    while (!spine.empty() &&
+           nodes[spine.back()]->priority < nodes[i]->priority) {
+      last = spine.back();
+      spine.pop_back();
+    }
+    left[i] = last;
+    if (!spine.empty())
+      right[spine.back()] = i;
+    spine.push_back(i);
+  }
+
+  auto const attach = [&](auto &self, u64 index) -> std::shared_ptr<Node> {
+    auto node = std::move(nodes[index]);
+    if (left[index] != none)
+      node->left = self(self, left[index]);
+    if (right[index] != none)
+      node->right = self(self, right[index]);
+    node->update();
+    return node;
+  };
+  return attach(attach, spine.front());
+}
+
+} // namespace documents::treap
@@ -0,0 +1,134 @@
+#include <features/completion.h>
+#include <syntax/lexer.h>
+
+namespace features {
+
+namespace {
+// how far back a word is looked for.
+constexpr u64 MAX_WORD = 256;
+
+bool is_word(char c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+} // namespace
+
+auto Completions::word_at(documents::Snapshot const &snapshot,
+                          rpc::lsp::Position position) -> std::optional<Word> {
+  auto const offset = snapshot.lines.offset_of(snapshot.text, position);
+  auto const before_start = offset - std::min(offset, MAX_WORD);
+  auto const before = snapshot.text.substr(before_start, offset - before_start);
+  auto start = before.size();
+  while (start != 0 && is_word(before[start - 1]))
+    --start;
+  // numbers aren't completed.
+  if (start != before.size() && before[start] >= '0' && before[start] <= '9')
+    return std::nullopt;
+
+  auto const after = snapshot.text.substr(offset, MAX_WORD);
+  u64 end = 0;
+  while (end != after.size() && is_word(after[end]))
+    ++end;
+  auto prefix = before.substr(start);
+  return Word{snapshot.lines.position_of(snapshot.text, before_start + start),
+              prefix, prefix + after.substr(0, end)};
+}
+
+rpc::lsp::CompletionList Completions::rank(Entry const &entry,
+                                           std::string_view prefix) {
+  rpc::lsp::CompletionList list{false, {}};
+  auto const ranked = entry.names.rank(matching::Pattern(prefix), LIMIT);
+  list.is_incomplete = ranked.size() == LIMIT;
+  list.items.reserve(ranked.size());
+  for (auto const &[index, score] : ranked)
+    list.items.push_back(
+        {json::from_utf8(entry.names[index]), entry.kinds[index]});
+  return list;
+}
+
+std::optional<rpc::lsp::CompletionList>
+Completions::complete(workspace::FileId file,
+                      documents::Snapshot const &snapshot,
+                      rpc::lsp::Position position) const {
+  auto const found = m_entries.find(file);
+  if (!found || found->version != snapshot.version)
+    return std::nullopt;
+  auto const word = word_at(snapshot, position);
+  if (!word)
+    return rpc::lsp::CompletionList{false, {}};
+  auto const &start = found->start;
+  if (word->start.line != start.line ||
+      word->start.character != start.character)
+    return std::nullopt;
+  m_entries.use(file, now());
+  return rank(*found, word->prefix);
+}
+
+rpc::lsp::CompletionList
+Completions::gather(workspace::FileId file,
+                    documents::Snapshot const &snapshot,
+                    rpc::lsp::Position position,
+                    symbols::References const &references) {
+  auto const word = word_at(snapshot, position);
+  if (!word) {
+    m_entries.erase(file);
+    return {false, {}};
+  }
+
+  Entry entry{snapshot.version, word->start, {}, {}};
+  using Kind = rpc::lsp::CompletionItemKind;
+  for (auto keyword = static_cast<u8>(syntax::Keyword::None) + 1;
+       keyword <= static_cast<u8>(syntax::Keyword::Yield); ++keyword) {
+    entry.names.add(syntax::spelling(static_cast<syntax::Keyword>(keyword)));
+    entry.kinds.push_back(Kind::Keyword);
+  }
+  // the word being typed is only a name if it's used elsewhere too.
+  auto const typed = references.find(word->whole).size() <= 1;
+  references.visit_names([&](std::string const &name) {
+    if (typed && name == word->whole)
+      return;
+    entry.names.add(name);
+    entry.kinds.push_back(Kind::Text);
+  });
+
+  auto list = rank(entry, word->prefix);
+  auto const usage = sizeof(Entry) + entry.names.usage() +
+                     entry.kinds.capacity() * sizeof(Kind);
+  m_entries.put(file, std::move(entry), usage, now());
+  return list;
+}
+
+void Completions::change(
+    workspace::FileId file, i64 version,
+    std::vector<rpc::lsp::TextDocumentContentChangeEvent> const
+        &changes) noexcept {
+  auto const found = m_entries.find(file);
+  if (!found)
+    return;
+  auto const &start = found->start;
+  for (auto const &change : changes) {
+    auto const &range = change.range;
+    if (!range || range->start.line != start.line ||
+        range->end.line != start.line ||
+        range->start.character < start.character ||
+        change.text.find(u'\n') != json::string::npos) {
+      m_entries.erase(file);
+      return;
+    }
+  }
+  found->version = version;
+}
+
+std::optional<u64> Completions::oldest(bool open_too) const noexcept {
+  auto const entry = oldest_of(m_entries, open_too);
+  if (!entry)
+    return std::nullopt;
+  return entry->last_used;
+}
+
+void Completions::evict_oldest(bool open_too) noexcept {
+  if (auto const entry = oldest_of(m_entries, open_too))
+    m_entries.erase(entry->file);
+}
+
+} // namespace features
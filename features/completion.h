@@ -0,0 +1,74 @@
+#pragma once
+#include <documents/store.h>
+#include <matching/fuzzy.h>
+#include <memory/budget.h>
+#include <optional>
+#include <rpc/lsp.h>
+#include <symbols/references.h>
+
+namespace features {
+
+// textDocument/completion: keywords and the names used across the workspace,
+// ranked by fuzzy match against the part of the word typed before the
+// cursor.
+//
+// Candidates are gathered when a word is started, and kept while it's being
+// typed: each further keystroke only ranks them again for the longer prefix.
+// They belong to the document version they were gathered on and to the
+// versions derived from it by edits within the line of the word, after its
+// start. Any other edit drops them.
+class Completions : public memory::Consumer {
+public:
+  // Items returned at most. More matches make the list incomplete, for the
+  // client to ask again as the prefix grows.
+  static constexpr u64 LIMIT = 100;
+
+  // Completes from the candidates gathered for the word at `position`, if
+  // they're still there.
+  std::optional<rpc::lsp::CompletionList>
+  complete(workspace::FileId file, documents::Snapshot const &snapshot,
+           rpc::lsp::Position position) const;
+  // Gathers the candidates for the word at `position` from `references`,
+  // then completes.
+  rpc::lsp::CompletionList gather(workspace::FileId file,
+                                  documents::Snapshot const &snapshot,
+                                  rpc::lsp::Position position,
+                                  symbols::References const &references);
+
+  // Follows `file` to `version`, dropping its candidates unless `changes`
+  // keep them valid.
+  void change(workspace::FileId file, i64 version,
+              std::vector<rpc::lsp::TextDocumentContentChangeEvent> const
+                  &changes) noexcept;
+  void close(workspace::FileId file) noexcept { m_entries.erase(file); }
+
+  // memory::Consumer
+  std::string_view name() const noexcept override { return "completions"; }
+  u64 usage() const noexcept override { return m_entries.usage(); }
+  std::optional<u64> oldest(bool open_too) const noexcept override;
+  void evict_oldest(bool open_too) noexcept override;
+
+private:
+  struct Entry {
+    i64 version;
+    // where the word starts
+    rpc::lsp::Position start;
+    matching::Candidates names;
+    std::vector<rpc::lsp::CompletionItemKind> kinds;
+  };
+  // The word being typed at `position`: where it starts, what's typed of it
+  // and the whole of it.
+  struct Word {
+    rpc::lsp::Position start;
+    std::string prefix;
+    std::string whole;
+  };
+  static std::optional<Word> word_at(documents::Snapshot const &snapshot,
+                                     rpc::lsp::Position position);
+  static rpc::lsp::CompletionList rank(Entry const &entry,
+                                       std::string_view prefix);
+
+  memory::Cache<Entry> m_entries;
+};
+
+} // namespace features
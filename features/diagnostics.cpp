@@ -0,0 +1,352 @@
+#include <features/diagnostics.h>
+#include <features/source.h>
+#include <fmt/format.h>
+#include <iterator>
+#include <syntax/outline.h>
+#include <unordered_set>
+#include <workspace/file_ids.h>
+#include <workspace/hash.h>
+#include <workspace/mapped_file.h>
+
+namespace features {
+
+namespace {
+using rpc::lsp::Diagnostic;
+using rpc::lsp::DiagnosticSeverity;
+using syntax::TokenKind;
+
+bool is_bracket(TokenKind kind) noexcept {
+  return kind == TokenKind::OpenParen || kind == TokenKind::CloseParen ||
+         kind == TokenKind::OpenBrace || kind == TokenKind::CloseBrace ||
+         kind == TokenKind::OpenBracket || kind == TokenKind::CloseBracket;
+}
+
+bool is_opening(TokenKind kind) noexcept {
+  return kind == TokenKind::OpenParen || kind == TokenKind::OpenBrace ||
+         kind == TokenKind::OpenBracket;
+}
+
+// Whether a string or character literal, prefix included, ends with its
+// closing quote, as the lexer reads escapes.
+bool is_terminated(std::string_view literal) noexcept {
+  auto const open = literal.find_first_of("\"'");
+  if (open == std::string_view::npos)
+    return false;
+  for (auto i = open + 1; i < literal.size(); ++i) {
+    if (literal[i] == literal[open])
+      return i + 1 == literal.size();
+    if (literal[i] == '\\')
+      ++i;
+  }
+  return false;
+}
+
+// `spell()` reads the token, for the kinds that need it.
+template <typename Spell>
+std::optional<std::u16string_view> problem_of(TokenKind kind,
+                                              Spell const &spell) {
+  switch (kind) {
+  case TokenKind::Unknown:
+    return u"unexpected character";
+  case TokenKind::String:
+    if (!is_terminated(spell()))
+      return u"unterminated string literal";
+    return std::nullopt;
+  case TokenKind::Character:
+    if (!is_terminated(spell()))
+      return u"unterminated character literal";
+    return std::nullopt;
+  case TokenKind::Comment:
+    if (auto const comment = spell();
+        comment.starts_with("/*") &&
+        (comment.size() < 4 || !comment.ends_with("*/")))
+      return u"unterminated block comment";
+    return std::nullopt;
+  default:
+    return std::nullopt;
+  }
+}
+
+std::u16string bracket_problem(syntax::Token const &token,
+                               std::string const &spelling) {
+  return (is_opening(token.kind) ? u"unclosed '" : u"unmatched '") +
+         json::from_utf8(spelling) + u"'";
+}
+
+u64 digest_of(std::vector<Diagnostic> const &items) {
+  std::string bytes;
+  for (auto const &item : items) {
+    fmt::format_to(std::back_inserter(bytes), "{}:{}-{}:{} {} ",
+                   item.range.start.line, item.range.start.character,
+                   item.range.end.line, item.range.end.character,
+                   static_cast<i64>(item.severity));
+    bytes += json::to_utf8(item.message);
+    bytes += '\n';
+  }
+  return workspace::hash_bytes(bytes);
+}
+
+auto report_of(u64 hash, std::vector<Diagnostic> items)
+    -> Diagnostics::Report {
+  auto const digest = digest_of(items);
+  return {hash, json::from_utf8(fmt::format("{:016x}{:016x}", hash, digest)),
+          std::move(items), digest};
+}
+
+
+std::vector<Diagnostic> check_of(Source const &source) {
+  // brackets the outline left out are the unmatched ones.
+  auto const outline = source.outline();
+  std::unordered_set<u64> matched;
+  for (auto const bracket : outline.brackets) {
+    matched.insert(bracket.open);
+    matched.insert(bracket.close);
+  }
+
+  std::vector<Diagnostic> diagnostics;
+  auto const add = [&](syntax::Token const &token, std::u16string message) {
+    diagnostics.push_back({source.range_of(token.start, token.end()),
+                           DiagnosticSeverity::Error, std::move(message)});
+  };
+  source.visit_tokens([&](syntax::Token const &token) {
+    if (is_bracket(token.kind)) {
+      if (!matched.contains(token.start))
+        add(token, bracket_problem(token, source.substr(token.start, 1)));
+    } else if (auto const problem = problem_of(token.kind, [&] {
+                 return source.substr(token.start, token.length);
+               })) {
+      add(token, std::u16string(*problem));
+    }
+  });
+  return diagnostics;
+}
+} // namespace
+
+std::vector<Diagnostic> check(documents::Snapshot const &snapshot) {
+  return check_of(Source(snapshot));
+}
+
+std::vector<Diagnostic> check(std::string_view text) {
+  return check_of(Source(text));
+}
+
+u64 Diagnostics::usage_of(Report const &report) noexcept {
+  u64 usage = sizeof(Report) + report.result_id.size() * 2;
+  for (auto const &item : report.items)
+    usage += sizeof(item) + item.message.capacity() * 2;
+  return usage;
+}
+
+std::vector<Diagnostic>
+Diagnostics::check_blocks(Document &document,
+                          documents::Snapshot const &snapshot) {
+  auto const &text = snapshot.text;
+  auto const &tokens = snapshot.tokens;
+  std::unordered_map<void const *, Findings> blocks;
+  std::vector<Problem> problems;
+  std::vector<syntax::Token> brackets;
+  for (u64 block = 0; block != tokens.blocks(); ++block) {
+    auto id = tokens.block_id(block);
+    auto const start = tokens.block_start(block);
+    Findings findings{id, {}, {}};
+    if (auto const found = document.blocks.find(id.get());
+        found != document.blocks.end()) {
+      findings = std::move(found->second);
+      document.blocks.erase(found);
+    } else {
+      tokens.visit_block(block, [&](syntax::Token token) {
+        auto const problem = problem_of(token.kind, [&] {
+          return text.substr(token.start, token.length);
+        });
+        token.start -= start;
+        if (is_bracket(token.kind))
+          findings.brackets.push_back(token);
+        else if (problem)
+          findings.problems.push_back({token, *problem});
+      });
+    }
+    for (auto problem : findings.problems) {
+      problem.token.start += start;
+      problems.push_back(problem);
+    }
+    for (auto bracket : findings.brackets) {
+      bracket.start += start;
+      brackets.push_back(bracket);
+    }
+    blocks.emplace(id.get(), std::move(findings));
+  }
+  document.blocks = std::move(blocks);
+
+  // in the order of their tokens, as `check` has them.
+  std::vector<Diagnostic> diagnostics;
+  auto const add = [&](syntax::Token const &token, std::u16string message) {
+    diagnostics.push_back({{snapshot.lines.position_of(text, token.start),
+                            snapshot.lines.position_of(text, token.end())},
+                           DiagnosticSeverity::Error,
+                           std::move(message)});
+  };
+  auto const matched = syntax::matched_brackets(brackets);
+  auto problem = problems.begin();
+  for (u64 i = 0; i != brackets.size(); ++i) {
+    if (matched[i])
+      continue;
+    for (; problem != problems.end() &&
+           problem->token.start < brackets[i].start;
+         ++problem)
+      add(problem->token, std::u16string(problem->message));
+    add(brackets[i], bracket_problem(brackets[i],
+                                     text.substr(brackets[i].start, 1)));
+  }
+  for (; problem != problems.end(); ++problem)
+    add(problem->token, std::u16string(problem->message));
+  return diagnostics;
+}
+
+auto Diagnostics::document_of(workspace::FileId file) -> Document & {
+  auto const [found, inserted] = m_documents.try_emplace(file);
+  if (inserted)
+    m_usage += 2 * usage_of(found->second.report);
+  return found->second;
+}
+
+void Diagnostics::set_report(Document &document, Report report) {
+  m_usage -= 2 * usage_of(document.report);
+  document.report = std::move(report);
+  m_usage += 2 * usage_of(document.report);
+}
+
+void Diagnostics::update(Document &document,
+                         documents::Snapshot const &snapshot) {
+  document.version = snapshot.version;
+  workspace::Hasher hasher;
+  snapshot.text.visit_chunks(0, snapshot.text.size(),
+                             [&](std::string_view chunk) {
+                               hasher.add(chunk);
+                               return true;
+                             });
+  auto const hash = hasher.finish();
+  // an edit may well be undone.
+  if (document.report.hash == hash && !document.report.result_id.empty())
+    return;
+  document.syntax = check_blocks(document, snapshot);
+  auto items = document.syntax;
+  items.insert(items.end(), document.compiled.begin(), document.compiled.end());
+  set_report(document, report_of(hash, std::move(items)));
+}
+
+auto Diagnostics::open(workspace::FileId file,
+                       documents::Snapshot const &snapshot) -> Report {
+  std::lock_guard lock(m_mutex);
+  auto &document = document_of(file);
+  update(document, snapshot);
+  return document.report;
+}
+
+auto Diagnostics::document(workspace::FileId file,
+                           documents::Snapshot const &snapshot) -> Report {
+  std::lock_guard lock(m_mutex);
+  auto &document = document_of(file);
+  if (document.version != snapshot.version ||
+      document.report.result_id.empty())
+    update(document, snapshot);
+  return document.report;
+}
+
+auto Diagnostics::compiled(workspace::FileId file,
+                           documents::Snapshot const &snapshot,
+                           std::vector<Diagnostic> items)
+    -> std::optional<Report> {
+  std::lock_guard lock(m_mutex);
+  auto const found = m_documents.find(file);
+  if (found == m_documents.end() || found->second.version > snapshot.version)
+    return std::nullopt;
+  auto &document = found->second;
+  update(document, snapshot);
+  auto const digest = document.report.digest;
+  document.compiled = std::move(items);
+  auto all = document.syntax;
+  all.insert(all.end(), document.compiled.begin(), document.compiled.end());
+  set_report(document, report_of(document.report.hash, std::move(all)));
+  if (document.report.digest == digest)
+    return std::nullopt;
+  return document.report;
+}
+
+auto Diagnostics::file(workspace::FileId file) -> std::optional<Report> {
+  auto const &path = workspace::file_ids().path(file);
+  if (!path)
+    return std::nullopt;
+  auto stamp = symbols::Stamp::stat(*path);
+  std::lock_guard lock(m_mutex);
+  if (!stamp) {
+    m_files.erase(file);
+    return std::nullopt;
+  }
+  auto const found = m_files.find(file);
+  if (found && found->stamp.same_times(*stamp)) {
+    m_files.use(file, now());
+    return found->report;
+  }
+
+  std::optional<Report> report;
+  workspace::with_mapped_file(*path, [&](std::string_view bytes) {
+    stamp->hash = workspace::hash_bytes(bytes);
+    if (found && found->stamp.hash == stamp->hash)
+      report = std::move(found->report);
+    else
+      report = report_of(stamp->hash, check(bytes));
+    return true;
+  });
+  if (!report) {
+    m_files.erase(file);
+    return std::nullopt;
+  }
+  m_files.put(file, File{*stamp, *report}, sizeof(File) + usage_of(*report),
+              now());
+  return report;
+}
+
+bool Diagnostics::publish(workspace::FileId file, Report const &report) {
+  std::lock_guard lock(m_mutex);
+  auto const published = m_published.find(file);
+  if (published == m_published.end() ? report.items.empty()
+                                      : published->second == report.digest)
+    return false;
+  m_published.insert_or_assign(file, report.digest);
+  return true;
+}
+
+bool Diagnostics::close(workspace::FileId file) noexcept {
+  std::lock_guard lock(m_mutex);
+  if (auto const found = m_documents.find(file); found != m_documents.end()) {
+    m_usage -= 2 * usage_of(found->second.report);
+    m_documents.erase(found);
+  }
+  auto const published = m_published.find(file);
+  if (published == m_published.end())
+    return false;
+  auto const shown = published->second != digest_of({});
+  m_published.erase(published);
+  return shown;
+}
+
+u64 Diagnostics::usage() const noexcept {
+  std::lock_guard lock(m_mutex);
+  return m_published.size() * 24 + m_usage + m_files.usage();
+}
+
+std::optional<u64> Diagnostics::oldest(bool open_too) const noexcept {
+  std::lock_guard lock(m_mutex);
+  auto const entry = oldest_of(m_files, open_too);
+  if (!entry)
+    return std::nullopt;
+  return entry->last_used;
+}
+
+void Diagnostics::evict_oldest(bool open_too) noexcept {
+  std::lock_guard lock(m_mutex);
+  if (auto const entry = oldest_of(m_files, open_too))
+    m_files.erase(entry->file);
+}
+
+} // namespace features
@@ -0,0 +1,123 @@
+#pragma once
+#include <documents/store.h>
+#include <memory>
+#include <memory/budget.h>
+#include <mutex>
+#include <rpc/lsp.h>
+#include <string_view>
+#include <symbols/disk_index.h>
+#include <syntax/lexer.h>
+#include <unordered_map>
+
+namespace features {
+
+// Problems found in a document without the compiler: bytes that don't start
+// any token, unterminated literals and comments, and unmatched brackets.
+std::vector<rpc::lsp::Diagnostic> check(documents::Snapshot const &snapshot);
+std::vector<rpc::lsp::Diagnostic> check(std::string_view text);
+
+// textDocument/diagnostic, workspace/diagnostic and
+// textDocument/publishDiagnostics
+//
+// Reports are kept by file with the hash of the content they were made
+// from: a file whose content didn't change isn't checked again. Result ids
+// are that hash and a hash of the diagnostics, so a client that already has
+// the result id gets an `unchanged` report. Published reports are
+// remembered by the hash of their diagnostics, so that the same ones are
+// never sent twice.
+//
+// Open documents are checked again from the blocks of their tokens, which
+// edits share with the previous version: only the blocks an edit relexed
+// are looked at again, and then brackets matched across all. They also have
+// what the compiler found in them, which is kept until the next compile is
+// done: it lags behind edits, and dropping it on every one would make it
+// flicker. Compiles are finished from the scheduler's threads, so
+// everything here locks.
+class Diagnostics : public memory::Consumer {
+public:
+  struct Report {
+    // of the content
+    u64 hash;
+    json::string result_id;
+    std::vector<rpc::lsp::Diagnostic> items;
+    // of `items`
+    u64 digest;
+  };
+
+  // Starts keeping the diagnostics of a document, until it's closed.
+  Report open(workspace::FileId file, documents::Snapshot const &snapshot);
+  // Of an open document, checked again only if its content changed.
+  Report document(workspace::FileId file, documents::Snapshot const &snapshot);
+  // Replaces what the compiler found in a document, returning its report
+  // then. Nothing if that changed no diagnostic, or if the document was
+  // closed or is newer than `snapshot`.
+  std::optional<Report> compiled(workspace::FileId file,
+                                 documents::Snapshot const &snapshot,
+                                 std::vector<rpc::lsp::Diagnostic> items);
+  // Of a file on the disk, read again only if its size or modification time
+  // changed. Nothing if it can't be read.
+  std::optional<Report> file(workspace::FileId file);
+
+  // Whether the diagnostics of `report` differ from the last ones published
+  // for `file` (none at first), which they then become.
+  bool publish(workspace::FileId file, Report const &report);
+  // Forgets the document, returning whether its last published report had
+  // diagnostics, which the client then still shows.
+  bool close(workspace::FileId file) noexcept;
+
+  // memory::Consumer
+  std::string_view name() const noexcept override { return "diagnostics"; }
+  u64 usage() const noexcept override;
+  // Reports of files on the disk are evicted, to be read again when asked
+  // for; those of open documents stay until closed.
+  std::optional<u64> oldest(bool open_too) const noexcept override;
+  void evict_oldest(bool open_too) noexcept override;
+
+private:
+  // What the tokens of a block tell on their own, by offset from its start:
+  // the problems of single tokens, and the brackets, which are matched
+  // across blocks.
+  struct Problem {
+    syntax::Token token;
+    std::u16string_view message;
+  };
+  struct Findings {
+    // of the block, which keeps it from being reused
+    std::shared_ptr<void const> id;
+    std::vector<Problem> problems;
+    std::vector<syntax::Token> brackets;
+  };
+  struct Document {
+    i64 version;
+    std::vector<rpc::lsp::Diagnostic> syntax;
+    std::vector<rpc::lsp::Diagnostic> compiled;
+    Report report;
+    // by block id, as of `version`
+    std::unordered_map<void const *, Findings> blocks;
+  };
+  struct File {
+    symbols::Stamp stamp;
+    Report report;
+  };
+
+  static u64 usage_of(Report const &report) noexcept;
+  // The document of `file`, counted in `m_usage` if new.
+  Document &document_of(workspace::FileId file);
+  // Replaces the report of `document`, keeping `m_usage` up to date.
+  void set_report(Document &document, Report report);
+  // Brings `document` to `snapshot`, with `m_mutex` held.
+  void update(Document &document, documents::Snapshot const &snapshot);
+  // `check(snapshot)`, from the blocks `document` had in common with it.
+  static std::vector<rpc::lsp::Diagnostic>
+  check_blocks(Document &document, documents::Snapshot const &snapshot);
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<workspace::FileId, Document> m_documents;
+  memory::Cache<File> m_files;
+  // of the reports of `m_documents`, which are kept twice
+  u64 m_usage = 0;
+  // by file, the digest of the last diagnostics published, if any
+  std::unordered_map<workspace::FileId, u64> m_published;
+};
+
+} // namespace features
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <features/outline.h>
+#include <features/references.h>
+#include <syntax/outline.h>
+
+namespace features {
+
+namespace {
+using rpc::lsp::SymbolKind;
+
+rpc::lsp::Range range_of(documents::Snapshot const &snapshot, u64 start,
+                         u64 end) {
+  return {snapshot.lines.position_of(snapshot.text, start),
+          snapshot.lines.position_of(snapshot.text, end)};
+}
+
+u64 line_of(documents::Snapshot const &snapshot, u64 offset) {
+  return snapshot.lines.position_of(snapshot.text, offset).line;
+}
+
+SymbolKind symbol_kind(syntax::DeclarationKind kind, bool is_member) {
+  switch (kind) {
+  case syntax::DeclarationKind::Function:
+    return is_member ? SymbolKind::Method : SymbolKind::Function;
+  case syntax::DeclarationKind::Struct:
+    return SymbolKind::Struct;
+  case syntax::DeclarationKind::Class:
+    return SymbolKind::Class;
+  case syntax::DeclarationKind::Enum:
+    return SymbolKind::Enum;
+  case syntax::DeclarationKind::Namespace:
+    return SymbolKind::Namespace;
+  case syntax::DeclarationKind::Trait:
+    return SymbolKind::Interface;
+  case syntax::DeclarationKind::Field:
+    return SymbolKind::Field;
+  case syntax::DeclarationKind::Variant:
+    return SymbolKind::EnumMember;
+  }
+  return SymbolKind::Variable;
+}
+
+bool is_type(syntax::DeclarationKind kind) {
+  return kind == syntax::DeclarationKind::Struct ||
+         kind == syntax::DeclarationKind::Class ||
+         kind == syntax::DeclarationKind::Enum ||
+         kind == syntax::DeclarationKind::Trait;
+}
+
+std::vector<rpc::lsp::DocumentSymbol>
+symbols_of(documents::Snapshot const &snapshot,
+           std::vector<syntax::Declaration> const &declarations,
+           bool in_type) {
+  std::vector<rpc::lsp::DocumentSymbol> symbols;
+  symbols.reserve(declarations.size());
+  for (auto const &declaration : declarations) {
+    symbols.push_back(
+        {json::from_utf8(declaration.name),
+         symbol_kind(declaration.kind, in_type),
+         range_of(snapshot, declaration.start, declaration.end),
+         range_of(snapshot, declaration.name_start, declaration.name_end),
+         symbols_of(snapshot, declaration.children,
+                    is_type(declaration.kind))});
+  }
+  return symbols;
+}
+
+void flatten(Source const &source,
+             std::vector<syntax::Declaration> const &declarations,
+             syntax::Declaration const *parent,
+             std::vector<symbols::Symbol> &symbols) {
+  for (auto const &declaration : declarations) {
+    auto const in_type = parent && is_type(parent->kind);
+    symbols.push_back(
+        {declaration.name, symbol_kind(declaration.kind, in_type),
+         source.range_of(declaration.name_start, declaration.name_end),
+         parent ? parent->name : std::string()});
+    flatten(source, declaration.children, &declaration, symbols);
+  }
+}
+
+symbols::FileIndex index_of(Source const &source) {
+  auto const outline = source.outline();
+  symbols::FileIndex indexed;
+  flatten(source, outline.declarations, nullptr, indexed.symbols);
+  indexed.references = occurrences(source, outline.declarations);
+  return indexed;
+}
+
+// Adds the byte ranges of the declarations around `offset`, outermost
+// first.
+void declarations_around(std::vector<syntax::Declaration> const &declarations,
+                         u64 offset,
+                         std::vector<std::pair<u64, u64>> &ranges) {
+  for (auto const &declaration : declarations) {
+    if (offset < declaration.start || offset > declaration.end)
+      continue;
+    ranges.emplace_back(declaration.start, declaration.end);
+    if (offset >= declaration.name_start && offset <= declaration.name_end)
+      ranges.emplace_back(declaration.name_start, declaration.name_end);
+    declarations_around(declaration.children, offset, ranges);
+  }
+}
+} // namespace
+
+std::vector<rpc::lsp::DocumentSymbol>
+document_symbols(documents::Snapshot const &snapshot) {
+  auto const outline = syntax::outline(snapshot.text, snapshot.tokens);
+  return symbols_of(snapshot, outline.declarations, false);
+}
+
+symbols::FileIndex index(documents::Snapshot const &snapshot) {
+  return index_of(Source(snapshot));
+}
+
+symbols::FileIndex index(std::string_view text) {
+  return index_of(Source(text));
+}
+
+std::vector<rpc::lsp::FoldingRange>
+folding_ranges(documents::Snapshot const &snapshot) {
+  using rpc::lsp::FoldingRangeKind;
+  std::vector<rpc::lsp::FoldingRange> ranges;
+
+  // the closing bracket stays visible.
+  auto const outline = syntax::outline(snapshot.text, snapshot.tokens);
+  for (auto const &bracket : outline.brackets) {
+    auto const start = line_of(snapshot, bracket.open);
+    auto const end = line_of(snapshot, bracket.close);
+    if (end > start + 1)
+      ranges.push_back({start, end - 1, std::nullopt});
+  }
+
+  // runs of lines starting with a line comment or an import.
+  struct Run {
+    FoldingRangeKind kind;
+    u64 start, end;
+  };
+  std::optional<Run> run;
+  auto const flush = [&] {
+    if (run && run->end > run->start)
+      ranges.push_back({run->start, run->end, run->kind});
+    run.reset();
+  };
+  u64 previous_line = ~u64(0);
+  auto const &text = snapshot.text;
+  snapshot.tokens.visit(0, text.size(), [&](syntax::Token const &token) {
+    auto const line = line_of(snapshot, token.start);
+    auto const first_on_line = line != previous_line;
+    previous_line = line_of(snapshot, token.end());
+    // block comments spanning lines
+    if (token.kind == syntax::TokenKind::Comment && previous_line > line)
+      ranges.push_back({line, previous_line, FoldingRangeKind::Comment});
+    if (!first_on_line)
+      return true;
+
+    std::optional<FoldingRangeKind> kind;
+    if (token.kind == syntax::TokenKind::Comment &&
+        text.substr(token.start, 2) == "//")
+      kind = FoldingRangeKind::Comment;
+    else if (token.keyword == syntax::Keyword::Import)
+      kind = FoldingRangeKind::Imports;
+    if (kind && run && run->kind == *kind && run->end + 1 == line) {
+      run->end = line;
+      return true;
+    }
+    flush();
+    if (kind)
+      run = Run{*kind, line, line};
+    return true;
+  });
+  flush();
+
+  // one range per start line, the largest.
+  std::sort(ranges.begin(), ranges.end(), [](auto const &a, auto const &b) {
+    return a.start_line != b.start_line ? a.start_line < b.start_line
+                                        : a.end_line > b.end_line;
+  });
+  ranges.erase(std::unique(ranges.begin(), ranges.end(),
+                           [](auto const &a, auto const &b) {
+                             return a.start_line == b.start_line;
+                           }),
+               ranges.end());
+  return ranges;
+}
+
+std::vector<rpc::lsp::SelectionRange>
+selection_ranges(documents::Snapshot const &snapshot,
+                 std::vector<rpc::lsp::Position> const &positions) {
+  auto const outline = syntax::outline(snapshot.text, snapshot.tokens);
+  std::vector<rpc::lsp::SelectionRange> selections;
+  selections.reserve(positions.size());
+  for (auto const &position : positions) {
+    auto const offset = snapshot.lines.offset_of(snapshot.text, position);
+    std::vector<std::pair<u64, u64>> ranges{{0, snapshot.text.size()}};
+
+    // with the cursor right after a token, that token is the one meant.
+    auto token = snapshot.tokens.at(offset);
+    if (!token && offset > 0)
+      token = snapshot.tokens.at(offset - 1);
+    if (token)
+      ranges.emplace_back(token->start, token->end());
+
+    for (auto const &bracket : outline.brackets) {
+      if (bracket.open >= offset)
+        break;
+      if (bracket.close < offset)
+        continue;
+      ranges.emplace_back(bracket.open, bracket.close + 1);
+      if (bracket.close > bracket.open + 1)
+        ranges.emplace_back(bracket.open + 1, bracket.close);
+    }
+    declarations_around(outline.declarations, offset, ranges);
+
+    // innermost first, and every range must contain the previous one.
+    std::sort(ranges.begin(), ranges.end(), [](auto const &a, auto const &b) {
+      return a.second - a.first < b.second - b.first;
+    });
+    rpc::lsp::SelectionRange selection;
+    std::pair<u64, u64> last{offset, offset};
+    for (auto const &range : ranges) {
+      if (range.first > last.first || range.second < last.second ||
+          (range == last && !selection.ranges.empty()))
+        continue;
+      selection.ranges.push_back(range_of(snapshot, range.first, range.second));
+      last = range;
+    }
+    selections.push_back(std::move(selection));
+  }
+  return selections;
+}
+
+} // namespace features
@@ -0,0 +1,31 @@
+#pragma once
+#include <documents/store.h>
+#include <rpc/lsp.h>
+#include <symbols/references.h>
+#include <vector>
+
+// Answers to LSP requests, computed from document snapshots.
+namespace features {
+
+// textDocument/documentSymbol
+std::vector<rpc::lsp::DocumentSymbol>
+document_symbols(documents::Snapshot const &snapshot);
+
+// textDocument/foldingRange: bodies and other brackets spanning lines, block
+// comments and runs of line comments or imports.
+std::vector<rpc::lsp::FoldingRange>
+folding_ranges(documents::Snapshot const &snapshot);
+
+// textDocument/selectionRange: from the token at each position, out through
+// the brackets and declarations around it, to the whole document.
+std::vector<rpc::lsp::SelectionRange>
+selection_ranges(documents::Snapshot const &snapshot,
+                 std::vector<rpc::lsp::Position> const &positions);
+
+// What the workspace indexes of a document: its declarations, flattened for
+// the workspace symbol index, and where every name is used.
+symbols::FileIndex index(documents::Snapshot const &snapshot);
+// The same for a file that isn't open.
+symbols::FileIndex index(std::string_view text);
+
+} // namespace features
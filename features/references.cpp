@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <features/references.h>
+#include <workspace/file_ids.h>
+
+namespace features {
+
+namespace {
+// Where each of `declarations` has its name, and whether it's a member.
+void add_declarations(std::vector<syntax::Declaration> const &declarations,
+                      bool in_type,
+                      std::vector<std::pair<u64, symbols::Role>> &starts) {
+  using syntax::DeclarationKind;
+  for (auto const &declaration : declarations) {
+    starts.push_back({declaration.name_start,
+                      in_type ? symbols::Role::MemberDeclaration
+                              : symbols::Role::Declaration});
+    auto const kind = declaration.kind;
+    add_declarations(declaration.children,
+                     kind == DeclarationKind::Struct ||
+                         kind == DeclarationKind::Class ||
+                         kind == DeclarationKind::Enum ||
+                         kind == DeclarationKind::Trait,
+                     starts);
+  }
+}
+
+// The innermost of `declarations` around `offset`, if any.
+syntax::Declaration const *
+innermost(std::vector<syntax::Declaration> const &declarations, u64 offset) {
+  for (auto const &declaration : declarations)
+    if (declaration.start <= offset && offset < declaration.end) {
+      auto const inner = innermost(declaration.children, offset);
+      return inner ? inner : &declaration;
+    }
+  return nullptr;
+}
+
+bool before(rpc::lsp::Position a, rpc::lsp::Position b) noexcept {
+  return a.line < b.line || (a.line == b.line && a.character < b.character);
+}
+
+bool is_word(char c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+} // namespace
+
+symbols::Shard
+occurrences(Source const &source,
+            std::vector<syntax::Declaration> const &declarations) {
+  using symbols::Role;
+  using syntax::TokenKind;
+  std::vector<std::pair<u64, Role>> starts;
+  add_declarations(declarations, false, starts);
+  std::sort(starts.begin(), starts.end());
+
+  // the brackets open around the current token: parentheses, those of a
+  // parameter list, or any other.
+  enum class Open : u8 { Parentheses, Parameters, Other };
+  std::vector<Open> open;
+  // whether the next parentheses are a parameter list, after `fn`
+  auto parameters = false;
+  // whether the parameter being read is `anon`
+  auto anonymous = false;
+  std::optional<syntax::Token> previous;
+  // of the identifier right before, which a `:` may tell more about
+  symbols::Occurrence *last = nullptr;
+
+  symbols::Shard shard;
+  source.visit_tokens([&](syntax::Token const &token) {
+    if (token.kind == TokenKind::Comment)
+      return;
+    if (last && token.kind == TokenKind::Colon && !open.empty()) {
+      if (open.back() == Open::Parameters && !anonymous &&
+          (last->role == Role::Use || last->role == Role::Binding))
+        last->role = Role::Parameter;
+      else if (open.back() == Open::Parentheses && last->role == Role::Use)
+        last->role = Role::Label;
+    }
+    last = nullptr;
+
+    switch (token.kind) {
+    case TokenKind::OpenParen:
+      open.push_back(parameters ? Open::Parameters : Open::Parentheses);
+      parameters = anonymous = false;
+      break;
+    case TokenKind::OpenBrace:
+    case TokenKind::OpenBracket:
+      open.push_back(Open::Other);
+      parameters = false;
+      break;
+    case TokenKind::CloseParen:
+    case TokenKind::CloseBrace:
+    case TokenKind::CloseBracket:
+      if (!open.empty())
+        open.pop_back();
+      break;
+    case TokenKind::Comma:
+      anonymous = false;
+      break;
+    case TokenKind::Keyword:
+      if (token.keyword == syntax::Keyword::Fn ||
+          token.keyword == syntax::Keyword::Function)
+        parameters = true;
+      else if (token.keyword == syntax::Keyword::Anon)
+        anonymous = true;
+      break;
+    case TokenKind::Identifier: {
+      auto role = Role::Use;
+      auto const declaration = std::lower_bound(
+          starts.begin(), starts.end(), std::pair{token.start, Role::Use});
+      if (declaration != starts.end() && declaration->first == token.start)
+        role = declaration->second;
+      else if (previous && previous->kind == TokenKind::Dot)
+        role = Role::Member;
+      else if (previous && (previous->keyword == syntax::Keyword::Let ||
+                            previous->keyword == syntax::Keyword::Mut ||
+                            previous->keyword == syntax::Keyword::For))
+        role = Role::Binding;
+      auto &occurrences = shard[source.substr(token.start, token.length)];
+      occurrences.push_back({source.range_of(token.start, token.end()), role});
+      last = &occurrences.back();
+      break;
+    }
+    default:
+      break;
+    }
+    previous = token;
+  });
+  return shard;
+}
+
+std::optional<std::string> name_at(documents::Snapshot const &snapshot,
+                                   rpc::lsp::Position position) {
+  auto const offset = snapshot.lines.offset_of(snapshot.text, position);
+  auto token = snapshot.tokens.at(offset);
+  // the cursor may be right after the name.
+  if ((!token || token->kind != syntax::TokenKind::Identifier) && offset != 0)
+    token = snapshot.tokens.at(offset - 1);
+  if (!token || token->kind != syntax::TokenKind::Identifier)
+    return std::nullopt;
+  return snapshot.text.substr(token->start, token->length);
+}
+
+bool is_identifier(std::string_view name) noexcept {
+  return !name.empty() && !(name[0] >= '0' && name[0] <= '9') &&
+         std::all_of(name.begin(), name.end(), is_word) &&
+         syntax::keyword_of(name) == syntax::Keyword::None;
+}
+
+std::vector<symbols::References::Location>
+uses(symbols::References const &references, workspace::FileId file,
+     documents::Snapshot const &snapshot, rpc::lsp::Position position,
+     std::string const &name) {
+  auto found = references.find(name);
+  if (std::any_of(found.begin(), found.end(), [](auto const &location) {
+        return location.occurrence.declares();
+      }))
+    return found;
+
+  auto const &text = snapshot.text;
+  auto const outline = syntax::outline(text, snapshot.tokens);
+  auto const scope = innermost(outline.declarations,
+                               snapshot.lines.offset_of(text, position));
+  auto const start =
+      scope ? snapshot.lines.position_of(text, scope->start)
+            : rpc::lsp::Position{0, 0};
+  auto const end = snapshot.lines.position_of(text, scope ? scope->end
+                                                          : text.size());
+  std::erase_if(found, [&](auto const &location) {
+    auto const &range = location.occurrence.range;
+    return location.file != file || before(range.start, start) ||
+           before(end, range.end);
+  });
+  return found;
+}
+
+std::vector<rpc::lsp::Location>
+references(std::vector<symbols::References::Location> const &uses,
+           bool include_declaration) {
+  std::vector<rpc::lsp::Location> locations;
+  for (auto const &[file, occurrence] : uses)
+    if (include_declaration || !occurrence.declares())
+      locations.push_back(
+          {workspace::file_ids().uri(file), occurrence.range});
+  return locations;
+}
+
+std::optional<std::vector<symbols::References::Location>>
+renamed(symbols::References const &references, workspace::FileId file,
+        documents::Snapshot const &snapshot, rpc::lsp::Position position,
+        std::string const &name) {
+  using symbols::Role;
+  auto found = uses(references, file, snapshot, position, name);
+  auto const at =
+      std::find_if(found.begin(), found.end(), [&](auto const &location) {
+        auto const &range = location.occurrence.range;
+        return location.file == file && !before(position, range.start) &&
+               !before(range.end, position);
+      });
+  if (at == found.end())
+    return std::nullopt;
+  auto const role_of = [](auto const &location) {
+    return location.occurrence.role;
+  };
+
+  auto const declarations =
+      std::count_if(found.begin(), found.end(), [](auto const &location) {
+        return location.occurrence.declares();
+      });
+  if (declarations > 1)
+    return std::nullopt;
+  // every use must then be of the one declaration, which members, bindings
+  // and parameters spelled the same may not be.
+  if (declarations == 1) {
+    if (std::any_of(found.begin(), found.end(), [&](auto const &location) {
+          auto const role = role_of(location);
+          return role != Role::Use && role != Role::Declaration;
+        }))
+      return std::nullopt;
+    return found;
+  }
+
+  // a local name, which members and labels spelled the same aren't. Calls
+  // pass parameters by name, from anywhere.
+  if (role_of(*at) == Role::Member || role_of(*at) == Role::Label ||
+      std::any_of(found.begin(), found.end(), [&](auto const &location) {
+        return role_of(location) == Role::Parameter;
+      }))
+    return std::nullopt;
+  std::erase_if(found, [&](auto const &location) {
+    return role_of(location) == Role::Member ||
+           role_of(location) == Role::Label;
+  });
+  return found;
+}
+
+rpc::lsp::WorkspaceEdit
+rename(std::vector<symbols::References::Location> const &uses,
+       json::string const &new_name) {
+  // locations come grouped by file.
+  rpc::lsp::WorkspaceEdit edit;
+  std::optional<workspace::FileId> previous;
+  for (auto const &[file, occurrence] : uses) {
+    if (file != previous)
+      edit.changes.emplace_back(workspace::file_ids().uri(file),
+                                std::vector<rpc::lsp::TextEdit>());
+    previous = file;
+    edit.changes.back().second.push_back({occurrence.range, new_name});
+  }
+  return edit;
+}
+
+} // namespace features
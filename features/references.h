@@ -0,0 +1,63 @@
+#pragma once
+#include <documents/store.h>
+#include <features/source.h>
+#include <optional>
+#include <rpc/lsp.h>
+#include <string>
+#include <symbols/references.h>
+#include <syntax/outline.h>
+
+namespace features {
+
+// Where every name is used in a document, for `symbols::References`.
+//
+// Uses are found by name, from the tokens alone: every identifier spelled
+// the same is taken as the same symbol, whatever it resolves to. The tokens
+// around each tell its role, which `renamed` is careful with.
+symbols::Shard
+occurrences(Source const &source,
+            std::vector<syntax::Declaration> const &declarations);
+
+// The identifier at `position`, or right before it.
+std::optional<std::string> name_at(documents::Snapshot const &snapshot,
+                                   rpc::lsp::Position position);
+
+// Whether `name` could be given to a declaration.
+bool is_identifier(std::string_view name) noexcept;
+
+// Where the name at `position` of `file` is used.
+//
+// A name that some file of the workspace declares (a function, a type, a
+// field...) is taken as that declaration wherever it's spelled the same.
+// Any other name is local, such as a variable or a parameter, and is only
+// looked for in the document, within the innermost declaration around
+// `position`: the function it's used in, usually.
+std::vector<symbols::References::Location>
+uses(symbols::References const &references, workspace::FileId file,
+     documents::Snapshot const &snapshot, rpc::lsp::Position position,
+     std::string const &name);
+
+// textDocument/references
+std::vector<rpc::lsp::Location>
+references(std::vector<symbols::References::Location> const &uses,
+           bool include_declaration);
+
+// Of `uses`, those that renaming the name at `position` of `file` changes,
+// or nothing if the tokens alone can't tell which they are.
+//
+// A name declared once is renamed everywhere, unless it's a member or it's
+// also spelled as one, as a binding or as a parameter, which may well be
+// other symbols. A local name is renamed within its declaration, unless it's
+// a parameter, since calls pass those by name. Names declared more than once
+// are never renamed.
+std::optional<std::vector<symbols::References::Location>>
+renamed(symbols::References const &references, workspace::FileId file,
+        documents::Snapshot const &snapshot, rpc::lsp::Position position,
+        std::string const &name);
+
+// textDocument/rename
+rpc::lsp::WorkspaceEdit
+rename(std::vector<symbols::References::Location> const &uses,
+       json::string const &new_name);
+
+} // namespace features
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <features/semantic_tokens.h>
+#include <string>
+#include <syntax/outline.h>
+
+namespace features {
+
+namespace {
+// What the declarations of a document make of their names.
+using Types = std::unordered_map<std::string, TokenType>;
+
+TokenType type_of(syntax::DeclarationKind kind, bool in_type) noexcept {
+  switch (kind) {
+  case syntax::DeclarationKind::Function:
+    return in_type ? TokenType::Method : TokenType::Function;
+  case syntax::DeclarationKind::Struct:
+    return TokenType::Struct;
+  case syntax::DeclarationKind::Class:
+    return TokenType::Class;
+  case syntax::DeclarationKind::Enum:
+    return TokenType::Enum;
+  case syntax::DeclarationKind::Namespace:
+    return TokenType::Namespace;
+  case syntax::DeclarationKind::Trait:
+    return TokenType::Interface;
+  case syntax::DeclarationKind::Field:
+    return TokenType::Property;
+  case syntax::DeclarationKind::Variant:
+    return TokenType::EnumMember;
+  }
+  return TokenType::Variable;
+}
+
+bool is_type(syntax::DeclarationKind kind) noexcept {
+  return kind == syntax::DeclarationKind::Struct ||
+         kind == syntax::DeclarationKind::Class ||
+         kind == syntax::DeclarationKind::Enum ||
+         kind == syntax::DeclarationKind::Trait;
+}
+
+// The first declaration of a name gives it its type.
+void add_types(std::vector<syntax::Declaration> const &declarations,
+               bool in_type, Types &types, std::vector<u64> &names) {
+  for (auto const &declaration : declarations) {
+    types.try_emplace(declaration.name, type_of(declaration.kind, in_type));
+    names.push_back(declaration.name_start);
+    add_types(declaration.children, is_type(declaration.kind), types, names);
+  }
+}
+
+std::optional<TokenType> lexical_type(syntax::TokenKind kind) noexcept {
+  using syntax::TokenKind;
+  switch (kind) {
+  case TokenKind::Keyword:
+    return TokenType::Keyword;
+  case TokenKind::Number:
+    return TokenType::Number;
+  case TokenKind::String:
+  case TokenKind::Character:
+    return TokenType::String;
+  case TokenKind::Comment:
+    return TokenType::Comment;
+  case TokenKind::Operator:
+  case TokenKind::Arrow:
+  case TokenKind::FatArrow:
+    return TokenType::Operator;
+  default:
+    return std::nullopt;
+  }
+}
+
+// Appends tokens to the protocol's array, relative to the previous one.
+class Encoder {
+public:
+  explicit Encoder(documents::Snapshot const &snapshot) noexcept
+      : m_snapshot(snapshot) {}
+
+  void add(syntax::Token const &token, TokenType type, u32 modifiers) {
+    auto const &text = m_snapshot.text;
+    auto const &lines = m_snapshot.lines;
+    auto const start = lines.position_of(text, token.start);
+    auto const end = lines.position_of(text, token.end());
+    for (auto line = start.line; line <= end.line; ++line) {
+      auto const first = line == start.line ? start.character : 0;
+      auto const last =
+          line == end.line
+              ? end.character
+              : lines.position_of(text, lines.offset_of(text, {line, ~u64(0)}))
+                    .character;
+      if (last > first)
+        push(line, first, last - first, type, modifiers);
+    }
+  }
+
+  std::vector<u32> take() && { return std::move(m_data); }
+
+private:
+  void push(u64 line, u64 character, u64 length, TokenType type,
+            u32 modifiers) {
+    auto const delta_line = line - m_line;
+    auto const delta_character =
+        delta_line == 0 ? character - m_character : character;
+    m_data.insert(m_data.end(),
+                  {static_cast<u32>(delta_line),
+                   static_cast<u32>(delta_character),
+                   static_cast<u32>(length), static_cast<u32>(type),
+                   modifiers});
+    m_line = line;
+    m_character = character;
+  }
+
+  documents::Snapshot const &m_snapshot;
+  std::vector<u32> m_data;
+  u64 m_line = 0;
+  u64 m_character = 0;
+};
+
+json::string id_string(u64 id) { return json::from_utf8(std::to_string(id)); }
+} // namespace
+
+std::vector<u32> encode_tokens(documents::Snapshot const &snapshot, u64 start,
+                               u64 end) {
+  auto const outline = syntax::outline(snapshot.text, snapshot.tokens);
+  Types types;
+  std::vector<u64> names;
+  add_types(outline.declarations, false, types, names);
+  std::sort(names.begin(), names.end());
+
+  std::vector<syntax::Token> tokens;
+  snapshot.tokens.visit(start, end - std::min(start, end),
+                        [&](syntax::Token const &token) {
+                          if (token.start >= start)
+                            tokens.push_back(token);
+                          return true;
+                        });
+  // a call can't be told without the token after the last one.
+  std::optional<syntax::Token> after;
+  snapshot.tokens.visit(end, 1, [&](syntax::Token const &token) {
+    if (token.start >= end)
+      after = token;
+    return false;
+  });
+
+  Encoder encoder(snapshot);
+  for (u64 i = 0; i != tokens.size(); ++i) {
+    auto const &token = tokens[i];
+    if (token.kind != syntax::TokenKind::Identifier) {
+      if (auto const type = lexical_type(token.kind))
+        encoder.add(token, *type, 0);
+      continue;
+    }
+    auto type = TokenType::Variable;
+    auto const found =
+        types.find(snapshot.text.substr(token.start, token.length));
+    auto const next = i + 1 != tokens.size() ? tokens[i + 1] : after;
+    if (found != types.end())
+      type = found->second;
+    else if (next && next->kind == syntax::TokenKind::OpenParen)
+      type = TokenType::Function;
+    auto const declaration =
+        std::binary_search(names.begin(), names.end(), token.start);
+    encoder.add(token, type,
+                declaration ? static_cast<u32>(TokenModifier::Declaration)
+                            : 0);
+  }
+  return std::move(encoder).take();
+}
+
+auto SemanticTokens::update(workspace::FileId file,
+                            documents::Snapshot const &snapshot)
+    -> Result const & {
+  auto const used = now();
+  if (auto const result = m_results.find(file);
+      result && result->version == snapshot.version) {
+    m_results.use(file, used);
+    return *result;
+  }
+  Result result{m_next_id++, snapshot.version, {}};
+  auto const adopted = m_adopted.find(file);
+  if (adopted && adopted->version == snapshot.version)
+    result.data = std::move(adopted->data);
+  else
+    result.data = encode_tokens(snapshot, 0, snapshot.text.size());
+  m_adopted.erase(file);
+  auto const usage = usage_of(result);
+  return m_results.put(file, std::move(result), usage, used);
+}
+
+void SemanticTokens::adopt(workspace::FileId file, i64 version,
+                           std::vector<u32> data) {
+  Result result{0, version, std::move(data)};
+  auto const usage = usage_of(result);
+  m_adopted.put(file, std::move(result), usage, now());
+}
+
+rpc::lsp::SemanticTokens
+SemanticTokens::full(workspace::FileId file,
+                     documents::Snapshot const &snapshot) {
+  auto const &result = update(file, snapshot);
+  return {id_string(result.id), result.data};
+}
+
+std::variant<rpc::lsp::SemanticTokens, rpc::lsp::SemanticTokensDelta>
+SemanticTokens::delta(workspace::FileId file,
+                      documents::Snapshot const &snapshot,
+                      json::string const &previous) {
+  auto const found = m_results.find(file);
+  if (!found || id_string(found->id) != previous)
+    return full(file, snapshot);
+  auto const old = found->data;
+  auto const &result = update(file, snapshot);
+  auto const &data = result.data;
+
+  // edits are kept to whole tokens.
+  auto const common = std::min(old.size(), data.size());
+  auto prefix = static_cast<u64>(
+      std::mismatch(old.begin(), old.begin() + common, data.begin()).first -
+      old.begin());
+  prefix -= prefix % 5;
+  auto suffix = static_cast<u64>(
+      std::mismatch(old.rbegin(), old.rbegin() + (common - prefix),
+                    data.rbegin())
+          .first -
+      old.rbegin());
+  suffix -= suffix % 5;
+
+  rpc::lsp::SemanticTokensDelta delta{id_string(result.id), {}};
+  if (prefix + suffix != old.size() || prefix + suffix != data.size())
+    delta.edits.push_back(
+        {prefix, old.size() - prefix - suffix,
+         std::vector<u32>(data.begin() + prefix, data.end() - suffix)});
+  return delta;
+}
+
+rpc::lsp::SemanticTokens
+SemanticTokens::range(documents::Snapshot const &snapshot,
+                      rpc::lsp::Range range) {
+  auto const &text = snapshot.text;
+  return {std::nullopt,
+          encode_tokens(snapshot, snapshot.lines.offset_of(text, range.start),
+                        snapshot.lines.offset_of(text, range.end))};
+}
+
+std::optional<u64> SemanticTokens::oldest(bool open_too) const noexcept {
+  std::optional<u64> oldest;
+  for (auto const *results : {&m_results, &m_adopted})
+    if (auto const result = oldest_of(*results, open_too);
+        result && (!oldest || result->last_used < *oldest))
+      oldest = result->last_used;
+  return oldest;
+}
+
+void SemanticTokens::evict_oldest(bool open_too) noexcept {
+  auto const result = oldest_of(m_results, open_too);
+  auto const adopted = oldest_of(m_adopted, open_too);
+  if (adopted && (!result || adopted->last_used < result->last_used))
+    m_adopted.erase(adopted->file);
+  else if (result)
+    m_results.erase(result->file);
+}
+
+} // namespace features
@@ -0,0 +1,96 @@
+#pragma once
+#include <documents/store.h>
+#include <memory/budget.h>
+#include <rpc/lsp.h>
+#include <variant>
+
+namespace features {
+
+// In the order of the legend sent in the server capabilities.
+enum class TokenType : u32 {
+  Namespace,
+  Class,
+  Enum,
+  Interface,
+  Struct,
+  Property,
+  EnumMember,
+  Function,
+  Method,
+  Variable,
+  Keyword,
+  Comment,
+  String,
+  Number,
+  Operator,
+};
+// Bits of the modifiers, in the order of the legend.
+enum class TokenModifier : u32 { Declaration = 1 };
+
+// Encodes the tokens of the document starting in [start, end), in the
+// relative integer format of the protocol. Tokens spanning lines are split,
+// since clients needn't support them.
+//
+// Tokens come from the lexer, and identifiers are typed by what the outline
+// declares with their name in the document: anything else is a function if
+// called, a variable otherwise.
+std::vector<u32> encode_tokens(documents::Snapshot const &snapshot, u64 start,
+                               u64 end);
+
+// textDocument/semanticTokens/{full,full/delta,range}
+//
+// The last result sent for each document is kept with its id, so that a
+// delta request only sends what changed since: the part between the
+// longest common prefix and suffix of the two arrays.
+class SemanticTokens : public memory::Consumer {
+public:
+  rpc::lsp::SemanticTokens full(workspace::FileId file,
+                                documents::Snapshot const &snapshot);
+  // The whole tokens again if `previous` isn't the last result sent.
+  std::variant<rpc::lsp::SemanticTokens, rpc::lsp::SemanticTokensDelta>
+  delta(workspace::FileId file, documents::Snapshot const &snapshot,
+        json::string const &previous);
+  static rpc::lsp::SemanticTokens range(documents::Snapshot const &snapshot,
+                                        rpc::lsp::Range range);
+
+  // Takes tokens encoded ahead of time, for when `version` of `file` is
+  // asked for. They don't replace the last result sent until then, which
+  // deltas are still made from.
+  void adopt(workspace::FileId file, i64 version, std::vector<u32> data);
+
+  void close(workspace::FileId file) noexcept {
+    m_results.erase(file);
+    m_adopted.erase(file);
+  }
+
+  // memory::Consumer
+  std::string_view name() const noexcept override {
+    return "semantic tokens";
+  }
+  u64 usage() const noexcept override {
+    return m_results.usage() + m_adopted.usage();
+  }
+  std::optional<u64> oldest(bool open_too) const noexcept override;
+  void evict_oldest(bool open_too) noexcept override;
+
+private:
+  struct Result {
+    u64 id;
+    i64 version;
+    std::vector<u32> data;
+  };
+  // Encodes the tokens of `snapshot` as a new result, unless the last one is
+  // of the same version.
+  Result const &update(workspace::FileId file,
+                       documents::Snapshot const &snapshot);
+  static u64 usage_of(Result const &result) noexcept {
+    return sizeof(Result) + result.data.capacity() * sizeof(u32);
+  }
+
+  memory::Cache<Result> m_results;
+  // by file, tokens encoded ahead of time, with no id yet
+  memory::Cache<Result> m_adopted;
+  u64 m_next_id = 0;
+};
+
+} // namespace features
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <features/source.h>
+
+namespace features {
+
+Source::Source(std::string_view bytes)
+    : m_size(bytes.size()), m_bytes(bytes), m_tokens(syntax::lex(bytes)) {
+  m_line_starts.push_back(0);
+  auto ascii = true;
+  for (u64 i = 0; i != bytes.size(); ++i) {
+    auto const c = bytes[i];
+    if (c == '\n') {
+      m_ascii.push_back(ascii);
+      m_line_starts.push_back(i + 1);
+      ascii = true;
+    } else if (static_cast<u8>(c) >= 0x80) {
+      ascii = false;
+    }
+  }
+  m_ascii.push_back(ascii);
+}
+
+std::string Source::substr(u64 offset, u64 count) const {
+  if (m_snapshot)
+    return m_snapshot->text.substr(offset, count);
+  return std::string(m_bytes.substr(std::min(offset, m_size), count));
+}
+
+rpc::lsp::Position Source::position_of(u64 offset) const {
+  if (m_snapshot)
+    return m_snapshot->lines.position_of(m_snapshot->text, offset);
+
+  offset = std::min(offset, m_size);
+  auto const line = static_cast<u64>(
+      std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset) -
+      m_line_starts.begin() - 1);
+  auto from = m_line_starts[line];
+  if (m_ascii[line])
+    return {line, offset - from};
+
+  // as `LineIndex` counts them: continuation bytes belong to the code unit
+  // of their lead byte, and 4-byte sequences are two code units.
+  u64 character = 0;
+  if (m_last_position.line == line && m_last_offset <= offset) {
+    from = m_last_offset;
+    character = m_last_position.character;
+  }
+  for (auto i = from; i != offset; ++i) {
+    auto const byte = static_cast<u8>(m_bytes[i]);
+    if ((byte & 0xc0) != 0x80)
+      character += byte >= 0xf0 ? 2 : 1;
+  }
+  m_last_offset = offset;
+  m_last_position = {line, character};
+  return m_last_position;
+}
+
+syntax::Outline Source::outline() const {
+  if (m_snapshot)
+    return syntax::outline(m_snapshot->text, m_snapshot->tokens);
+  return syntax::outline(m_bytes, m_tokens);
+}
+
+} // namespace features
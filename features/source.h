@@ -0,0 +1,60 @@
+#pragma once
+#include "numbers.h"
+#include <documents/store.h>
+#include <rpc/lsp.h>
+#include <string>
+#include <string_view>
+#include <syntax/lexer.h>
+#include <syntax/outline.h>
+#include <vector>
+
+namespace features {
+
+// The text a feature reads, with its tokens and lines: either an open
+// document's snapshot, or the bytes of a file that isn't open. Those are
+// read in place, lexed once and scanned once for their lines, rather than
+// copied into a rope to be edited never.
+class Source {
+public:
+  explicit Source(documents::Snapshot const &snapshot) noexcept
+      : m_snapshot(&snapshot), m_size(snapshot.text.size()) {}
+  // `bytes` must outlive the source.
+  explicit Source(std::string_view bytes);
+
+  u64 size() const noexcept { return m_size; }
+  std::string substr(u64 offset, u64 count) const;
+  rpc::lsp::Position position_of(u64 offset) const;
+  rpc::lsp::Range range_of(u64 start, u64 end) const {
+    return {position_of(start), position_of(end)};
+  }
+  syntax::Outline outline() const;
+
+  // Calls `visit(syntax::Token const &)` for every token, in order.
+  template <typename Visitor> void visit_tokens(Visitor &&visit) const {
+    if (m_snapshot) {
+      m_snapshot->tokens.visit(0, m_size, [&](syntax::Token const &token) {
+        visit(token);
+        return true;
+      });
+      return;
+    }
+    for (auto const &token : m_tokens)
+      visit(token);
+  }
+
+private:
+  documents::Snapshot const *m_snapshot = nullptr;
+  u64 m_size;
+  // the rest is for bytes only
+  std::string_view m_bytes;
+  std::vector<syntax::Token> m_tokens;
+  // by line, where it starts and whether it's only ASCII
+  std::vector<u64> m_line_starts;
+  std::vector<bool> m_ascii;
+  // the last position found in a line that isn't ASCII, which positions
+  // found in order go on from
+  mutable u64 m_last_offset = 0;
+  mutable rpc::lsp::Position m_last_position{~u64(0), 0};
+};
+
+} // namespace features
@@ -0,0 +1,71 @@
+#include <features/outline.h>
+#include <features/semantic_tokens.h>
+#include <features/speculation.h>
+
+namespace features {
+
+Speculation::Speculation(Idle idle, Channel<Speculated> &out)
+    : m_idle(std::move(idle)), m_out(out),
+      m_worker([this](std::stop_token stop) { work(std::move(stop)); }) {}
+
+void Speculation::edited(workspace::FileId file,
+                         documents::SnapshotPtr snapshot) {
+  {
+    std::lock_guard lock(m_mutex);
+    m_file = file;
+    m_snapshot = std::move(snapshot);
+    m_edited_at = std::chrono::steady_clock::now();
+    ++m_generation;
+  }
+  m_edited.notify_one();
+}
+
+void Speculation::close(workspace::FileId file) {
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_file != file)
+      return;
+    m_snapshot.reset();
+    ++m_generation;
+  }
+  m_edited.notify_one();
+}
+
+void Speculation::work(std::stop_token stop) {
+  std::unique_lock lock(m_mutex);
+  while (!stop.stop_requested()) {
+    auto const generation = m_generation;
+    if (!m_snapshot) {
+      m_edited.wait(lock, stop, [&] { return m_generation != generation; });
+      continue;
+    }
+    if (auto const idle_at = m_edited_at + IDLE_AFTER;
+        std::chrono::steady_clock::now() < idle_at) {
+      m_edited.wait_until(lock, stop, idle_at,
+                          [&] { return m_generation != generation; });
+      continue;
+    }
+    auto const file = m_file;
+    auto const snapshot = std::move(m_snapshot);
+    m_snapshot.reset();
+    lock.unlock();
+
+    // each step is only started if no edit came during the one before.
+    auto const dropped = [&] {
+      std::lock_guard lock(m_mutex);
+      return stop.stop_requested() || m_generation != generation;
+    };
+    m_idle(file);
+    Speculated speculated{file, snapshot->version, {}, {}, {}};
+    speculated.tokens = encode_tokens(*snapshot, 0, snapshot->text.size());
+    if (!dropped())
+      speculated.symbols = document_symbols(*snapshot);
+    if (!dropped())
+      speculated.index = index(*snapshot);
+    if (!dropped())
+      m_out.send(std::move(speculated));
+    lock.lock();
+  }
+}
+
+} // namespace features
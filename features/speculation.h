@@ -0,0 +1,63 @@
+#pragma once
+#include "channel.h"
+#include <chrono>
+#include <condition_variable>
+#include <documents/store.h>
+#include <functional>
+#include <mutex>
+#include <rpc/lsp.h>
+#include <symbols/references.h>
+#include <thread>
+
+namespace features {
+
+// Uses the pauses of the client to compute, for the document it edited last,
+// what it will likely ask next: its semantic tokens, its symbols, and its
+// index for references, renames and completions.
+//
+// The work starts once no edit came for `IDLE_AFTER`, on a thread of its
+// own, and is dropped as soon as a new edit arrives: it's never waited for.
+// What's done is sent for the main thread to adopt, which only does so if
+// the document is still at the same version.
+class Speculation {
+public:
+  struct Speculated {
+    workspace::FileId file;
+    i64 version;
+    // encoded as `encode_tokens` does
+    std::vector<u32> tokens;
+    std::vector<rpc::lsp::DocumentSymbol> symbols;
+    symbols::FileIndex index;
+  };
+  // Called from the speculation thread when the client goes idle after
+  // editing a document, before anything is computed for it.
+  using Idle = std::function<void(workspace::FileId)>;
+
+  static constexpr std::chrono::milliseconds IDLE_AFTER{300};
+
+  Speculation(Idle idle, Channel<Speculated> &out);
+
+  // The client edited `file`, which is now `snapshot`.
+  void edited(workspace::FileId file, documents::SnapshotPtr snapshot);
+  // Drops what's under way for `file`.
+  void close(workspace::FileId file);
+
+private:
+  void work(std::stop_token stop);
+
+  Idle m_idle;
+  Channel<Speculated> &m_out;
+
+  std::mutex m_mutex;
+  // the document edited last, until taken
+  std::condition_variable_any m_edited;
+  workspace::FileId m_file{};
+  documents::SnapshotPtr m_snapshot;
+  std::chrono::steady_clock::time_point m_edited_at;
+  // bumped on every edit, for the work under way to give up
+  u64 m_generation = 0;
+
+  std::jthread m_worker;
+};
+
+} // namespace features
@@ -1,14 +1,15 @@
 #include "json.h"
 #include <algorithm>
 #include <cmath>
+#include <memory/accounting.h>
 
 using namespace std::string_view_literals;
 
 namespace json {
 
 std::optional<value> object::remove(std::u16string_view key) noexcept {
-  auto removed = std::remove_if(m_assoc_array.begin(), m_assoc_array.end(),
-                                [&](auto const &p) { return p.first == key; });
+  auto removed = std::find_if(m_assoc_array.begin(), m_assoc_array.end(),
+                              [&](auto const &p) { return p.first == key; });
   if (removed == m_assoc_array.end())
     return std::nullopt;
   auto moved = std::move(removed->second);
@@ -17,18 +18,18 @@ std::optional<value> object::remove(std::u16string_view key) noexcept {
 }
 
 value object::remove_expect(std::u16string_view key) {
-  auto removed = std::remove_if(m_assoc_array.begin(), m_assoc_array.end(),
-                                [&](auto const &p) { return p.first == key; });
+  auto removed = std::find_if(m_assoc_array.begin(), m_assoc_array.end(),
+                              [&](auto const &p) { return p.first == key; });
   auto moved = std::move(removed->second);
   m_assoc_array.erase(removed);
   return moved;
 }
 
-bool object::set(std::u16string key, value value) noexcept {
+bool object::set(std::u16string_view key, value value) noexcept {
   // try finding where it exists
   if (has_key(key))
     return false;
-  m_assoc_array.emplace_back(std::move(key), std::move(value));
+  m_assoc_array.emplace_back(text(key), std::move(value));
   return true;
 }
 
@@ -174,8 +175,62 @@ std::optional<u16> Parser::parse_escape() noexcept {
     return std::nullopt;
   }
 }
-std::optional<std::u16string> Parser::parse_string() noexcept {
-  std::u16string value;
+// Decodes one UTF-8 sequence from `bytes`, returning the code point and
+// how many bytes it took. Malformed input decodes to U+FFFD over one byte.
+static std::pair<u32, u64> decode_utf8(std::string_view bytes) noexcept {
+  static constexpr std::pair<u32, u64> replacement{0xfffd, 1};
+  auto const lead = static_cast<u8>(bytes[0]);
+  if (lead < 0x80)
+    return {lead, 1};
+  u64 length;
+  u32 code_point;
+  if ((lead & 0xe0) == 0xc0) {
+    length = 2;
+    code_point = lead & 0x1f;
+  } else if ((lead & 0xf0) == 0xe0) {
+    length = 3;
+    code_point = lead & 0x0f;
+  } else if ((lead & 0xf8) == 0xf0) {
+    length = 4;
+    code_point = lead & 0x07;
+  } else {
+    return replacement;
+  }
+  if (bytes.size() < length)
+    return replacement;
+  for (u64 i = 1; i != length; ++i) {
+    auto const continuation = static_cast<u8>(bytes[i]);
+    if ((continuation & 0xc0) != 0x80)
+      return replacement;
+    code_point = code_point << 6 | (continuation & 0x3f);
+  }
+  // reject overlong encodings, surrogates and out of range values.
+  static constexpr u32 min_for_length[] = {0, 0, 0x80, 0x800, 0x10000};
+  if (code_point < min_for_length[length] || code_point > 0x10ffff ||
+      (code_point >= 0xd800 && code_point <= 0xdfff))
+    return replacement;
+  return {code_point, length};
+}
+
+template <typename String>
+static void push_utf16(String &out, u32 code_point) noexcept {
+  if (code_point < 0x10000) {
+    out.push_back(static_cast<char16_t>(code_point));
+  } else {
+    code_point -= 0x10000;
+    out.push_back(static_cast<char16_t>(0xd800 | (code_point >> 10)));
+    out.push_back(static_cast<char16_t>(0xdc00 | (code_point & 0x3ff)));
+  }
+}
+
+void Parser::parse_utf8_sequence(text &out) noexcept {
+  auto const [code_point, length] = decode_utf8(m_source.substr(m_index));
+  m_index += length;
+  push_utf16(out, code_point);
+}
+
+std::optional<text> Parser::parse_string() noexcept {
+  text value;
 
   for (; !is_eof() && unchecked_char() != '"';) {
     if (unchecked_char() == '\\') {
@@ -185,6 +240,8 @@ std::optional<std::u16string> Parser::parse_string() noexcept {
       if (!escaped)
         return std::nullopt;
       value.push_back(*escaped);
+    } else if (static_cast<u8>(unchecked_char()) >= 0x80) {
+      parse_utf8_sequence(value);
     } else {
       value.push_back(unchecked_char());
       accept_current();
@@ -291,7 +348,53 @@ std::optional<types::value> Parser::parse_value() noexcept {
   return final;
 }
 auto parse_single(std::string_view source) -> std::optional<types::value> {
+  memory::Tagged tagged(memory::Subsystem::Json);
   Parser p(source);
   return p.parse_value();
 }
+
+auto to_utf8(std::u16string_view source) -> std::string {
+  std::string out;
+  out.reserve(source.size());
+  for (u64 i = 0; i != source.size(); ++i) {
+    u32 code_point = source[i];
+    if (code_point >= 0xd800 && code_point <= 0xdbff &&
+        i + 1 != source.size() && source[i + 1] >= 0xdc00 &&
+        source[i + 1] <= 0xdfff) {
+      code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                   (source[i + 1] - 0xdc00);
+      ++i;
+    } else if (code_point >= 0xd800 && code_point <= 0xdfff) {
+      code_point = 0xfffd;
+    }
+
+    if (code_point < 0x80) {
+      out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+      out.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+      out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+      out.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else {
+      out.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+      out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+  }
+  return out;
+}
+
+auto from_utf8(std::string_view source) -> std::u16string {
+  std::u16string out;
+  out.reserve(source.size());
+  while (!source.empty()) {
+    auto const [code_point, length] = decode_utf8(source);
+    push_utf16(out, code_point);
+    source.remove_prefix(length);
+  }
+  return out;
+}
 } // namespace json
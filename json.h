@@ -1,8 +1,10 @@
 #pragma once
 #include "numbers.h"
 #include <cctype>
+#include <cmath>
 #include <concepts>
 #include <fmt/format.h>
+#include <memory/arena.h>
 #include <optional>
 #include <sstream>
 #include <string>
@@ -14,17 +16,25 @@ namespace json {
 namespace types {
 class value;
 
-using array = std::vector<value>;
+// Values are allocated from the arena of the message they belong to, if
+// any (see `memory::Arena`).
+template <typename T> using allocator = memory::ArenaAllocator<T>;
+using array = std::vector<value, allocator<value>>;
+// Strings within values. Those that are kept, or passed around outside of
+// values, are `string`s.
+using text = std::basic_string<char16_t, std::char_traits<char16_t>,
+                               allocator<char16_t>>;
 using string = std::u16string;
 class object {
-  using assoc_type = std::vector<std::pair<std::u16string, value>>;
+  using assoc_type =
+      std::vector<std::pair<text, value>, allocator<std::pair<text, value>>>;
   assoc_type m_assoc_array;
 
 public:
   constexpr assoc_type const &assocs() const noexcept { return m_assoc_array; }
   // Returns whether adding was successful or not. Adding can fail
   // if the key already exists.
-  bool set(std::u16string key, value value) noexcept;
+  bool set(std::u16string_view key, value value) noexcept;
   [[nodiscard]] bool has_key(std::u16string_view key) const noexcept;
   [[nodiscard]] value const &expect(std::u16string_view key) const;
   [[nodiscard]] value &expect(std::u16string_view key);
@@ -34,15 +44,17 @@ public:
 struct null {};
 
 class value {
-  std::variant<object, array, f64, bool, std::u16string, null> m_variant;
+  std::variant<object, array, f64, bool, text, null> m_variant;
 
 public:
   constexpr value() : m_variant{} {}
   constexpr value(bool v) : m_variant(v) {}
   value(object obj) : m_variant(std::move(obj)) {}
-  constexpr value(array arr) : m_variant(std::move(arr)) {}
+  value(array arr) : m_variant(std::move(arr)) {}
   constexpr value(f64 v) : m_variant(v) {}
-  constexpr value(std::u16string str) : m_variant(std::move(str)) {}
+  value(text str) : m_variant(std::move(str)) {}
+  value(string const &str) : m_variant(text(str)) {}
+  value(std::u16string_view str) : m_variant(text(str)) {}
   constexpr value(null) : m_variant(null{}) {}
   constexpr object const &as_object() const {
     return std::get<object>(m_variant);
@@ -53,11 +65,9 @@ public:
   constexpr f64 as_number() const { return std::get<f64>(m_variant); }
   constexpr f64 &as_number() { return std::get<f64>(m_variant); }
   constexpr std::u16string_view as_string() const {
-    return std::get<std::u16string>(m_variant);
-  }
-  constexpr std::u16string &as_string() {
-    return std::get<std::u16string>(m_variant);
+    return std::get<text>(m_variant);
   }
+  constexpr text &as_string() { return std::get<text>(m_variant); }
   constexpr bool as_bool() const { return std::get<bool>(m_variant); }
   constexpr bool &as_bool() { return std::get<bool>(m_variant); }
 
@@ -77,7 +87,7 @@ public:
     return std::holds_alternative<bool>(m_variant);
   }
   constexpr bool is_string() const noexcept {
-    return std::holds_alternative<std::u16string>(m_variant);
+    return std::holds_alternative<text>(m_variant);
   }
   // Checks if number is an integer, using a comparison tolerance
   constexpr std::optional<i64> try_integer(f64 tolerance) const noexcept {
@@ -129,8 +139,11 @@ class Parser {
   std::optional<u16> parse_four_hex() noexcept;
   // assumes '\\' was just accepted
   std::optional<u16> parse_escape() noexcept;
+  // decodes the UTF-8 sequence starting at the current char into `out`.
+  // Malformed sequences decode to U+FFFD instead of failing the parse.
+  void parse_utf8_sequence(types::text &out) noexcept;
   // assumes first '"' has been accepted
-  std::optional<std::u16string> parse_string() noexcept;
+  std::optional<types::text> parse_string() noexcept;
   // assumes first '[' has been accepted
   std::optional<types::array> parse_array() noexcept;
   // assumes first '{' has been accepted
@@ -143,6 +156,12 @@ public:
 
 auto parse_single(std::string_view source) -> std::optional<types::value>;
 
+// JSON strings are kept as UTF-16 (like LSP positions are), while documents
+// and the wire are UTF-8. These convert between both; unpaired surrogates and
+// malformed sequences become U+FFFD.
+auto to_utf8(std::u16string_view source) -> std::string;
+auto from_utf8(std::string_view source) -> std::u16string;
+
 namespace __fmt_helpers {
 struct debug_u16_string {
   std::u16string_view view;
@@ -160,10 +179,12 @@ template <> struct fmt::formatter<json::__fmt_helpers::debug_u16_string> {
     return begin;
   }
   template <typename format_ctx>
-  auto format(json::__fmt_helpers::debug_u16_string &str, format_ctx &ctx)
-      -> decltype(ctx.out()) {
+  auto format(json::__fmt_helpers::debug_u16_string const &str,
+              format_ctx &ctx) -> decltype(ctx.out()) {
+    static constexpr char hex[] = "0123456789abcdef";
     format_to(ctx.out(), "\"");
-    for (auto const value : str.view) {
+    for (u64 i = 0; i != str.view.size(); ++i) {
+      auto const value = str.view[i];
       switch (value) {
       case '"':
         format_to(ctx.out(), "\\\"");
@@ -190,12 +211,19 @@ template <> struct fmt::formatter<json::__fmt_helpers::debug_u16_string> {
         format_to(ctx.out(), "\\t");
         break;
       default:
-        if (std::iswprint(value)) {
+        if (value < 0x20) {
+          format_to(ctx.out(), "\\u00{}{}", hex[value >> 4],
+                    hex[value & 0xf]);
+        } else if (value < 0x80) {
           format_to(ctx.out(), "{}", static_cast<char>(value));
         } else {
-          u16 nibbles = value;
-          format_to(ctx.out(), "\\u{}{}{}{}", (nibbles >> 24),
-                    (nibbles >> 16) & 0xf, (nibbles >> 8) & 0xf, nibbles & 0xf);
+          // find the end of this non-ASCII run and write it as UTF-8.
+          auto end = i;
+          while (end != str.view.size() && str.view[end] >= 0x80)
+            ++end;
+          format_to(ctx.out(), "{}",
+                    json::to_utf8(str.view.substr(i, end - i)));
+          i = end - 1;
         }
         break;
       }
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <condition_variable>
+#include <ctime>
+#include <logging/log.h>
+#include <mutex>
+
+namespace logging {
+
+namespace detail {
+std::atomic<Level> g_level = Level::Info;
+} // namespace detail
+
+namespace {
+// Single producer (its thread), single consumer (the flusher) queue.
+struct Ring {
+  static constexpr u64 CAPACITY = 512;
+
+  detail::Record records[CAPACITY];
+  // next record to write, moved by the thread
+  alignas(64) std::atomic<u64> head = 0;
+  // next record to read, moved by the flusher
+  alignas(64) std::atomic<u64> tail = 0;
+  std::atomic<u64> dropped = 0;
+  // set once the thread is gone, for the flusher to free it once drained
+  std::atomic<bool> orphaned = false;
+};
+
+// The rings of all threads that logged.
+std::mutex g_rings_mutex;
+std::vector<std::unique_ptr<Ring>> g_rings;
+
+// Lets the flusher know when the thread goes.
+struct Owner {
+  Ring *ring = nullptr;
+  ~Owner() {
+    if (ring)
+      ring->orphaned.store(true, std::memory_order_release);
+  }
+};
+thread_local Owner t_owner;
+
+std::mutex g_forward_mutex;
+Forward g_forward;
+
+// woken early for errors.
+std::mutex g_wake_mutex;
+std::condition_variable_any g_wake;
+std::atomic<bool> g_error_logged = false;
+
+Ring &local_ring() {
+  if (!t_owner.ring) {
+    auto ring = std::make_unique<Ring>();
+    t_owner.ring = ring.get();
+    std::lock_guard lock(g_rings_mutex);
+    g_rings.push_back(std::move(ring));
+  }
+  return *t_owner.ring;
+}
+
+// "hh:mm:ss.mmm", local time.
+std::string timestamp(std::chrono::system_clock::time_point time) {
+  auto const seconds = std::chrono::system_clock::to_time_t(time);
+  auto const milliseconds =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          time.time_since_epoch())
+          .count() %
+      1000;
+  std::tm local{};
+  ::localtime_r(&seconds, &local);
+  return fmt::format("{:02}:{:02}:{:02}.{:03}", local.tm_hour, local.tm_min,
+                     local.tm_sec, milliseconds);
+}
+} // namespace
+
+std::string_view name_of(Level level) noexcept {
+  switch (level) {
+  case Level::Error:
+    return "error";
+  case Level::Warning:
+    return "warning";
+  case Level::Info:
+    return "info";
+  case Level::Debug:
+    return "debug";
+  }
+  return "info";
+}
+
+std::optional<Level> level_named(std::string_view name) noexcept {
+  for (auto const level :
+       {Level::Error, Level::Warning, Level::Info, Level::Debug})
+    if (name == name_of(level))
+      return level;
+  return std::nullopt;
+}
+
+void set_level(Level level) noexcept {
+  detail::g_level.store(level, std::memory_order_relaxed);
+}
+
+detail::Record *detail::claim() noexcept {
+  auto &ring = local_ring();
+  auto const head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) == Ring::CAPACITY) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  return &ring.records[head % Ring::CAPACITY];
+}
+
+void detail::commit(Record &record) noexcept {
+  auto &ring = *t_owner.ring;
+  ring.head.store(ring.head.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+  if (record.level == Level::Error) {
+    g_error_logged.store(true, std::memory_order_relaxed);
+    g_wake.notify_one();
+  }
+}
+
+void forward(Forward forward) {
+  std::lock_guard lock(g_forward_mutex);
+  g_forward = std::move(forward);
+}
+
+Flusher::Flusher(std::FILE *out)
+    : m_out(out),
+      m_thread([this](std::stop_token stop) { work(std::move(stop)); }) {}
+
+Flusher::~Flusher() {
+  m_thread.request_stop();
+  m_thread.join();
+  flush();
+}
+
+void Flusher::work(std::stop_token stop) {
+  while (!stop.stop_requested()) {
+    {
+      std::unique_lock lock(g_wake_mutex);
+      g_wake.wait_for(lock, stop, PERIOD, [] {
+        return g_error_logged.exchange(false, std::memory_order_relaxed);
+      });
+    }
+    flush();
+  }
+}
+
+void Flusher::flush() {
+  std::vector<Ring *> rings;
+  {
+    std::lock_guard lock(g_rings_mutex);
+    for (auto const &ring : g_rings)
+      rings.push_back(ring.get());
+  }
+  fmt::memory_buffer message;
+  std::vector<Ring *> drained;
+  for (auto const ring : rings) {
+    // whatever it logged before going is in by now.
+    auto const orphaned = ring->orphaned.load(std::memory_order_acquire);
+    auto tail = ring->tail.load(std::memory_order_relaxed);
+    auto const head = ring->head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      auto &record = ring->records[tail % Ring::CAPACITY];
+      message.clear();
+      record.format(record, message);
+      m_lines.push_back(
+          {record.time, record.level, fmt::to_string(message)});
+    }
+    ring->tail.store(tail, std::memory_order_release);
+    if (auto const dropped =
+            ring->dropped.exchange(0, std::memory_order_relaxed))
+      m_lines.push_back({std::chrono::system_clock::now(), Level::Warning,
+                         fmt::format("dropped {} messages of a thread logging "
+                                     "faster than they were written",
+                                     dropped)});
+    if (orphaned)
+      drained.push_back(ring);
+  }
+  if (!drained.empty()) {
+    std::lock_guard lock(g_rings_mutex);
+    std::erase_if(g_rings, [&](auto const &ring) {
+      return std::find(drained.begin(), drained.end(), ring.get()) !=
+             drained.end();
+    });
+  }
+  if (m_lines.empty())
+    return;
+
+  // each ring is in order, but not between them.
+  std::stable_sort(
+      m_lines.begin(), m_lines.end(),
+      [](auto const &a, auto const &b) { return a.time < b.time; });
+  for (auto const &line : m_lines)
+    fmt::print(m_out, "{} {:<7} {}\n", timestamp(line.time),
+               name_of(line.level), line.message);
+  std::fflush(m_out);
+  {
+    std::lock_guard lock(g_forward_mutex);
+    if (g_forward)
+      for (auto const &line : m_lines)
+        g_forward(line.level, line.message);
+  }
+  m_lines.clear();
+}
+
+} // namespace logging
@@ -0,0 +1,167 @@
+#pragma once
+#include "numbers.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fmt/format.h>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Logging from any thread without waiting on any other.
+//
+// Every thread logs into a ring of its own, which a background thread
+// drains, formats and writes out (see `Flusher`). Arguments are copied along
+// and only formatted there; a statement below the current level costs the
+// comparison with it.
+namespace logging {
+
+// Numbered like LSP's MessageType.
+enum class Level : u8 { Error = 1, Warning, Info, Debug };
+
+std::string_view name_of(Level level) noexcept;
+std::optional<Level> level_named(std::string_view name) noexcept;
+
+namespace detail {
+extern std::atomic<Level> g_level;
+
+// A log statement on its way to the flusher.
+struct Record {
+  // formats the arguments into `out`, then destroys them.
+  void (*format)(Record &record, fmt::memory_buffer &out);
+  std::chrono::system_clock::time_point time;
+  fmt::string_view format_string;
+  Level level;
+  alignas(std::max_align_t) std::byte arguments[208];
+};
+// four cache lines
+static_assert(sizeof(Record) == 256);
+
+// The next record of the calling thread's ring, or nothing if it's full,
+// in which case the statement is dropped.
+Record *claim() noexcept;
+// Hands the claimed record to the flusher.
+void commit(Record &record) noexcept;
+
+// What's kept of an argument until formatted: strings are copied, as what
+// they view may be gone by then.
+template <typename T> auto owned(T &&value) {
+  if constexpr (std::is_convertible_v<T, std::string_view>)
+    return std::string(std::string_view(value));
+  else
+    return std::remove_cvref_t<T>(std::forward<T>(value));
+}
+
+template <typename... Args>
+[[gnu::noinline]] void write(Level level, fmt::string_view format,
+                             Args &&...args) {
+  using Arguments = std::tuple<decltype(owned(std::declval<Args>()))...>;
+  auto const record = claim();
+  if (!record)
+    return;
+  record->time = std::chrono::system_clock::now();
+  record->format_string = format;
+  record->level = level;
+  if constexpr (sizeof(Arguments) <= sizeof(Record::arguments) &&
+                alignof(Arguments) <= alignof(std::max_align_t)) {
+    ::new (record->arguments) Arguments(owned(std::forward<Args>(args))...);
+    record->format = [](Record &record, fmt::memory_buffer &out) {
+      auto &arguments =
+          *std::launder(reinterpret_cast<Arguments *>(record.arguments));
+      std::apply(
+          [&](auto const &...values) {
+            fmt::format_to(fmt::appender(out),
+                           fmt::runtime(record.format_string), values...);
+          },
+          arguments);
+      std::destroy_at(&arguments);
+    };
+  } else {
+    // too big to carry along: formatted right away.
+    ::new (record->arguments)
+        std::string(fmt::format(fmt::runtime(format), args...));
+    record->format = [](Record &record, fmt::memory_buffer &out) {
+      auto &message =
+          *std::launder(reinterpret_cast<std::string *>(record.arguments));
+      out.append(message);
+      std::destroy_at(&message);
+    };
+  }
+  commit(*record);
+}
+} // namespace detail
+
+// Statements less important than `level` are dropped. Info by default.
+void set_level(Level level) noexcept;
+inline bool enabled(Level level) noexcept {
+  return level <= detail::g_level.load(std::memory_order_relaxed);
+}
+
+template <typename... Args>
+void log(Level level, fmt::format_string<Args...> format, Args &&...args) {
+  if (enabled(level))
+    detail::write(level, format, std::forward<Args>(args)...);
+}
+template <typename... Args>
+void error(fmt::format_string<Args...> format, Args &&...args) {
+  log(Level::Error, format, std::forward<Args>(args)...);
+}
+template <typename... Args>
+void warning(fmt::format_string<Args...> format, Args &&...args) {
+  log(Level::Warning, format, std::forward<Args>(args)...);
+}
+template <typename... Args>
+void info(fmt::format_string<Args...> format, Args &&...args) {
+  log(Level::Info, format, std::forward<Args>(args)...);
+}
+template <typename... Args>
+void debug(fmt::format_string<Args...> format, Args &&...args) {
+  log(Level::Debug, format, std::forward<Args>(args)...);
+}
+
+// Also passes every message to `forward`, from the flusher's thread, until
+// called again with nothing. Once it returns, the previous one isn't called
+// anymore.
+using Forward = std::function<void(Level level, std::string_view message)>;
+void forward(Forward forward);
+
+// Drains the rings of all threads into `out` from a thread of its own, every
+// `PERIOD`, or sooner when an error is logged. What's logged before it
+// starts waits in the rings; what's left when it goes is written out then.
+class Flusher {
+public:
+  static constexpr auto PERIOD = std::chrono::milliseconds(50);
+
+  // Doesn't close `out`.
+  explicit Flusher(std::FILE *out);
+  Flusher(Flusher const &) = delete;
+  Flusher &operator=(Flusher const &) = delete;
+  ~Flusher();
+
+private:
+  void work(std::stop_token stop);
+  // Writes out what the rings have.
+  void flush();
+
+  struct Line {
+    std::chrono::system_clock::time_point time;
+    Level level;
+    std::string message;
+  };
+
+  std::FILE *m_out;
+  // what was drained from all rings, sorted by time before written out
+  std::vector<Line> m_lines;
+  std::jthread m_thread;
+};
+
+} // namespace logging
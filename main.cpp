@@ -1,21 +1,26 @@
 #include "json.h"
+#include "server.h"
+#include <charconv>
+#include <compiler/probe.h>
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
 #include <fmt/format.h>
 #include <fmt/xchar.h> // for u16
 #include <fstream>
-#include <iostream>
+#include <logging/log.h>
 #include <memory>
 #include <optional>
 #include <span>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <variant>
 #include <vector>
+#include <workspace/caches.h>
+#include <workspace/hash.h>
 
 using u64 = std::uint64_t;
 using i64 = std::int64_t;
@@ -34,6 +39,23 @@ void usage(char const *progname) {
                Where compiler is located\n\
                (default is $HOME/.cargo/bin/jakt)\n",
              stderr);
+  std::fputs(" -m MIB,--memory-budget=MIB\n\
+               How much memory caches may take, in MiB\n\
+               (default is 512)\n",
+             stderr);
+  std::fputs(" --log-file=PATH\n\
+               Where to append the log\n\
+               (default is the standard error)\n",
+             stderr);
+  std::fputs(" --log-level=LEVEL\n\
+               One of error, warning, info or debug\n\
+               (default is info)\n",
+             stderr);
+  std::fputs("ENVIRONMENT:\n", stderr);
+  std::fputs(" JAKT_LSP_COUNT_ALLOCATIONS=1\n\
+               Count allocations by subsystem, for the\n\
+               jakt-lsp/allocations request and on shutdown\n",
+             stderr);
 }
 
 class PreConditionChecker {
@@ -57,9 +79,7 @@ class CompilerPathChecker : public PreConditionChecker {
 
 public:
   CompilerPathChecker(std::string_view path) noexcept : m_path(path) {
-    std::stringstream ss;
-    ss << "compiler path: " << m_path;
-    set_precondition_name(ss.str());
+    set_precondition_name(fmt::format("compiler path: \"{}\"", path));
   }
   virtual std::optional<std::string_view>
   perform_check() const noexcept override {
@@ -77,6 +97,35 @@ public:
   }
 };
 
+// Runs the compiler to learn what it supports, which is remembered in the
+// cache directory until the compiler changes.
+class CompilerProbeChecker : public PreConditionChecker {
+  fs::path m_path;
+  mutable std::optional<compiler::Capabilities> m_capabilities;
+
+public:
+  CompilerProbeChecker(std::string_view path) noexcept : m_path(path) {
+    set_precondition_name(fmt::format("compiler probe: \"{}\"", path));
+  }
+  virtual std::optional<std::string_view>
+  perform_check() const noexcept override {
+    auto const cache = workspace::cache_directory();
+    m_capabilities =
+        cache ? compiler::probe_cached(
+                    m_path, *cache / fmt::format("{:016x}.compiler",
+                                                 workspace::hash_bytes(
+                                                     m_path.native())))
+              : compiler::probe(m_path);
+    if (!m_capabilities)
+      return "compiler doesn't answer --version and --help"sv;
+    return std::nullopt;
+  }
+  // What the compiler supports, once checked.
+  std::optional<compiler::Capabilities> const &capabilities() const noexcept {
+    return m_capabilities;
+  }
+};
+
 // Abstract compiler interface
 class Compiler {
   std::string_view m_compiler_path;
@@ -86,25 +135,32 @@ public:
       : m_compiler_path(compiler_path) {}
 };
 
-static bool check_single_precondition(const PreConditionChecker &checker) {
-  auto errored = false;
-  std::cerr << "Checking " << checker.name();
-  auto const error = checker.perform_check();
+static bool report_precondition(const PreConditionChecker &checker,
+                                std::optional<std::string_view> error) {
   if (error) {
-    std::cerr << "  \x1b[1;31mERROR\x1b[m";
-    errored = true;
-  } else {
-    std::cerr << "  \x1b[1;38;5;2mOK\x1b[m";
+    logging::error("checking {}: {}", checker.name(), *error);
+    return false;
   }
-  std::cerr << '\n';
-  return !errored;
+  logging::info("checking {}: ok", checker.name());
+  return true;
 }
 
+// Runs all checks at once, as some run the compiler, then reports them in
+// order.
 static bool check_preconditions(
     std::span<std::unique_ptr<const PreConditionChecker>> checkers) {
+  std::vector<std::optional<std::string_view>> errors(checkers.size());
+  {
+    std::vector<std::jthread> threads;
+    for (u64 i = 1; i < checkers.size(); ++i)
+      threads.emplace_back(
+          [&, i] { errors[i] = checkers[i]->perform_check(); });
+    if (!checkers.empty())
+      errors[0] = checkers[0]->perform_check();
+  }
   auto errored = false;
-  for (auto &checker : checkers) {
-    errored |= !check_single_precondition(*checker);
+  for (u64 i = 0; i != checkers.size(); ++i) {
+    errored |= !report_precondition(*checkers[i], errors[i]);
   }
   return !errored;
 }
@@ -115,6 +171,18 @@ auto main(int const argc, char const *const *const argv,
   auto const progname = argv[0];
 
   std::string compiler_path = "";
+  Server::Options options;
+  std::string log_path;
+
+  auto const parse_budget = [&](char const *value) {
+    u64 mebibytes;
+    auto const end = value + std::strlen(value);
+    auto const [ptr, error] = std::from_chars(value, end, mebibytes);
+    if (error != std::errc{} || ptr != end || mebibytes == 0)
+      return false;
+    options.memory_budget = mebibytes << 20;
+    return true;
+  };
 
   // search for environment variables like HOME
   for (; *envp; ++envp) {
@@ -158,10 +226,88 @@ auto main(int const argc, char const *const *const argv,
       compiler_path = std::string(rest);
       continue;
     }
+
+    // -m MIB, --memory-budget MIB
+    if (std::strcmp(argv[i], "-m") == 0 ||
+        std::strcmp(argv[i], "--memory-budget") == 0) {
+      ++i;
+      if (i == argc) {
+        std::fprintf(stderr, "error: used %s without an argument.\n",
+                     argv[i - 1]);
+        usage(progname);
+        return 1;
+      }
+      if (!parse_budget(argv[i])) {
+        std::fprintf(stderr, "error: invalid memory budget '%s'.\n", argv[i]);
+        return 1;
+      }
+      continue;
+    }
+
+    // --memory-budget=MIB
+    if (std::strncmp(argv[i], "--memory-budget=", 16) == 0) {
+      if (!parse_budget(argv[i] + 16)) {
+        std::fprintf(stderr, "error: invalid memory budget '%s'.\n",
+                     argv[i] + 16);
+        return 1;
+      }
+      continue;
+    }
+
+    // --log-file=PATH
+    if (std::strncmp(argv[i], "--log-file=", 11) == 0) {
+      log_path = argv[i] + 11;
+      continue;
+    }
+
+    // --log-level=LEVEL
+    if (std::strncmp(argv[i], "--log-level=", 12) == 0) {
+      auto const level = logging::level_named(argv[i] + 12);
+      if (!level) {
+        std::fprintf(stderr, "error: invalid log level '%s'.\n",
+                     argv[i] + 12);
+        usage(progname);
+        return 1;
+      }
+      logging::set_level(*level);
+      continue;
+    }
+  }
+
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> log_file(nullptr,
+                                                               std::fclose);
+  if (!log_path.empty()) {
+    log_file.reset(std::fopen(log_path.c_str(), "a"));
+    if (!log_file) {
+      std::fprintf(stderr, "error: can't open log file '%s'.\n",
+                   log_path.c_str());
+      return 1;
+    }
   }
+  // goes after the server, to write what it logged last.
+  logging::Flusher flusher(log_file ? log_file.get() : stderr);
 
-  if (!check_single_precondition(CompilerPathChecker(compiler_path)))
+  auto probe = std::make_unique<CompilerProbeChecker>(compiler_path);
+  auto const &capabilities = probe->capabilities();
+  std::vector<std::unique_ptr<const PreConditionChecker>> checkers;
+  checkers.push_back(std::make_unique<CompilerPathChecker>(compiler_path));
+  checkers.push_back(std::move(probe));
+  if (!check_preconditions(checkers))
     return 1;
+  logging::info("compiler version: {}", capabilities->version.empty()
+                                            ? "unknown"
+                                            : capabilities->version);
+  if (!capabilities->runtime.empty())
+    logging::info("compiler runtime: {}", capabilities->runtime.native());
+  for (auto const flag : {"--check-only", "--json-errors"})
+    if (!capabilities->supports(flag))
+      logging::warning("compiler doesn't list {} in its --help", flag);
+  options.import_path_flag = capabilities->import_path_flag();
+  if (options.import_path_flag.empty())
+    logging::warning("compiler doesn't list an import path option in its "
+                     "--help, so unsaved documents can't import their "
+                     "neighbours");
 
-  return 0;
+  options.compiler_path = compiler_path;
+  return Server(options, stdin, stdout).run();
 }
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <matching/fuzzy.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace matching {
+
+namespace {
+// https://github.com/junegunn/fzf/blob/master/src/algo/algo.go
+constexpr i32 SCORE_MATCH = 16;
+constexpr i32 SCORE_GAP_START = -3;
+constexpr i32 SCORE_GAP_EXTENSION = -1;
+constexpr i32 BONUS_BOUNDARY = SCORE_MATCH / 2;
+constexpr i32 BONUS_NON_WORD = SCORE_MATCH / 2;
+constexpr i32 BONUS_CAMEL = BONUS_BOUNDARY + SCORE_GAP_EXTENSION;
+constexpr i32 BONUS_CONSECUTIVE = -(SCORE_GAP_START + SCORE_GAP_EXTENSION);
+constexpr i32 BONUS_FIRST_CHAR_MULTIPLIER = 2;
+
+enum class CharClass { NonWord, Lower, Upper, Number };
+
+CharClass class_of(char c) noexcept {
+  if (c >= 'a' && c <= 'z')
+    return CharClass::Lower;
+  if (c >= 'A' && c <= 'Z')
+    return CharClass::Upper;
+  if (c >= '0' && c <= '9')
+    return CharClass::Number;
+  // bytes of UTF-8 sequences are letters as far as we care.
+  if (static_cast<u8>(c) >= 0x80)
+    return CharClass::Lower;
+  return CharClass::NonWord;
+}
+
+char lower(char c) noexcept {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// letters and digits get a bit each, the rest share a few.
+constexpr auto MASK_BITS = [] {
+  std::array<u64, 256> bits{};
+  for (u32 byte = 0; byte != 256; ++byte) {
+    if (byte >= 'a' && byte <= 'z')
+      bits[byte] = u64(1) << (byte - 'a');
+    else if (byte >= 'A' && byte <= 'Z')
+      bits[byte] = u64(1) << (byte - 'A');
+    else if (byte >= '0' && byte <= '9')
+      bits[byte] = u64(1) << (26 + byte - '0');
+    else if (byte == '_')
+      bits[byte] = u64(1) << 36;
+    else if (byte >= 0x80)
+      bits[byte] = u64(1) << 37;
+    else
+      bits[byte] = u64(1) << 38;
+  }
+  return bits;
+}();
+
+// Where `c`, a lowercase query character, is next in `text` in either case,
+// from `from` on. `text.size()` if it isn't.
+u64 find(std::string_view text, u64 from, char c, bool padded) noexcept {
+  // ORing in 0x20 lowercases letters, and only them.
+  auto const fold = static_cast<char>(c >= 'a' && c <= 'z' ? 0x20 : 0);
+#if defined(__SSE2__)
+  auto const needle = _mm_set1_epi8(c);
+  auto const folding = _mm_set1_epi8(fold);
+  // without padding, only whole blocks inside `text` can be loaded.
+  auto const last = padded ? text.size() : std::max<u64>(text.size(), 15) - 15;
+  for (; from < last; from += 16) {
+    auto const block =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(text.data() + from));
+    auto const hits = static_cast<u32>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_or_si128(block, folding), needle)));
+    if (hits)
+      return std::min<u64>(from + std::countr_zero(hits), text.size());
+  }
+  if (padded)
+    return text.size();
+#endif
+  for (; from < text.size(); ++from)
+    if ((text[from] | fold) == c)
+      return from;
+  return text.size();
+}
+
+i32 bonus_for(CharClass previous, CharClass current) noexcept {
+  if (previous == CharClass::NonWord && current != CharClass::NonWord)
+    return BONUS_BOUNDARY;
+  if ((previous == CharClass::Lower && current == CharClass::Upper) ||
+      (previous != CharClass::Number && current == CharClass::Number))
+    return BONUS_CAMEL;
+  if (current == CharClass::NonWord)
+    return BONUS_NON_WORD;
+  return 0;
+}
+} // namespace
+
+u64 mask_of(std::string_view text) noexcept {
+  u64 mask = 0;
+  for (auto const c : text)
+    mask |= MASK_BITS[static_cast<u8>(c)];
+  return mask;
+}
+
+Pattern::Pattern(std::string_view query) : m_mask(mask_of(query)) {
+  m_query.reserve(query.size());
+  for (auto const c : query)
+    m_query.push_back(lower(c));
+  // every character matched on a word boundary, without gaps.
+  auto const length = static_cast<i32>(m_query.size());
+  m_best = length == 0 ? 0
+                       : length * SCORE_MATCH +
+                             (length + BONUS_FIRST_CHAR_MULTIPLIER - 1) *
+                                 BONUS_BOUNDARY;
+}
+
+std::optional<i32> Pattern::score(std::string_view candidate, bool padded,
+                                  i32 floor) const noexcept {
+  if (m_query.empty())
+    return 0;
+
+  // the first occurrence of the whole query, then back from its end to the
+  // shortest one ending there.
+  u64 end = 0;
+  for (auto const c : m_query) {
+    end = find(candidate, end, c, padded);
+    if (end == candidate.size())
+      return std::nullopt;
+    ++end;
+  }
+  auto start = end;
+  for (auto left = m_query.size(); left != 0;)
+    if (lower(candidate[--start]) == m_query[left - 1])
+      --left;
+  // characters between matches cost at least a gap each.
+  if (auto const gaps = static_cast<i32>(end - start - m_query.size());
+      gaps != 0 && m_best + SCORE_GAP_START + (gaps - 1) * SCORE_GAP_EXTENSION <
+                       floor)
+    return std::nullopt;
+
+  i32 score = 0, first_bonus = 0;
+  u64 consecutive = 0, query = 0;
+  bool in_gap = false;
+  auto previous =
+      start == 0 ? CharClass::NonWord : class_of(candidate[start - 1]);
+  for (auto i = start; i != end; ++i) {
+    auto const current = class_of(candidate[i]);
+    if (query < m_query.size() && lower(candidate[i]) == m_query[query]) {
+      score += SCORE_MATCH;
+      auto bonus = bonus_for(previous, current);
+      if (consecutive == 0) {
+        first_bonus = bonus;
+      } else {
+        // a run of matches keeps the bonus of its first character.
+        if (bonus >= BONUS_BOUNDARY && bonus > first_bonus)
+          first_bonus = bonus;
+        bonus = std::max({bonus, first_bonus, BONUS_CONSECUTIVE});
+      }
+      score += query == 0 ? bonus * BONUS_FIRST_CHAR_MULTIPLIER : bonus;
+      in_gap = false;
+      ++consecutive;
+      ++query;
+    } else {
+      score += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+      in_gap = true;
+      consecutive = 0;
+      first_bonus = 0;
+    }
+    previous = current;
+  }
+  return score;
+}
+
+void TopK::push(u32 index, i32 score, u64 length) {
+  Item const item{score, clamp(length), index};
+  if (m_heap.size() < m_limit) {
+    m_heap.push_back(item);
+    std::push_heap(m_heap.begin(), m_heap.end(), better);
+    return;
+  }
+  if (m_heap.empty() || !better(item, m_heap.front()))
+    return;
+  std::pop_heap(m_heap.begin(), m_heap.end(), better);
+  m_heap.back() = item;
+  std::push_heap(m_heap.begin(), m_heap.end(), better);
+}
+
+std::vector<Ranked> TopK::take() && {
+  std::sort_heap(m_heap.begin(), m_heap.end(), better);
+  std::vector<Ranked> ranked;
+  ranked.reserve(m_heap.size());
+  for (auto const &item : m_heap)
+    ranked.push_back({item.index, item.score});
+  return ranked;
+}
+
+void Candidates::reserve(u64 count, u64 bytes) {
+  m_masks.reserve(count);
+  m_ends.reserve(count);
+  m_text.reserve(bytes + PADDING);
+}
+
+void Candidates::add(std::string_view name) {
+  m_text.insert(m_text.size() - PADDING, name);
+  m_ends.push_back(static_cast<u32>(m_text.size() - PADDING));
+  m_masks.push_back(mask_of(name));
+}
+
+std::vector<Ranked> Candidates::rank(Pattern const &pattern,
+                                     u64 limit) const {
+  TopK top(limit);
+  auto const mask = pattern.mask();
+  auto const best = pattern.best_score();
+  for (u64 i = 0; i != m_masks.size(); ++i) {
+    if ((m_masks[i] & mask) != mask)
+      continue;
+    // once the kept ones score the best there is, only shorter names can
+    // take their place.
+    auto const name = (*this)[i];
+    auto const floor = top.floor(name.size());
+    if (best < floor)
+      continue;
+    if (auto const score = pattern.score(name, true, floor))
+      top.push(static_cast<u32>(i), *score, name.size());
+  }
+  return std::move(top).take();
+}
+
+} // namespace matching
@@ -0,0 +1,127 @@
+#pragma once
+#include "numbers.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Matching of what the user typed against names.
+namespace matching {
+
+// The characters `text` has, case-insensitively, as one bit per class of
+// character. A candidate can only match a query whose mask is a subset of
+// its own.
+u64 mask_of(std::string_view text) noexcept;
+
+// A query matched case-insensitively as a subsequence of candidates, scored
+// the way fzf does: matches on word boundaries and camelCase humps score
+// higher, and gaps between matched characters cost.
+class Pattern {
+public:
+  explicit Pattern(std::string_view query);
+
+  bool empty() const noexcept { return m_query.empty(); }
+  u64 mask() const noexcept { return m_mask; }
+  // What no candidate can score more than.
+  i32 best_score() const noexcept { return m_best; }
+  // Nothing if `candidate` doesn't contain the query as a subsequence.
+  std::optional<i32> score(std::string_view candidate) const noexcept {
+    return score(candidate, false);
+  }
+
+private:
+  friend class Candidates;
+  // `padded` if at least 15 readable bytes follow `candidate`, so that it
+  // can be searched 16 bytes at a time up to its end. Candidates that
+  // can't score at least `floor` may be given up on early.
+  std::optional<i32> score(std::string_view candidate, bool padded,
+                           i32 floor = INT32_MIN) const noexcept;
+
+  // lowercase
+  std::string m_query;
+  u64 m_mask;
+  i32 m_best;
+};
+
+struct Ranked {
+  u32 index;
+  i32 score;
+};
+
+// The best of a stream of scored items, in a bounded heap: highest score
+// first, then shortest, then the first pushed.
+class TopK {
+public:
+  explicit TopK(u64 limit) : m_limit(limit) {}
+
+  // The lowest score an item of `length` pushed now would be kept with.
+  i32 floor(u64 length) const noexcept {
+    if (m_heap.size() < m_limit)
+      return INT32_MIN;
+    if (m_heap.empty())
+      return INT32_MAX;
+    auto const &worst = m_heap.front();
+    return clamp(length) < worst.length ? worst.score : worst.score + 1;
+  }
+  void push(u32 index, i32 score, u64 length);
+  // Best first.
+  std::vector<Ranked> take() &&;
+
+private:
+  struct Item {
+    i32 score;
+    u32 length;
+    u32 index;
+  };
+  static u32 clamp(u64 length) noexcept {
+    return length < ~u32(0) ? static_cast<u32>(length) : ~u32(0);
+  }
+  static bool better(Item const &a, Item const &b) noexcept {
+    if (a.score != b.score)
+      return a.score > b.score;
+    if (a.length != b.length)
+      return a.length < b.length;
+    return a.index < b.index;
+  }
+
+  u64 m_limit;
+  // the worst item kept on top
+  std::vector<Item> m_heap;
+};
+
+// Names to be matched against many patterns, laid out to be scanned: their
+// masks side by side, to rule most of them out without touching their text,
+// and their text in one padded buffer.
+class Candidates {
+public:
+  Candidates() : m_text(PADDING, '\0') {}
+
+  void reserve(u64 count, u64 bytes);
+  void add(std::string_view name);
+
+  u64 size() const noexcept { return m_masks.size(); }
+  std::string_view operator[](u64 index) const noexcept {
+    auto const start = index == 0 ? 0 : m_ends[index - 1];
+    return {m_text.data() + start, m_ends[index] - start};
+  }
+
+  // The best `limit` candidates matching `pattern`, best first.
+  std::vector<Ranked> rank(Pattern const &pattern, u64 limit) const;
+
+  // Bytes held.
+  u64 usage() const noexcept {
+    return m_masks.capacity() * sizeof(u64) +
+           m_ends.capacity() * sizeof(u32) + m_text.capacity();
+  }
+
+private:
+  static constexpr u64 PADDING = 16;
+
+  std::vector<u64> m_masks;
+  std::vector<u32> m_ends;
+  // names back to back, then `PADDING` bytes
+  std::string m_text;
+};
+
+} // namespace matching
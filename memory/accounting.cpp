@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory/accounting.h>
+#include <new>
+
+namespace memory {
+
+namespace {
+// In front of every allocation while counting, right before what's handed
+// out.
+struct Header {
+  u64 size;
+  // from the start of the block to what's handed out
+  u32 offset;
+  Subsystem subsystem;
+};
+constexpr u64 HEADER = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+static_assert(sizeof(Header) <= HEADER);
+
+struct Counters {
+  std::atomic<u64> live;
+  std::atomic<u64> peak;
+  std::atomic<u64> count;
+  std::atomic<u64> bytes;
+};
+Counters g_counters[SUBSYSTEMS];
+
+thread_local Subsystem t_subsystem = Subsystem::Other;
+
+void *allocate_block(u64 size, u64 alignment) noexcept {
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    return std::malloc(size);
+  void *block;
+  return ::posix_memalign(&block, alignment, size) == 0 ? block : nullptr;
+}
+
+void *allocate(u64 size, u64 alignment) noexcept {
+  size = std::max<u64>(size, 1);
+  if (!counting_allocations())
+    return allocate_block(size, alignment);
+  auto const offset = std::max(HEADER, alignment);
+  auto const block = static_cast<char *>(allocate_block(offset + size,
+                                                        alignment));
+  if (!block)
+    return nullptr;
+  auto const subsystem = t_subsystem;
+  ::new (block + offset - HEADER)
+      Header{size, static_cast<u32>(offset), subsystem};
+  auto &counters = g_counters[static_cast<u8>(subsystem)];
+  auto const live =
+      counters.live.fetch_add(size, std::memory_order_relaxed) + size;
+  auto peak = counters.peak.load(std::memory_order_relaxed);
+  while (live > peak && !counters.peak.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed))
+    ;
+  counters.count.fetch_add(1, std::memory_order_relaxed);
+  counters.bytes.fetch_add(size, std::memory_order_relaxed);
+  return block + offset;
+}
+
+void free(void *pointer) noexcept {
+  if (!pointer || !counting_allocations()) {
+    std::free(pointer);
+    return;
+  }
+  auto const header = reinterpret_cast<Header *>(static_cast<char *>(pointer) -
+                                                 HEADER);
+  g_counters[static_cast<u8>(header->subsystem)].live.fetch_sub(
+      header->size, std::memory_order_relaxed);
+  std::free(static_cast<char *>(pointer) - header->offset);
+}
+
+// What a throwing `operator new` does.
+void *allocate_or_throw(u64 size, u64 alignment) {
+  for (;;) {
+    if (auto const pointer = allocate(size, alignment))
+      return pointer;
+    auto const handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+} // namespace
+
+std::string_view name_of(Subsystem subsystem) noexcept {
+  switch (subsystem) {
+  case Subsystem::Other:
+    return "other";
+  case Subsystem::Json:
+    return "json";
+  case Subsystem::Rpc:
+    return "rpc";
+  case Subsystem::Documents:
+    return "documents";
+  case Subsystem::Compiler:
+    return "compiler";
+  }
+  return "other";
+}
+
+Tagged::Tagged(Subsystem subsystem) noexcept : m_previous(t_subsystem) {
+  t_subsystem = subsystem;
+}
+
+Tagged::~Tagged() { t_subsystem = m_previous; }
+
+bool counting_allocations() noexcept {
+  // read on the first allocation, before anything can change it.
+  static bool const counting = [] {
+    auto const value = std::getenv("JAKT_LSP_COUNT_ALLOCATIONS");
+    return value && *value && *value != '0';
+  }();
+  return counting;
+}
+
+Allocations allocations_of(Subsystem subsystem) noexcept {
+  auto const &counters = g_counters[static_cast<u8>(subsystem)];
+  return {counters.live.load(std::memory_order_relaxed),
+          counters.peak.load(std::memory_order_relaxed),
+          counters.count.load(std::memory_order_relaxed),
+          counters.bytes.load(std::memory_order_relaxed)};
+}
+
+auto AllocationSampler::sample() noexcept -> std::array<Sample, SUBSYSTEMS> {
+  auto const now = std::chrono::steady_clock::now();
+  auto const seconds =
+      std::max(std::chrono::duration<f64>(now - m_last).count(), 1e-9);
+  m_last = now;
+  std::array<Sample, SUBSYSTEMS> samples;
+  for (u64 i = 0; i != SUBSYSTEMS; ++i) {
+    auto const subsystem = static_cast<Subsystem>(i);
+    auto const allocations = allocations_of(subsystem);
+    auto const &previous = m_previous[i];
+    samples[i] = {subsystem, allocations,
+                  static_cast<f64>(allocations.count - previous.count) /
+                      seconds,
+                  static_cast<f64>(allocations.bytes - previous.bytes) /
+                      seconds};
+    m_previous[i] = allocations;
+  }
+  return samples;
+}
+
+} // namespace memory
+
+// Every allocation goes through the above, for the header to be there
+// whenever counting.
+void *operator new(std::size_t size) {
+  return memory::allocate_or_throw(size, 0);
+}
+void *operator new[](std::size_t size) {
+  return memory::allocate_or_throw(size, 0);
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return memory::allocate_or_throw(size, static_cast<u64>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return memory::allocate_or_throw(size, static_cast<u64>(alignment));
+}
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept {
+  return memory::allocate(size, 0);
+}
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept {
+  return memory::allocate(size, 0);
+}
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   std::nothrow_t const &) noexcept {
+  return memory::allocate(size, static_cast<u64>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     std::nothrow_t const &) noexcept {
+  return memory::allocate(size, static_cast<u64>(alignment));
+}
+
+void operator delete(void *pointer) noexcept { memory::free(pointer); }
+void operator delete[](void *pointer) noexcept { memory::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  memory::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept {
+  memory::free(pointer);
+}
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  memory::free(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  memory::free(pointer);
+}
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  memory::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+  memory::free(pointer);
+}
+void operator delete(void *pointer, std::nothrow_t const &) noexcept {
+  memory::free(pointer);
+}
+void operator delete[](void *pointer, std::nothrow_t const &) noexcept {
+  memory::free(pointer);
+}
+void operator delete(void *pointer, std::align_val_t,
+                     std::nothrow_t const &) noexcept {
+  memory::free(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t,
+                       std::nothrow_t const &) noexcept {
+  memory::free(pointer);
+}
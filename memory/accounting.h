@@ -0,0 +1,63 @@
+#pragma once
+#include "numbers.h"
+#include <array>
+#include <chrono>
+#include <string_view>
+
+namespace memory {
+
+// What heap allocations are counted against. Those made outside of any
+// subsystem are `Other`.
+enum class Subsystem : u8 { Other, Json, Rpc, Documents, Compiler };
+inline constexpr u64 SUBSYSTEMS = 5;
+
+std::string_view name_of(Subsystem subsystem) noexcept;
+
+// Counts what the calling thread allocates against `subsystem` while it
+// lives. What's freed is counted against the subsystem that allocated it,
+// whichever frees it.
+class Tagged {
+  Subsystem m_previous;
+
+public:
+  explicit Tagged(Subsystem subsystem) noexcept;
+  Tagged(Tagged const &) = delete;
+  Tagged &operator=(Tagged const &) = delete;
+  ~Tagged();
+};
+
+struct Allocations {
+  // bytes allocated and not freed yet, and the most there ever were
+  u64 live = 0;
+  u64 peak = 0;
+  // allocations made, and their bytes, freed or not
+  u64 count = 0;
+  u64 bytes = 0;
+};
+
+// Whether allocations are counted, which is decided once and for all by
+// JAKT_LSP_COUNT_ALLOCATIONS in the environment. Counting takes a header
+// in front of every allocation; otherwise it costs a branch.
+bool counting_allocations() noexcept;
+Allocations allocations_of(Subsystem subsystem) noexcept;
+
+// The allocations of every subsystem, with their rate since the previous
+// sample (or since the sampler was made).
+class AllocationSampler {
+public:
+  struct Sample {
+    Subsystem subsystem;
+    Allocations allocations;
+    f64 count_per_second;
+    f64 bytes_per_second;
+  };
+
+  std::array<Sample, SUBSYSTEMS> sample() noexcept;
+
+private:
+  std::chrono::steady_clock::time_point m_last =
+      std::chrono::steady_clock::now();
+  std::array<Allocations, SUBSYSTEMS> m_previous{};
+};
+
+} // namespace memory
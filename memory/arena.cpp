@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <bit>
+#include <memory/accounting.h>
+#include <memory/arena.h>
+#include <new>
+
+namespace memory {
+
+namespace {
+// chunks are all aligned alike, for any of them to serve any request.
+constexpr std::align_val_t CHUNK_ALIGNMENT{64};
+
+thread_local std::pmr::memory_resource *t_current = nullptr;
+
+// Index in the free lists of the chunks of `bytes`.
+u64 class_of(u64 bytes) noexcept {
+  return std::countr_zero(bytes) - std::countr_zero(ChunkPool::MIN_CHUNK);
+}
+} // namespace
+
+ChunkPool::~ChunkPool() {
+  for (u64 i = 0; i != CLASSES; ++i)
+    while (auto const chunk = m_free[i]) {
+      m_free[i] = chunk->next;
+      ::operator delete(chunk, CHUNK_ALIGNMENT);
+    }
+}
+
+ChunkPool &ChunkPool::local() noexcept {
+  thread_local ChunkPool pool;
+  return pool;
+}
+
+void *ChunkPool::do_allocate(std::size_t bytes, std::size_t alignment) {
+  // the arenas mostly hold the JSON of messages.
+  Tagged tagged(Subsystem::Json);
+  if (alignment > static_cast<std::size_t>(CHUNK_ALIGNMENT))
+    return ::operator new(bytes, std::align_val_t(alignment));
+  auto const size = std::bit_ceil(std::max<u64>(bytes, MIN_CHUNK));
+  if (size > MAX_POOLED)
+    return ::operator new(bytes, CHUNK_ALIGNMENT);
+  auto &free = m_free[class_of(size)];
+  if (!free)
+    return ::operator new(size, CHUNK_ALIGNMENT);
+  auto const chunk = free;
+  free = chunk->next;
+  m_retained -= size;
+  return chunk;
+}
+
+void ChunkPool::do_deallocate(void *chunk, std::size_t bytes,
+                              std::size_t alignment) {
+  if (alignment > static_cast<std::size_t>(CHUNK_ALIGNMENT)) {
+    ::operator delete(chunk, std::align_val_t(alignment));
+    return;
+  }
+  auto const size = std::bit_ceil(std::max<u64>(bytes, MIN_CHUNK));
+  if (size > MAX_POOLED || m_retained + size > RETAINED_LIMIT) {
+    ::operator delete(chunk, CHUNK_ALIGNMENT);
+    return;
+  }
+  auto &free = m_free[class_of(size)];
+  free = ::new (chunk) Free{free};
+  m_retained += size;
+}
+
+Arena::Arena() noexcept
+    : m_buffer(ChunkPool::MIN_CHUNK, &ChunkPool::local()),
+      m_previous(t_current) {
+  t_current = &m_buffer;
+}
+
+Arena::~Arena() { t_current = m_previous; }
+
+std::pmr::memory_resource *Arena::current() noexcept {
+  return t_current ? t_current : std::pmr::new_delete_resource();
+}
+
+} // namespace memory
@@ -0,0 +1,109 @@
+#pragma once
+#include "numbers.h"
+#include <memory_resource>
+#include <type_traits>
+
+namespace memory {
+
+// Chunks for the arenas of a thread, kept for the next ones once released
+// instead of going back to the heap. Sizes are rounded up to a power of two
+// so that chunks fit whichever arena asks next; only a few megabytes are
+// kept, and bigger chunks aren't pooled at all.
+class ChunkPool : public std::pmr::memory_resource {
+public:
+  static constexpr u64 MIN_CHUNK = u64(64) << 10;
+  static constexpr u64 MAX_POOLED = u64(4) << 20;
+  static constexpr u64 RETAINED_LIMIT = u64(8) << 20;
+
+  ChunkPool() = default;
+  ChunkPool(ChunkPool const &) = delete;
+  ChunkPool &operator=(ChunkPool const &) = delete;
+  ~ChunkPool() override;
+
+  // The pool of the calling thread.
+  static ChunkPool &local() noexcept;
+
+  // Bytes kept for reuse.
+  u64 retained() const noexcept { return m_retained; }
+
+private:
+  // a free chunk, linked through its first bytes.
+  struct Free {
+    Free *next;
+  };
+  // one list per power of two, from MIN_CHUNK to MAX_POOLED.
+  static constexpr u64 CLASSES = 7;
+
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void *chunk, std::size_t bytes,
+                     std::size_t alignment) override;
+  bool do_is_equal(
+      std::pmr::memory_resource const &other) const noexcept override {
+    return this == &other;
+  }
+
+  Free *m_free[CLASSES] = {};
+  u64 m_retained = 0;
+};
+
+// Memory for everything a message allocates while it's handled: the JSON it
+// is parsed into, the scratch data of its handler and the JSON of the
+// response. It's released all at once when the arena goes, after the
+// response was written, back to the pool of the thread.
+//
+// While it lives, the arena is what `current()` returns on its thread, so
+// nothing allocated from it may outlive it: what stays after the message
+// is copied out into ordinary containers.
+class Arena {
+public:
+  Arena() noexcept;
+  Arena(Arena const &) = delete;
+  Arena &operator=(Arena const &) = delete;
+  ~Arena();
+
+  // The arena of the calling thread, or the heap if there is none.
+  static std::pmr::memory_resource *current() noexcept;
+
+private:
+  std::pmr::monotonic_buffer_resource m_buffer;
+  std::pmr::memory_resource *m_previous;
+};
+
+// Allocates from the arena that was current where the container was made.
+// Unlike `std::pmr::polymorphic_allocator`, which defaults to the process
+// wide resource, it follows the thread's arena without being passed along.
+template <typename T> class ArenaAllocator {
+  std::pmr::memory_resource *m_resource;
+
+  template <typename U> friend class ArenaAllocator;
+
+public:
+  using value_type = T;
+  // like `std::pmr::polymorphic_allocator`, containers keep theirs.
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+
+  ArenaAllocator() noexcept : m_resource(Arena::current()) {}
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const &other) noexcept
+      : m_resource(other.m_resource) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(m_resource->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *p, std::size_t n) noexcept {
+    m_resource->deallocate(p, n * sizeof(T), alignof(T));
+  }
+  // copies go to the arena current where they're made.
+  ArenaAllocator select_on_container_copy_construction() const noexcept {
+    return {};
+  }
+
+  template <typename U>
+  bool operator==(ArenaAllocator<U> const &other) const noexcept {
+    return m_resource == other.m_resource;
+  }
+};
+
+} // namespace memory
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <memory/budget.h>
+
+namespace memory {
+
+u64 Consumer::now() const noexcept {
+  return m_budget ? m_budget->tick() : 0;
+}
+
+bool Consumer::is_open(workspace::FileId file) const noexcept {
+  return m_budget && m_budget->is_open(file);
+}
+
+void Budget::set_limit(u64 limit) noexcept {
+  m_limit = limit;
+  enforce();
+}
+
+void Budget::remove(Consumer &consumer) noexcept {
+  std::erase(m_consumers, &consumer);
+  consumer.m_budget = nullptr;
+}
+
+void Budget::set_open(workspace::FileId file, bool open) {
+  if (open)
+    m_open.insert(file);
+  else
+    m_open.erase(file);
+}
+
+u64 Budget::usage() const noexcept {
+  u64 total = 0;
+  for (auto const consumer : m_consumers)
+    total += consumer->usage();
+  return total;
+}
+
+void Budget::enforce() noexcept {
+  auto usage = this->usage();
+  // closed documents go first, and only then the open ones.
+  for (auto const open_too : {false, true}) {
+    while (usage > m_limit) {
+      Consumer *victim = nullptr;
+      u64 victim_used = 0;
+      for (auto const consumer : m_consumers) {
+        auto const used = consumer->oldest(open_too);
+        if (used && (!victim || *used < victim_used)) {
+          victim = consumer;
+          victim_used = *used;
+        }
+      }
+      if (!victim)
+        break;
+      auto const before = victim->usage();
+      victim->evict_oldest(open_too);
+      usage -= before - victim->usage();
+    }
+  }
+}
+
+} // namespace memory
@@ -0,0 +1,208 @@
+#pragma once
+#include "numbers.h"
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <workspace/file_ids.h>
+
+namespace memory {
+
+class Budget;
+
+// Values by file that a consumer holds, with the bytes they take counted as
+// they come and go, and their order of use kept in a list threaded through
+// the entries: neither `usage` nor `oldest` has to look at them all.
+template <typename Value> class Cache {
+  struct Link {
+    mutable Link const *previous;
+    mutable Link const *next;
+  };
+  struct Entry : Link {
+    workspace::FileId file;
+    Value value;
+    u64 usage;
+    mutable u64 last_used;
+  };
+
+public:
+  struct Oldest {
+    workspace::FileId file;
+    u64 last_used;
+  };
+
+  Cache() noexcept { m_head.previous = m_head.next = &m_head; }
+  // entries point into each other and at the head.
+  Cache(Cache const &) = delete;
+  Cache &operator=(Cache const &) = delete;
+
+  u64 usage() const noexcept { return m_usage; }
+  bool contains(workspace::FileId file) const noexcept {
+    return m_entries.contains(file);
+  }
+  Value *find(workspace::FileId file) noexcept {
+    auto const found = m_entries.find(file);
+    return found == m_entries.end() ? nullptr : &found->second.value;
+  }
+  Value const *find(workspace::FileId file) const noexcept {
+    auto const found = m_entries.find(file);
+    return found == m_entries.end() ? nullptr : &found->second.value;
+  }
+  // Calls `visit(workspace::FileId, Value const &)` for every entry.
+  template <typename Visitor> void visit(Visitor &&visit) const {
+    for (auto const &[file, entry] : m_entries)
+      visit(file, entry.value);
+  }
+
+  // Stores `value` for `file`, taking `usage` bytes, as used at `now`.
+  Value &put(workspace::FileId file, Value value, u64 usage, u64 now) {
+    auto found = m_entries.find(file);
+    if (found == m_entries.end()) {
+      found = m_entries
+                  .emplace(file, Entry{{nullptr, nullptr},
+                                       file,
+                                       std::move(value),
+                                       usage,
+                                       now})
+                  .first;
+    } else {
+      unlink(found->second);
+      m_usage -= found->second.usage;
+      found->second.value = std::move(value);
+      found->second.usage = usage;
+      found->second.last_used = now;
+    }
+    m_usage += usage;
+    append(found->second);
+    return found->second.value;
+  }
+  // Stamps the entry of `file`, if any, as used at `now`.
+  void use(workspace::FileId file, u64 now) const noexcept {
+    auto const found = m_entries.find(file);
+    if (found == m_entries.end())
+      return;
+    found->second.last_used = now;
+    unlink(found->second);
+    append(found->second);
+  }
+  bool erase(workspace::FileId file) noexcept {
+    auto const found = m_entries.find(file);
+    if (found == m_entries.end())
+      return false;
+    unlink(found->second);
+    m_usage -= found->second.usage;
+    m_entries.erase(found);
+    return true;
+  }
+
+  // The least recently used entry that `skip(workspace::FileId)` doesn't
+  // skip, if any. Those skipped are walked past, so that's only linear in
+  // how many there are.
+  template <typename Skip>
+  std::optional<Oldest> oldest(Skip &&skip) const noexcept {
+    for (auto link = m_head.next; link != &m_head; link = link->next) {
+      auto const &entry = static_cast<Entry const &>(*link);
+      if (!skip(entry.file))
+        return Oldest{entry.file, entry.last_used};
+    }
+    return std::nullopt;
+  }
+
+private:
+  void unlink(Link const &link) const noexcept {
+    link.previous->next = link.next;
+    link.next->previous = link.previous;
+  }
+  void append(Link const &link) const noexcept {
+    link.previous = m_head.previous;
+    link.next = &m_head;
+    m_head.previous->next = &link;
+    m_head.previous = &link;
+  }
+
+  std::unordered_map<workspace::FileId, Entry> m_entries;
+  // of the list, least recently used first
+  Link m_head;
+  u64 m_usage = 0;
+};
+
+// Something holding memory that counts against the budget.
+class Consumer {
+  friend class Budget;
+  // the budget it's registered with, if any
+  Budget *m_budget = nullptr;
+
+protected:
+  // A stamp for an entry used now, for `oldest`, from the budget's clock.
+  u64 now() const noexcept;
+  // Whether `file` is open in the editor, if registered.
+  bool is_open(workspace::FileId file) const noexcept;
+  // The least recently used entry of `cache`, skipping open documents
+  // unless `open_too`.
+  template <typename Value>
+  auto oldest_of(Cache<Value> const &cache, bool open_too) const noexcept {
+    return cache.oldest([&](workspace::FileId file) {
+      return !open_too && is_open(file);
+    });
+  }
+
+public:
+  virtual ~Consumer() = default;
+  virtual std::string_view name() const noexcept = 0;
+  // Bytes held right now, kept count of rather than added up: the budget
+  // asks after every message.
+  virtual u64 usage() const noexcept = 0;
+  // When the least recently used entry that can be evicted was last used
+  // (see `Budget::tick`), or nothing if there is none. Entries belonging to
+  // documents open in the editor are only considered if `open_too`.
+  virtual std::optional<u64> oldest(bool open_too) const noexcept {
+    (void)open_too;
+    return std::nullopt;
+  }
+  // Evicts the entry `oldest` talks about.
+  virtual void evict_oldest(bool open_too) noexcept { (void)open_too; }
+};
+
+// Keeps what the server caches within a byte limit, set with
+// `--memory-budget` or the `memoryBudget` initialization option. When over
+// it, the least recently used entries across all consumers are evicted,
+// starting with those of documents that aren't open in the editor.
+//
+// Used from the main thread only.
+class Budget {
+  u64 m_limit;
+  u64 m_clock = 0;
+  std::vector<Consumer *> m_consumers;
+  std::unordered_set<workspace::FileId> m_open;
+
+public:
+  static constexpr u64 DEFAULT_LIMIT = u64(512) << 20;
+
+  explicit Budget(u64 limit = DEFAULT_LIMIT) noexcept : m_limit(limit) {}
+
+  u64 limit() const noexcept { return m_limit; }
+  void set_limit(u64 limit) noexcept;
+
+  // Consumers must unregister before going away.
+  void add(Consumer &consumer) {
+    m_consumers.push_back(&consumer);
+    consumer.m_budget = this;
+  }
+  void remove(Consumer &consumer) noexcept;
+
+  // Logical clock for consumers to stamp their entries with on use.
+  u64 tick() noexcept { return ++m_clock; }
+
+  void set_open(workspace::FileId file, bool open);
+  bool is_open(workspace::FileId file) const noexcept {
+    return m_open.contains(file);
+  }
+
+  u64 usage() const noexcept;
+  // Evicts until usage is back under the limit, or nothing evictable is
+  // left.
+  void enforce() noexcept;
+};
+
+} // namespace memory
@@ -2,8 +2,10 @@
 #include <cstdint>
 
 using i64 = std::int64_t;
+using i32 = std::int32_t;
 
 using u64 = std::uint64_t;
+using u32 = std::uint32_t;
 using u16 = std::uint16_t;
 using u8 = std::uint8_t;
 
@@ -1,4 +1,9 @@
+#pragma once
 #include "json.h"
+#include <cstdio>
+
+// Tolerance used when accepting JSON numbers as integers.
+static constexpr f64 INT_CONVERSION_TOLERANCE = 0.000000001;
 
 // Base Protocol :
 // https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#baseProtocol
@@ -24,6 +29,12 @@ public:
   // RequestMessage has an "id", which is what this method checks.
   static bool identify(json::value const &) noexcept;
   static std::optional<RequestMessage> validate(json::value &) noexcept;
+
+  // A request from the server to the client.
+  static RequestMessage create(std::variant<json::string, i64> id,
+                               json::string method,
+                               std::optional<json::value> params) noexcept;
+  static void dump(RequestMessage, json::object &) noexcept;
 };
 
 enum class ErrorCode : i64 {
@@ -64,6 +75,7 @@ struct ResponseError {
   json::string message;
   std::optional<json::value> data;
 
+  static std::optional<ResponseError> validate(json::value &) noexcept;
   static void dump(ResponseError, json::object &) noexcept;
 };
 
@@ -88,6 +100,10 @@ struct ResponseMessage {
       ResponseError error) noexcept {
     return ResponseMessage{std::move(id), std::nullopt, std::move(error)};
   }
+  // Responses from the client, to the requests of the server, have an "id"
+  // but no "method".
+  static bool identify(json::value const &) noexcept;
+  static std::optional<ResponseMessage> validate(json::value &) noexcept;
   static void dump(ResponseMessage, json::object &) noexcept;
 };
 // https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#notificationMessage
@@ -98,6 +114,7 @@ struct NotificationMessage {
   std::optional<json::value> params;
 
   static std::optional<NotificationMessage> validate(json::value &) noexcept;
+  static void dump(NotificationMessage, json::object &) noexcept;
 };
 
 // NOTE: Notification and requests whose methods start with ‘$/’ are messages
@@ -124,6 +141,31 @@ struct CancelParams {
   static std::optional<CancelParams> validate(json::value &) noexcept;
 };
 
-// TODO: Progress Support : https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#progress
+// Header Part + Content Part framing.
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#headerPart
+//
+// Reads a whole message content, or nothing if the stream ended or the
+// header was malformed. Contents of more than `MAX_CONTENT_LENGTH` bytes are
+// skipped instead, so that the next message can be read.
+inline constexpr u64 MAX_CONTENT_LENGTH = u64(64) << 20;
+struct Content {
+  std::string text;
+  // whether the content was skipped for being too long
+  bool oversized;
+};
+std::optional<Content> read_message(std::FILE *) noexcept;
+// Serializes `message` and writes it with its header. Returns whether the
+// whole message was written.
+bool write_message(std::FILE *, json::value const &message) noexcept;
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#progress
+struct ProgressParams {
+  // The progress token provided by the client or server.
+  std::variant<json::string, i64> token;
+  // The progress data.
+  json::value value;
+
+  static void dump(ProgressParams, json::object &) noexcept;
+};
 
 } // namespace rpc::base
@@ -0,0 +1,933 @@
+#include <rpc/base.h>
+#include <rpc/lsp.h>
+
+namespace rpc::lsp {
+
+static std::optional<json::string> take_string(json::object &obj,
+                                               std::u16string_view key) {
+  auto value = obj.remove(key);
+  if (!value || !value->is_string())
+    return std::nullopt;
+  return json::string(value->as_string());
+}
+
+static std::optional<i64> take_integer(json::object &obj,
+                                       std::u16string_view key) {
+  auto value = obj.remove(key);
+  if (!value)
+    return std::nullopt;
+  return value->try_integer(INT_CONVERSION_TOLERANCE);
+}
+
+std::optional<Position> Position::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // Position.line : uinteger
+  auto const line = take_integer(obj, u"line");
+  if (!line || *line < 0)
+    return std::nullopt;
+  // Position.character : uinteger
+  auto const character = take_integer(obj, u"character");
+  if (!character || *character < 0)
+    return std::nullopt;
+
+  return Position{static_cast<u64>(*line), static_cast<u64>(*character)};
+}
+
+void Position::dump(Position position, json::object &target) noexcept {
+  target.set(u"line", static_cast<f64>(position.line));
+  target.set(u"character", static_cast<f64>(position.character));
+}
+
+std::optional<Range> Range::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // Range.start : Position
+  auto start = obj.remove(u"start");
+  if (!start)
+    return std::nullopt;
+  auto const start_position = Position::validate(*start);
+  if (!start_position)
+    return std::nullopt;
+
+  // Range.end : Position
+  auto end = obj.remove(u"end");
+  if (!end)
+    return std::nullopt;
+  auto const end_position = Position::validate(*end);
+  if (!end_position)
+    return std::nullopt;
+
+  return Range{*start_position, *end_position};
+}
+
+void Range::dump(Range range, json::object &target) noexcept {
+  json::object start, end;
+  Position::dump(range.start, start);
+  Position::dump(range.end, end);
+  target.set(u"start", std::move(start));
+  target.set(u"end", std::move(end));
+}
+
+std::optional<TextDocumentItem>
+TextDocumentItem::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // TextDocumentItem.uri : DocumentUri
+  auto uri = take_string(obj, u"uri");
+  if (!uri)
+    return std::nullopt;
+  // TextDocumentItem.languageId : string
+  auto language_id = take_string(obj, u"languageId");
+  if (!language_id)
+    return std::nullopt;
+  // TextDocumentItem.version : integer
+  auto const version = take_integer(obj, u"version");
+  if (!version)
+    return std::nullopt;
+  // TextDocumentItem.text : string
+  auto text = take_string(obj, u"text");
+  if (!text)
+    return std::nullopt;
+
+  return TextDocumentItem{std::move(*uri), std::move(*language_id), *version,
+                          std::move(*text)};
+}
+
+std::optional<TextDocumentIdentifier>
+TextDocumentIdentifier::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+
+  // TextDocumentIdentifier.uri : DocumentUri
+  auto uri = take_string(input.as_object(), u"uri");
+  if (!uri)
+    return std::nullopt;
+
+  return TextDocumentIdentifier{std::move(*uri)};
+}
+
+std::optional<VersionedTextDocumentIdentifier>
+VersionedTextDocumentIdentifier::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // VersionedTextDocumentIdentifier extends TextDocumentIdentifier
+  auto uri = take_string(obj, u"uri");
+  if (!uri)
+    return std::nullopt;
+  // VersionedTextDocumentIdentifier.version : integer
+  auto const version = take_integer(obj, u"version");
+  if (!version)
+    return std::nullopt;
+
+  return VersionedTextDocumentIdentifier{std::move(*uri), *version};
+}
+
+std::optional<WorkspaceFolder>
+WorkspaceFolder::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // WorkspaceFolder.uri : URI
+  auto uri = take_string(obj, u"uri");
+  if (!uri)
+    return std::nullopt;
+  // WorkspaceFolder.name : string
+  auto name = take_string(obj, u"name");
+  if (!name)
+    return std::nullopt;
+
+  return WorkspaceFolder{std::move(*uri), std::move(*name)};
+}
+
+// Validates the `textDocument` of params that have nothing else needed.
+static std::optional<TextDocumentIdentifier>
+take_text_document(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto text_document = input.as_object().remove(u"textDocument");
+  if (!text_document)
+    return std::nullopt;
+  return TextDocumentIdentifier::validate(*text_document);
+}
+
+std::optional<InitializeParams>
+InitializeParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+  InitializeParams params;
+
+  // InitializeParams.processId : integer | null
+  {
+    auto process_id = obj.remove(u"processId");
+    if (!process_id)
+      return std::nullopt;
+    if (!process_id->is_null()) {
+      params.process_id = process_id->try_integer(INT_CONVERSION_TOLERANCE);
+      if (!params.process_id)
+        return std::nullopt;
+    }
+  }
+
+  // InitializeParams.rootUri : DocumentUri | null
+  {
+    auto root_uri = obj.remove(u"rootUri");
+    if (root_uri && root_uri->is_string())
+      params.root_uri = root_uri->as_string();
+    else if (root_uri && !root_uri->is_null())
+      return std::nullopt;
+  }
+
+  // InitializeParams.initializationOptions : LSPAny
+  params.initialization_options = obj.remove(u"initializationOptions");
+
+  // InitializeParams.workspaceFolders : WorkspaceFolder[] | null
+  if (auto folders = obj.remove(u"workspaceFolders");
+      folders && folders->is_array()) {
+    params.workspace_folders.emplace();
+    for (auto &folder : folders->as_array()) {
+      auto workspace_folder = WorkspaceFolder::validate(folder);
+      if (!workspace_folder)
+        return std::nullopt;
+      params.workspace_folders->emplace_back(std::move(*workspace_folder));
+    }
+  } else if (folders && !folders->is_null()) {
+    return std::nullopt;
+  }
+
+  // InitializeParams.capabilities : ClientCapabilities
+  //
+  // Only read for what the server uses: anything missing or unexpected means
+  // unsupported.
+  if (auto capabilities = obj.remove(u"capabilities");
+      capabilities && capabilities->is_object()) {
+    auto const &client = capabilities->as_object();
+    // ClientCapabilities.window.workDoneProgress : boolean
+    if (client.has_key(u"window")) {
+      auto const &window = client.expect(u"window");
+      params.work_done_progress =
+          window.is_object() &&
+          window.as_object().has_key(u"workDoneProgress") &&
+          window.as_object().expect(u"workDoneProgress").is_bool() &&
+          window.as_object().expect(u"workDoneProgress").as_bool();
+    }
+    // ClientCapabilities.textDocument.diagnostic :
+    //   DiagnosticClientCapabilities
+    if (client.has_key(u"textDocument")) {
+      auto const &text_document = client.expect(u"textDocument");
+      params.pull_diagnostics =
+          text_document.is_object() &&
+          text_document.as_object().has_key(u"diagnostic") &&
+          text_document.as_object().expect(u"diagnostic").is_object();
+    }
+    // ClientCapabilities.workspace.diagnostics.refreshSupport : boolean
+    if (client.has_key(u"workspace")) {
+      auto const &workspace = client.expect(u"workspace");
+      if (workspace.is_object() &&
+          workspace.as_object().has_key(u"diagnostics")) {
+        auto const &diagnostics = workspace.as_object().expect(u"diagnostics");
+        params.diagnostic_refresh =
+            diagnostics.is_object() &&
+            diagnostics.as_object().has_key(u"refreshSupport") &&
+            diagnostics.as_object().expect(u"refreshSupport").is_bool() &&
+            diagnostics.as_object().expect(u"refreshSupport").as_bool();
+      }
+    }
+  }
+
+  return params;
+}
+
+void ServerCapabilities::dump(ServerCapabilities capabilities,
+                              json::object &target) noexcept {
+  // ServerCapabilities.textDocumentSync : TextDocumentSyncOptions
+  json::object sync;
+  sync.set(u"openClose", true);
+  sync.set(u"change", static_cast<f64>(capabilities.text_document_sync));
+  target.set(u"textDocumentSync", std::move(sync));
+
+  // ServerCapabilities.documentSymbolProvider : boolean
+  if (capabilities.document_symbol_provider)
+    target.set(u"documentSymbolProvider", true);
+  // ServerCapabilities.foldingRangeProvider : boolean
+  if (capabilities.folding_range_provider)
+    target.set(u"foldingRangeProvider", true);
+  // ServerCapabilities.selectionRangeProvider : boolean
+  if (capabilities.selection_range_provider)
+    target.set(u"selectionRangeProvider", true);
+  // ServerCapabilities.workspaceSymbolProvider : boolean
+  if (capabilities.workspace_symbol_provider)
+    target.set(u"workspaceSymbolProvider", true);
+  // ServerCapabilities.referencesProvider : boolean
+  if (capabilities.references_provider)
+    target.set(u"referencesProvider", true);
+  // ServerCapabilities.renameProvider : boolean
+  if (capabilities.rename_provider)
+    target.set(u"renameProvider", true);
+  // ServerCapabilities.completionProvider : CompletionOptions
+  if (capabilities.completion_provider)
+    target.set(u"completionProvider", json::object());
+  // ServerCapabilities.semanticTokensProvider : SemanticTokensOptions
+  if (capabilities.semantic_tokens_provider) {
+    // SemanticTokensLegend, in the order of `features::TokenType` and
+    // `features::TokenModifier`.
+    json::array types, modifiers;
+    for (auto const type :
+         {u"namespace", u"class", u"enum", u"interface", u"struct",
+          u"property", u"enumMember", u"function", u"method", u"variable",
+          u"keyword", u"comment", u"string", u"number", u"operator"})
+      types.emplace_back(json::string(type));
+    modifiers.emplace_back(json::string(u"declaration"));
+    json::object legend, full, options;
+    legend.set(u"tokenTypes", std::move(types));
+    legend.set(u"tokenModifiers", std::move(modifiers));
+    full.set(u"delta", true);
+    options.set(u"legend", std::move(legend));
+    options.set(u"range", true);
+    options.set(u"full", std::move(full));
+    target.set(u"semanticTokensProvider", std::move(options));
+  }
+  // ServerCapabilities.diagnosticProvider : DiagnosticOptions
+  if (capabilities.diagnostic_provider) {
+    json::object options;
+    options.set(u"interFileDependencies",
+                capabilities.inter_file_diagnostics);
+    options.set(u"workspaceDiagnostics", true);
+    target.set(u"diagnosticProvider", std::move(options));
+  }
+}
+
+void InitializeResult::dump(InitializeResult result,
+                            json::object &target) noexcept {
+  json::object capabilities;
+  ServerCapabilities::dump(result.capabilities, capabilities);
+  target.set(u"capabilities", std::move(capabilities));
+
+  // InitializeResult.serverInfo : { name : string }
+  json::object server_info;
+  server_info.set(u"name", json::string(u"jakt-lsp"));
+  target.set(u"serverInfo", std::move(server_info));
+}
+
+std::optional<DidOpenTextDocumentParams>
+DidOpenTextDocumentParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+
+  // DidOpenTextDocumentParams.textDocument : TextDocumentItem
+  auto text_document = input.as_object().remove(u"textDocument");
+  if (!text_document)
+    return std::nullopt;
+  auto item = TextDocumentItem::validate(*text_document);
+  if (!item)
+    return std::nullopt;
+
+  return DidOpenTextDocumentParams{std::move(*item)};
+}
+
+std::optional<TextDocumentContentChangeEvent>
+TextDocumentContentChangeEvent::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+  TextDocumentContentChangeEvent event;
+
+  // TextDocumentContentChangeEvent.range : Range?
+  if (auto range = obj.remove(u"range"); range) {
+    event.range = Range::validate(*range);
+    if (!event.range)
+      return std::nullopt;
+  }
+
+  // TextDocumentContentChangeEvent.text : string
+  auto text = take_string(obj, u"text");
+  if (!text)
+    return std::nullopt;
+  event.text = std::move(*text);
+
+  return event;
+}
+
+std::optional<DidChangeTextDocumentParams>
+DidChangeTextDocumentParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+  DidChangeTextDocumentParams params;
+
+  // DidChangeTextDocumentParams.textDocument : VersionedTextDocumentIdentifier
+  {
+    auto text_document = obj.remove(u"textDocument");
+    if (!text_document)
+      return std::nullopt;
+    auto identifier = VersionedTextDocumentIdentifier::validate(*text_document);
+    if (!identifier)
+      return std::nullopt;
+    params.text_document = std::move(*identifier);
+  }
+
+  // DidChangeTextDocumentParams.contentChanges :
+  //   TextDocumentContentChangeEvent[]
+  {
+    auto changes = obj.remove(u"contentChanges");
+    if (!changes || !changes->is_array())
+      return std::nullopt;
+    for (auto &change : changes->as_array()) {
+      auto event = TextDocumentContentChangeEvent::validate(change);
+      if (!event)
+        return std::nullopt;
+      params.content_changes.emplace_back(std::move(*event));
+    }
+  }
+
+  return params;
+}
+
+std::optional<DidCloseTextDocumentParams>
+DidCloseTextDocumentParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+
+  // DidCloseTextDocumentParams.textDocument : TextDocumentIdentifier
+  auto text_document = input.as_object().remove(u"textDocument");
+  if (!text_document)
+    return std::nullopt;
+  auto identifier = TextDocumentIdentifier::validate(*text_document);
+  if (!identifier)
+    return std::nullopt;
+
+  return DidCloseTextDocumentParams{std::move(*identifier)};
+}
+
+std::optional<FileEvent> FileEvent::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // FileEvent.uri : DocumentUri
+  auto uri = take_string(obj, u"uri");
+  if (!uri)
+    return std::nullopt;
+  // FileEvent.type : FileChangeType
+  auto const type = take_integer(obj, u"type");
+  if (!type || *type < 1 || *type > 3)
+    return std::nullopt;
+
+  return FileEvent{std::move(*uri), *type};
+}
+
+std::optional<DidChangeWatchedFilesParams>
+DidChangeWatchedFilesParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  DidChangeWatchedFilesParams params;
+
+  // DidChangeWatchedFilesParams.changes : FileEvent[]
+  auto changes = input.as_object().remove(u"changes");
+  if (!changes || !changes->is_array())
+    return std::nullopt;
+  for (auto &change : changes->as_array()) {
+    auto event = FileEvent::validate(change);
+    if (!event)
+      return std::nullopt;
+    params.changes.emplace_back(std::move(*event));
+  }
+
+  return params;
+}
+
+std::optional<DocumentSymbolParams>
+DocumentSymbolParams::validate(json::value &input) noexcept {
+  // DocumentSymbolParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+
+  return DocumentSymbolParams{std::move(*text_document)};
+}
+
+void DocumentSymbol::dump(DocumentSymbol symbol,
+                          json::object &target) noexcept {
+  json::object range, selection_range;
+  Range::dump(symbol.range, range);
+  Range::dump(symbol.selection_range, selection_range);
+  target.set(u"name", std::move(symbol.name));
+  target.set(u"kind", static_cast<f64>(symbol.kind));
+  target.set(u"range", std::move(range));
+  target.set(u"selectionRange", std::move(selection_range));
+
+  // DocumentSymbol.children : DocumentSymbol[]
+  if (symbol.children.empty())
+    return;
+  json::array children;
+  children.reserve(symbol.children.size());
+  for (auto &child : symbol.children) {
+    json::object object;
+    dump(std::move(child), object);
+    children.emplace_back(std::move(object));
+  }
+  target.set(u"children", std::move(children));
+}
+
+std::optional<FoldingRangeParams>
+FoldingRangeParams::validate(json::value &input) noexcept {
+  // FoldingRangeParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+
+  return FoldingRangeParams{std::move(*text_document)};
+}
+
+void FoldingRange::dump(FoldingRange range, json::object &target) noexcept {
+  target.set(u"startLine", static_cast<f64>(range.start_line));
+  target.set(u"endLine", static_cast<f64>(range.end_line));
+
+  // FoldingRange.kind : FoldingRangeKind
+  if (!range.kind)
+    return;
+  switch (*range.kind) {
+  case FoldingRangeKind::Comment:
+    target.set(u"kind", json::string(u"comment"));
+    break;
+  case FoldingRangeKind::Imports:
+    target.set(u"kind", json::string(u"imports"));
+    break;
+  case FoldingRangeKind::Region:
+    target.set(u"kind", json::string(u"region"));
+    break;
+  }
+}
+
+std::optional<SelectionRangeParams>
+SelectionRangeParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+  SelectionRangeParams params;
+
+  // SelectionRangeParams.positions : Position[]
+  {
+    auto positions = obj.remove(u"positions");
+    if (!positions || !positions->is_array())
+      return std::nullopt;
+    for (auto &position : positions->as_array()) {
+      auto valid = Position::validate(position);
+      if (!valid)
+        return std::nullopt;
+      params.positions.push_back(*valid);
+    }
+  }
+
+  // SelectionRangeParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+  params.text_document = std::move(*text_document);
+
+  return params;
+}
+
+void SelectionRange::dump(SelectionRange selection,
+                          json::object &target) noexcept {
+  // built from the outermost range in, each one holding its parent.
+  json::object parent;
+  for (auto range = selection.ranges.rbegin();
+       range != selection.ranges.rend(); ++range) {
+    json::object object, dumped;
+    Range::dump(*range, dumped);
+    object.set(u"range", std::move(dumped));
+    if (range != selection.ranges.rbegin())
+      object.set(u"parent", std::move(parent));
+    parent = std::move(object);
+  }
+  target = std::move(parent);
+}
+
+void Location::dump(Location location, json::object &target) noexcept {
+  json::object range;
+  Range::dump(location.range, range);
+  target.set(u"uri", std::move(location.uri));
+  target.set(u"range", std::move(range));
+}
+
+std::optional<WorkspaceSymbolParams>
+WorkspaceSymbolParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+
+  // WorkspaceSymbolParams.query : string
+  auto query = take_string(input.as_object(), u"query");
+  if (!query)
+    return std::nullopt;
+
+  return WorkspaceSymbolParams{std::move(*query)};
+}
+
+void SymbolInformation::dump(SymbolInformation symbol,
+                             json::object &target) noexcept {
+  json::object location;
+  Location::dump(std::move(symbol.location), location);
+  target.set(u"name", std::move(symbol.name));
+  target.set(u"kind", static_cast<f64>(symbol.kind));
+  target.set(u"location", std::move(location));
+
+  // SymbolInformation.containerName : string
+  if (symbol.container_name)
+    target.set(u"containerName", std::move(*symbol.container_name));
+}
+
+// TextDocumentPositionParams.position : Position
+static std::optional<Position> take_position(json::object &obj) noexcept {
+  auto position = obj.remove(u"position");
+  if (!position)
+    return std::nullopt;
+  return Position::validate(*position);
+}
+
+std::optional<ReferenceParams>
+ReferenceParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  auto const position = take_position(obj);
+  if (!position)
+    return std::nullopt;
+
+  // ReferenceParams.context : ReferenceContext
+  auto context = obj.remove(u"context");
+  if (!context || !context->is_object())
+    return std::nullopt;
+  // ReferenceContext.includeDeclaration : boolean
+  auto const include = context->as_object().remove(u"includeDeclaration");
+  if (!include || !include->is_bool())
+    return std::nullopt;
+
+  // ReferenceParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+
+  return ReferenceParams{std::move(*text_document), *position,
+                         include->as_bool()};
+}
+
+std::optional<RenameParams>
+RenameParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  auto const position = take_position(obj);
+  if (!position)
+    return std::nullopt;
+  // RenameParams.newName : string
+  auto new_name = take_string(obj, u"newName");
+  if (!new_name)
+    return std::nullopt;
+
+  // RenameParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+
+  return RenameParams{std::move(*text_document), *position,
+                      std::move(*new_name)};
+}
+
+void TextEdit::dump(TextEdit edit, json::object &target) noexcept {
+  json::object range;
+  Range::dump(edit.range, range);
+  target.set(u"range", std::move(range));
+  target.set(u"newText", std::move(edit.new_text));
+}
+
+void WorkspaceEdit::dump(WorkspaceEdit edit, json::object &target) noexcept {
+  // WorkspaceEdit.changes : { [uri: DocumentUri]: TextEdit[] }
+  json::object changes;
+  for (auto &[uri, edits] : edit.changes) {
+    json::array array;
+    array.reserve(edits.size());
+    for (auto &text_edit : edits) {
+      json::object object;
+      TextEdit::dump(std::move(text_edit), object);
+      array.emplace_back(std::move(object));
+    }
+    changes.set(std::move(uri), std::move(array));
+  }
+  target.set(u"changes", std::move(changes));
+}
+
+std::optional<CompletionParams>
+CompletionParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+
+  auto const position = take_position(input.as_object());
+  if (!position)
+    return std::nullopt;
+  // CompletionParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+
+  return CompletionParams{std::move(*text_document), *position};
+}
+
+void CompletionItem::dump(CompletionItem item, json::object &target) noexcept {
+  target.set(u"label", std::move(item.label));
+  target.set(u"kind", static_cast<f64>(item.kind));
+}
+
+void CompletionList::dump(CompletionList list, json::object &target) noexcept {
+  target.set(u"isIncomplete", list.is_incomplete);
+  json::array items;
+  items.reserve(list.items.size());
+  for (auto &item : list.items) {
+    json::object object;
+    CompletionItem::dump(std::move(item), object);
+    items.emplace_back(std::move(object));
+  }
+  target.set(u"items", std::move(items));
+}
+
+std::optional<SemanticTokensParams>
+SemanticTokensParams::validate(json::value &input) noexcept {
+  // SemanticTokensParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+  return SemanticTokensParams{std::move(*text_document)};
+}
+
+std::optional<SemanticTokensDeltaParams>
+SemanticTokensDeltaParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  // SemanticTokensDeltaParams.previousResultId : string
+  auto previous = take_string(input.as_object(), u"previousResultId");
+  if (!previous)
+    return std::nullopt;
+  // SemanticTokensDeltaParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+  return SemanticTokensDeltaParams{std::move(*text_document),
+                                   std::move(*previous)};
+}
+
+std::optional<SemanticTokensRangeParams>
+SemanticTokensRangeParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  // SemanticTokensRangeParams.range : Range
+  auto range = input.as_object().remove(u"range");
+  if (!range)
+    return std::nullopt;
+  auto const valid = Range::validate(*range);
+  if (!valid)
+    return std::nullopt;
+  // SemanticTokensRangeParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+  return SemanticTokensRangeParams{std::move(*text_document), *valid};
+}
+
+static json::array dump_data(std::vector<u32> const &data) {
+  json::array array;
+  array.reserve(data.size());
+  for (auto const value : data)
+    array.emplace_back(static_cast<f64>(value));
+  return array;
+}
+
+void SemanticTokens::dump(SemanticTokens tokens,
+                          json::object &target) noexcept {
+  if (tokens.result_id)
+    target.set(u"resultId", std::move(*tokens.result_id));
+  target.set(u"data", dump_data(tokens.data));
+}
+
+void SemanticTokensDelta::dump(SemanticTokensDelta delta,
+                               json::object &target) noexcept {
+  target.set(u"resultId", std::move(delta.result_id));
+  json::array edits;
+  edits.reserve(delta.edits.size());
+  for (auto const &edit : delta.edits) {
+    // SemanticTokensEdit : { start, deleteCount, data? }
+    json::object object;
+    object.set(u"start", static_cast<f64>(edit.start));
+    object.set(u"deleteCount", static_cast<f64>(edit.delete_count));
+    if (!edit.data.empty())
+      object.set(u"data", dump_data(edit.data));
+    edits.emplace_back(std::move(object));
+  }
+  target.set(u"edits", std::move(edits));
+}
+
+void Diagnostic::dump(Diagnostic diagnostic, json::object &target) noexcept {
+  json::object range;
+  Range::dump(diagnostic.range, range);
+  target.set(u"range", std::move(range));
+  target.set(u"severity", static_cast<f64>(diagnostic.severity));
+  target.set(u"source", json::string(u"jakt-lsp"));
+  target.set(u"message", std::move(diagnostic.message));
+}
+
+static json::array dump_diagnostics(std::vector<Diagnostic> diagnostics) {
+  json::array array;
+  array.reserve(diagnostics.size());
+  for (auto &diagnostic : diagnostics) {
+    json::object object;
+    Diagnostic::dump(std::move(diagnostic), object);
+    array.emplace_back(std::move(object));
+  }
+  return array;
+}
+
+void PublishDiagnosticsParams::dump(PublishDiagnosticsParams params,
+                                    json::object &target) noexcept {
+  target.set(u"uri", std::move(params.uri));
+  if (params.version)
+    target.set(u"version", static_cast<f64>(*params.version));
+  target.set(u"diagnostics", dump_diagnostics(std::move(params.diagnostics)));
+}
+
+std::optional<DocumentDiagnosticParams>
+DocumentDiagnosticParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  DocumentDiagnosticParams params;
+
+  // DocumentDiagnosticParams.previousResultId : string
+  if (auto previous = input.as_object().remove(u"previousResultId");
+      previous && previous->is_string())
+    params.previous_result_id = previous->as_string();
+  else if (previous)
+    return std::nullopt;
+
+  // DocumentDiagnosticParams.textDocument : TextDocumentIdentifier
+  auto text_document = take_text_document(input);
+  if (!text_document)
+    return std::nullopt;
+  params.text_document = std::move(*text_document);
+
+  return params;
+}
+
+std::optional<WorkspaceDiagnosticParams>
+WorkspaceDiagnosticParams::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  WorkspaceDiagnosticParams params;
+
+  // WorkspaceDiagnosticParams.previousResultIds : PreviousResultId[]
+  auto previous = input.as_object().remove(u"previousResultIds");
+  if (!previous || !previous->is_array())
+    return std::nullopt;
+  for (auto &entry : previous->as_array()) {
+    if (!entry.is_object())
+      return std::nullopt;
+    // PreviousResultId.uri : DocumentUri
+    auto uri = take_string(entry.as_object(), u"uri");
+    if (!uri)
+      return std::nullopt;
+    // PreviousResultId.value : string
+    auto value = take_string(entry.as_object(), u"value");
+    if (!value)
+      return std::nullopt;
+    params.previous_result_ids.emplace_back(std::move(*uri),
+                                            std::move(*value));
+  }
+
+  return params;
+}
+
+void DocumentDiagnosticReport::dump(DocumentDiagnosticReport report,
+                                    json::object &target) noexcept {
+  // FullDocumentDiagnosticReport | UnchangedDocumentDiagnosticReport
+  target.set(u"kind", json::string(report.items ? u"full" : u"unchanged"));
+  target.set(u"resultId", std::move(report.result_id));
+  if (report.items)
+    target.set(u"items", dump_diagnostics(std::move(*report.items)));
+}
+
+void WorkspaceDocumentDiagnosticReport::dump(
+    WorkspaceDocumentDiagnosticReport report, json::object &target) noexcept {
+  DocumentDiagnosticReport::dump(std::move(report.report), target);
+  target.set(u"uri", std::move(report.uri));
+  // WorkspaceFullDocumentDiagnosticReport.version : integer | null
+  if (report.version)
+    target.set(u"version", static_cast<f64>(*report.version));
+  else
+    target.set(u"version", json::null{});
+}
+
+void WorkspaceDiagnosticReport::dump(WorkspaceDiagnosticReport report,
+                                     json::object &target) noexcept {
+  json::array items;
+  items.reserve(report.items.size());
+  for (auto &item : report.items) {
+    json::object object;
+    WorkspaceDocumentDiagnosticReport::dump(std::move(item), object);
+    items.emplace_back(std::move(object));
+  }
+  target.set(u"items", std::move(items));
+}
+
+void WorkDoneProgressCreateParams::dump(WorkDoneProgressCreateParams params,
+                                        json::object &target) noexcept {
+  // WorkDoneProgressCreateParams.token : ProgressToken
+  if (auto const token = std::get_if<json::string>(&params.token); token)
+    target.set(u"token", std::move(*token));
+  else
+    target.set(u"token", static_cast<f64>(std::get<i64>(params.token)));
+}
+
+void WorkDoneProgressBegin::dump(WorkDoneProgressBegin progress,
+                                 json::object &target) noexcept {
+  target.set(u"kind", json::string(u"begin"));
+  target.set(u"title", std::move(progress.title));
+  if (progress.message)
+    target.set(u"message", std::move(*progress.message));
+  if (progress.percentage)
+    target.set(u"percentage", static_cast<f64>(*progress.percentage));
+}
+
+void WorkDoneProgressReport::dump(WorkDoneProgressReport progress,
+                                  json::object &target) noexcept {
+  target.set(u"kind", json::string(u"report"));
+  if (progress.message)
+    target.set(u"message", std::move(*progress.message));
+  if (progress.percentage)
+    target.set(u"percentage", static_cast<f64>(*progress.percentage));
+}
+
+void WorkDoneProgressEnd::dump(WorkDoneProgressEnd progress,
+                               json::object &target) noexcept {
+  target.set(u"kind", json::string(u"end"));
+  if (progress.message)
+    target.set(u"message", std::move(*progress.message));
+}
+
+void LogMessageParams::dump(LogMessageParams params,
+                            json::object &target) noexcept {
+  // LogMessageParams.type : MessageType
+  target.set(u"type", static_cast<f64>(params.type));
+  // LogMessageParams.message : string
+  target.set(u"message", std::move(params.message));
+}
+
+} // namespace rpc::lsp
@@ -0,0 +1,558 @@
+#pragma once
+#include "json.h"
+
+// Language Server Protocol structures on top of the base protocol.
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#languageServerProtocol
+namespace rpc::lsp {
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#position
+struct Position {
+  // Line position in a document (zero-based).
+  u64 line;
+  // Character offset on a line in a document (zero-based), in UTF-16 code
+  // units.
+  u64 character;
+
+  static std::optional<Position> validate(json::value &) noexcept;
+  static void dump(Position, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#range
+struct Range {
+  Position start;
+  // The range's end position, exclusive.
+  Position end;
+
+  static std::optional<Range> validate(json::value &) noexcept;
+  static void dump(Range, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#textDocumentItem
+struct TextDocumentItem {
+  json::string uri;
+  json::string language_id;
+  i64 version;
+  json::string text;
+
+  static std::optional<TextDocumentItem> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#textDocumentIdentifier
+struct TextDocumentIdentifier {
+  json::string uri;
+
+  static std::optional<TextDocumentIdentifier> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#versionedTextDocumentIdentifier
+struct VersionedTextDocumentIdentifier {
+  json::string uri;
+  i64 version;
+
+  static std::optional<VersionedTextDocumentIdentifier>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#textDocumentSyncKind
+enum class TextDocumentSyncKind : i64 {
+  None = 0,
+  // Documents are synced by always sending the full content of the document.
+  Full = 1,
+  // Documents are synced by sending the full content on open. After that only
+  // incremental updates to the document are sent.
+  Incremental = 2,
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workspaceFolder
+struct WorkspaceFolder {
+  json::string uri;
+  json::string name;
+
+  static std::optional<WorkspaceFolder> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#initializeParams
+struct InitializeParams {
+  std::optional<i64> process_id;
+  std::optional<json::string> root_uri;
+  std::optional<json::value> initialization_options;
+  // Takes precedence over `root_uri` when present.
+  std::optional<std::vector<WorkspaceFolder>> workspace_folders;
+  // capabilities.window.workDoneProgress: whether the client shows progress
+  // started by the server.
+  bool work_done_progress = false;
+  // capabilities.textDocument.diagnostic: whether the client pulls
+  // diagnostics, instead of waiting for them to be published.
+  bool pull_diagnostics = false;
+  // capabilities.workspace.diagnostics.refreshSupport: whether the client
+  // pulls diagnostics again when asked to.
+  bool diagnostic_refresh = false;
+
+  static std::optional<InitializeParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#serverCapabilities
+struct ServerCapabilities {
+  TextDocumentSyncKind text_document_sync;
+  bool document_symbol_provider = false;
+  bool folding_range_provider = false;
+  bool selection_range_provider = false;
+  bool workspace_symbol_provider = false;
+  bool references_provider = false;
+  bool rename_provider = false;
+  bool completion_provider = false;
+  // semanticTokensProvider, with full, delta and range requests
+  bool semantic_tokens_provider = false;
+  // diagnosticProvider, with workspace diagnostics
+  bool diagnostic_provider = false;
+  // diagnosticProvider.interFileDependencies: whether diagnostics of a file
+  // depend on others
+  bool inter_file_diagnostics = false;
+
+  static void dump(ServerCapabilities, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#initializeResult
+struct InitializeResult {
+  ServerCapabilities capabilities;
+
+  static void dump(InitializeResult, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#didOpenTextDocumentParams
+struct DidOpenTextDocumentParams {
+  TextDocumentItem text_document;
+
+  static std::optional<DidOpenTextDocumentParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#textDocumentContentChangeEvent
+struct TextDocumentContentChangeEvent {
+  // The range of the document that changed. When missing, `text` is the
+  // whole new content of the document.
+  std::optional<Range> range;
+  json::string text;
+
+  static std::optional<TextDocumentContentChangeEvent>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#didChangeTextDocumentParams
+struct DidChangeTextDocumentParams {
+  VersionedTextDocumentIdentifier text_document;
+  // Changes must be applied in the order they are received, each one
+  // relative to the document state left by the previous one.
+  std::vector<TextDocumentContentChangeEvent> content_changes;
+
+  static std::optional<DidChangeTextDocumentParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#didCloseTextDocumentParams
+struct DidCloseTextDocumentParams {
+  TextDocumentIdentifier text_document;
+
+  static std::optional<DidCloseTextDocumentParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#fileEvent
+struct FileEvent {
+  json::string uri;
+  // 1 = Created, 2 = Changed, 3 = Deleted
+  i64 type;
+
+  static std::optional<FileEvent> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#didChangeWatchedFilesParams
+struct DidChangeWatchedFilesParams {
+  std::vector<FileEvent> changes;
+
+  static std::optional<DidChangeWatchedFilesParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#documentSymbolParams
+struct DocumentSymbolParams {
+  TextDocumentIdentifier text_document;
+
+  static std::optional<DocumentSymbolParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#symbolKind
+enum class SymbolKind : i64 {
+  File = 1,
+  Module = 2,
+  Namespace = 3,
+  Package = 4,
+  Class = 5,
+  Method = 6,
+  Property = 7,
+  Field = 8,
+  Constructor = 9,
+  Enum = 10,
+  Interface = 11,
+  Function = 12,
+  Variable = 13,
+  Constant = 14,
+  String = 15,
+  Number = 16,
+  Boolean = 17,
+  Array = 18,
+  Object = 19,
+  Key = 20,
+  Null = 21,
+  EnumMember = 22,
+  Struct = 23,
+  Event = 24,
+  Operator = 25,
+  TypeParameter = 26,
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#documentSymbol
+struct DocumentSymbol {
+  json::string name;
+  SymbolKind kind;
+  // Everything the symbol spans, including its body.
+  Range range;
+  // What to select when the symbol is picked, usually its name. Must be
+  // contained in `range`.
+  Range selection_range;
+  std::vector<DocumentSymbol> children;
+
+  static void dump(DocumentSymbol, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#foldingRangeParams
+struct FoldingRangeParams {
+  TextDocumentIdentifier text_document;
+
+  static std::optional<FoldingRangeParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#foldingRangeKind
+enum class FoldingRangeKind { Comment, Imports, Region };
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#foldingRange
+struct FoldingRange {
+  // zero-based lines, both included
+  u64 start_line;
+  u64 end_line;
+  std::optional<FoldingRangeKind> kind;
+
+  static void dump(FoldingRange, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#selectionRangeParams
+struct SelectionRangeParams {
+  TextDocumentIdentifier text_document;
+  std::vector<Position> positions;
+
+  static std::optional<SelectionRangeParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#selectionRange
+struct SelectionRange {
+  // Innermost first, each range being the parent of the one before and
+  // containing it.
+  std::vector<Range> ranges;
+
+  static void dump(SelectionRange, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#location
+struct Location {
+  json::string uri;
+  Range range;
+
+  static void dump(Location, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workspaceSymbolParams
+struct WorkspaceSymbolParams {
+  // A query string to filter symbols by. Clients may send an empty string
+  // here to request all symbols.
+  json::string query;
+
+  static std::optional<WorkspaceSymbolParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#symbolInformation
+struct SymbolInformation {
+  json::string name;
+  SymbolKind kind;
+  Location location;
+  // The name of the symbol containing this one, for clients to show.
+  std::optional<json::string> container_name;
+
+  static void dump(SymbolInformation, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#referenceParams
+struct ReferenceParams {
+  TextDocumentIdentifier text_document;
+  Position position;
+  // context.includeDeclaration: whether to include the declaration of the
+  // symbol along with its uses.
+  bool include_declaration;
+
+  static std::optional<ReferenceParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#renameParams
+struct RenameParams {
+  TextDocumentIdentifier text_document;
+  Position position;
+  json::string new_name;
+
+  static std::optional<RenameParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#textEdit
+struct TextEdit {
+  Range range;
+  json::string new_text;
+
+  static void dump(TextEdit, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workspaceEdit
+struct WorkspaceEdit {
+  // Edits by document URI. Edits of a document must not overlap.
+  std::vector<std::pair<json::string, std::vector<TextEdit>>> changes;
+
+  static void dump(WorkspaceEdit, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#completionParams
+struct CompletionParams {
+  TextDocumentIdentifier text_document;
+  Position position;
+
+  static std::optional<CompletionParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#completionItemKind
+enum class CompletionItemKind : i64 {
+  Text = 1,
+  Method = 2,
+  Function = 3,
+  Constructor = 4,
+  Field = 5,
+  Variable = 6,
+  Class = 7,
+  Interface = 8,
+  Module = 9,
+  Property = 10,
+  Unit = 11,
+  Value = 12,
+  Enum = 13,
+  Keyword = 14,
+  Snippet = 15,
+  Color = 16,
+  File = 17,
+  Reference = 18,
+  Folder = 19,
+  EnumMember = 20,
+  Constant = 21,
+  Struct = 22,
+  Event = 23,
+  Operator = 24,
+  TypeParameter = 25,
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#completionItem
+struct CompletionItem {
+  json::string label;
+  CompletionItemKind kind;
+
+  static void dump(CompletionItem, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#completionList
+struct CompletionList {
+  // Whether typing further should ask the server again, rather than filter
+  // `items` on the client.
+  bool is_incomplete;
+  std::vector<CompletionItem> items;
+
+  static void dump(CompletionList, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#semanticTokensParams
+struct SemanticTokensParams {
+  TextDocumentIdentifier text_document;
+
+  static std::optional<SemanticTokensParams> validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#semanticTokensDeltaParams
+struct SemanticTokensDeltaParams {
+  TextDocumentIdentifier text_document;
+  // The result id of a previous response, either full or a delta.
+  json::string previous_result_id;
+
+  static std::optional<SemanticTokensDeltaParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#semanticTokensRangeParams
+struct SemanticTokensRangeParams {
+  TextDocumentIdentifier text_document;
+  Range range;
+
+  static std::optional<SemanticTokensRangeParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#semanticTokens
+struct SemanticTokens {
+  // For the next delta request to refer to, if any.
+  std::optional<json::string> result_id;
+  // Five integers per token: line and start character, relative to the
+  // previous token, then length, type and modifiers.
+  std::vector<u32> data;
+
+  static void dump(SemanticTokens, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#semanticTokensEdit
+struct SemanticTokensEdit {
+  // in the data array of the previous result
+  u64 start;
+  u64 delete_count;
+  std::vector<u32> data;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#semanticTokensDelta
+struct SemanticTokensDelta {
+  json::string result_id;
+  std::vector<SemanticTokensEdit> edits;
+
+  static void dump(SemanticTokensDelta, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#diagnosticSeverity
+enum class DiagnosticSeverity : i64 {
+  Error = 1,
+  Warning = 2,
+  Information = 3,
+  Hint = 4,
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#diagnostic
+struct Diagnostic {
+  Range range;
+  DiagnosticSeverity severity;
+  json::string message;
+
+  static void dump(Diagnostic, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#publishDiagnosticsParams
+struct PublishDiagnosticsParams {
+  json::string uri;
+  // of the document the diagnostics are about, if it's open
+  std::optional<i64> version;
+  std::vector<Diagnostic> diagnostics;
+
+  static void dump(PublishDiagnosticsParams, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#documentDiagnosticParams
+struct DocumentDiagnosticParams {
+  TextDocumentIdentifier text_document;
+  // The result id of the last report the client got for the document.
+  std::optional<json::string> previous_result_id;
+
+  static std::optional<DocumentDiagnosticParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workspaceDiagnosticParams
+struct WorkspaceDiagnosticParams {
+  // previousResultIds, as pairs of a document URI and its last result id
+  std::vector<std::pair<json::string, json::string>> previous_result_ids;
+
+  static std::optional<WorkspaceDiagnosticParams>
+  validate(json::value &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#documentDiagnosticReport
+struct DocumentDiagnosticReport {
+  json::string result_id;
+  // Left out when nothing changed since the previous result id the client
+  // sent, for an `unchanged` report.
+  std::optional<std::vector<Diagnostic>> items;
+
+  static void dump(DocumentDiagnosticReport, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workspaceDocumentDiagnosticReport
+struct WorkspaceDocumentDiagnosticReport {
+  json::string uri;
+  // of the document, if it's open
+  std::optional<i64> version;
+  DocumentDiagnosticReport report;
+
+  static void dump(WorkspaceDocumentDiagnosticReport, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workspaceDiagnosticReport
+struct WorkspaceDiagnosticReport {
+  std::vector<WorkspaceDocumentDiagnosticReport> items;
+
+  static void dump(WorkspaceDiagnosticReport, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#window_workDoneProgress_create
+struct WorkDoneProgressCreateParams {
+  std::variant<json::string, i64> token;
+
+  static void dump(WorkDoneProgressCreateParams, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workDoneProgressBegin
+struct WorkDoneProgressBegin {
+  json::string title;
+  std::optional<json::string> message;
+  // 0 to 100, for clients to show a bar instead of a spinner.
+  std::optional<u64> percentage;
+
+  static void dump(WorkDoneProgressBegin, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workDoneProgressReport
+struct WorkDoneProgressReport {
+  std::optional<json::string> message;
+  std::optional<u64> percentage;
+
+  static void dump(WorkDoneProgressReport, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#workDoneProgressEnd
+struct WorkDoneProgressEnd {
+  std::optional<json::string> message;
+
+  static void dump(WorkDoneProgressEnd, json::object &) noexcept;
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#messageType
+enum class MessageType : i64 {
+  Error = 1,
+  Warning = 2,
+  Info = 3,
+  Log = 4,
+};
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#logMessageParams
+struct LogMessageParams {
+  MessageType type;
+  json::string message;
+
+  static void dump(LogMessageParams, json::object &) noexcept;
+};
+
+} // namespace rpc::lsp
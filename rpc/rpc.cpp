@@ -1,8 +1,30 @@
 #include <rpc/base.h>
-
-static constexpr f64 INT_CONVERSION_TOLERANCE = 0.000000001;
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory/accounting.h>
 
 namespace rpc::base {
+// Request ids and progress tokens : integer | string
+static json::value dump_id(std::variant<json::string, i64> id) noexcept {
+  if (auto const str = std::get_if<json::string>(&id); str)
+    return std::move(*str);
+  return static_cast<f64>(std::get<i64>(id));
+}
+
+// Reads them back, removing them from `obj`.
+static std::optional<std::variant<json::string, i64>>
+take_id(json::object &obj, std::u16string_view key) noexcept {
+  auto id = obj.remove(key);
+  if (!id)
+    return std::nullopt;
+  if (id->is_string())
+    return json::string(id->as_string());
+  if (auto const i = id->try_integer(INT_CONVERSION_TOLERANCE); i)
+    return *i;
+  return std::nullopt;
+}
+
 bool Message::validate(json::value &value) noexcept {
   // Message : object
   if (!value.is_object())
@@ -15,7 +37,7 @@ bool Message::validate(json::value &value) noexcept {
 }
 
 void Message::dump(json::object &target) noexcept {
-  target.set(u"jsonrpc", u"2.0");
+  target.set(u"jsonrpc", json::string(u"2.0"));
 }
 
 bool RequestMessage::identify(json::value const &value) noexcept {
@@ -34,16 +56,10 @@ RequestMessage::validate(json::value &input) noexcept {
 
   // RequestMessage.id : string | number
   {
-    auto id = obj.remove(u"id");
+    auto id = take_id(obj, u"id");
     if (!id)
       return std::nullopt;
-    if (id->is_string()) {
-      message.id = std::move(id->as_string());
-    } else if (auto const i = id->try_integer(INT_CONVERSION_TOLERANCE); i) {
-      message.id = *i;
-    } else {
-      return std::nullopt;
-    }
+    message.id = std::move(*id);
   }
 
   // RequestMessage.method : string
@@ -51,7 +67,7 @@ RequestMessage::validate(json::value &input) noexcept {
     auto method = obj.remove(u"method");
     if (!method || !method->is_string())
       return std::nullopt;
-    message.method = std::move(method->as_string());
+    message.method = method->as_string();
   }
 
   // RequestMessage.params : (array | object)?
@@ -66,6 +82,49 @@ RequestMessage::validate(json::value &input) noexcept {
   return message;
 }
 
+RequestMessage
+RequestMessage::create(std::variant<json::string, i64> id, json::string method,
+                       std::optional<json::value> params) noexcept {
+  RequestMessage message;
+  message.id = std::move(id);
+  message.method = std::move(method);
+  message.params = std::move(params);
+  return message;
+}
+
+void RequestMessage::dump(RequestMessage message,
+                          json::object &target) noexcept {
+  // RequestMessage extends Message
+  Message::dump(target);
+  target.set(u"id", dump_id(std::move(message.id)));
+  target.set(u"method", std::move(message.method));
+  if (message.params)
+    target.set(u"params", std::move(*message.params));
+}
+
+std::optional<ResponseError>
+ResponseError::validate(json::value &input) noexcept {
+  if (!input.is_object())
+    return std::nullopt;
+  auto &obj = input.as_object();
+
+  // ResponseError.code : integer
+  auto const code = obj.remove(u"code");
+  if (!code)
+    return std::nullopt;
+  auto const number = code->try_integer(INT_CONVERSION_TOLERANCE);
+  if (!number)
+    return std::nullopt;
+  // ResponseError.message : string
+  auto message = obj.remove(u"message");
+  if (!message || !message->is_string())
+    return std::nullopt;
+  // ResponseError.data : LSPAny
+  return ResponseError{static_cast<ErrorCode>(*number),
+                       json::string(message->as_string()),
+                       obj.remove(u"data")};
+}
+
 void ResponseError::dump(ResponseError error, json::object &target) noexcept {
   target.set(u"code", static_cast<f64>(error.code));
   target.set(u"message", std::move(error.message));
@@ -97,7 +156,51 @@ void ResponseMessage::dump(ResponseMessage message,
   }
 }
 
-std::optional<NotificationMessage> validate(json::value &input) noexcept {
+bool ResponseMessage::identify(json::value const &value) noexcept {
+  return value.is_object() && value.as_object().has_key(u"id") &&
+         !value.as_object().has_key(u"method");
+}
+
+std::optional<ResponseMessage>
+ResponseMessage::validate(json::value &input) noexcept {
+  // ResponseMessage extends Message
+  if (!Message::validate(input))
+    return std::nullopt;
+  auto &obj = input.as_object();
+  ResponseMessage message;
+
+  // ResponseMessage.id : integer | string | null
+  {
+    auto id = obj.remove(u"id");
+    if (!id)
+      return std::nullopt;
+    if (id->is_null()) {
+      message.id = json::null{};
+    } else if (id->is_string()) {
+      message.id = json::string(id->as_string());
+    } else if (auto const i = id->try_integer(INT_CONVERSION_TOLERANCE); i) {
+      message.id = *i;
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  // ResponseMessage.error : ResponseError
+  if (auto error = obj.remove(u"error"); error) {
+    message.error = ResponseError::validate(*error);
+    if (!message.error)
+      return std::nullopt;
+    return message;
+  }
+  // ResponseMessage.result : LSPAny
+  message.result = obj.remove(u"result");
+  if (!message.result)
+    message.result = json::null{};
+  return message;
+}
+
+std::optional<NotificationMessage>
+NotificationMessage::validate(json::value &input) noexcept {
   // NotificationMessage extends Message
   if (!Message::validate(input))
     return std::nullopt;
@@ -109,7 +212,7 @@ std::optional<NotificationMessage> validate(json::value &input) noexcept {
     auto method = obj.remove(u"method");
     if (!method || !method->is_string())
       return std::nullopt;
-    message.method = std::move(method->as_string());
+    message.method = method->as_string();
   }
 
   // NotificationMessage.params: (array | object)?
@@ -123,6 +226,15 @@ std::optional<NotificationMessage> validate(json::value &input) noexcept {
   return message;
 }
 
+void NotificationMessage::dump(NotificationMessage message,
+                               json::object &target) noexcept {
+  // NotificationMessage extends Message
+  Message::dump(target);
+  target.set(u"method", std::move(message.method));
+  if (message.params)
+    target.set(u"params", std::move(*message.params));
+}
+
 std::optional<CancelParams>
 CancelParams::validate(json::value &input) noexcept {
   if (!input.is_object())
@@ -132,20 +244,79 @@ CancelParams::validate(json::value &input) noexcept {
 
   // CancelParams.id : integer | string
   {
-    auto id = obj.remove(u"id");
+    auto id = take_id(obj, u"id");
     if (!id)
       return std::nullopt;
-    if (id->is_string()) {
-      params.id = std::move(id->as_string());
-    } else if (auto const num = id->try_integer(INT_CONVERSION_TOLERANCE);
-               num) {
-      params.id = *num;
-    } else {
+    params.id = std::move(*id);
+  }
+
+  return params;
+}
+
+std::optional<Content> read_message(std::FILE *in) noexcept {
+  memory::Tagged tagged(memory::Subsystem::Rpc);
+  static constexpr std::string_view content_length = "Content-Length: ";
+  std::optional<u64> length;
+  char line[256];
+
+  // headers are ASCII lines terminated by "\r\n", and the header part
+  // ends with an empty one.
+  for (;;) {
+    if (!std::fgets(line, sizeof line, in))
       return std::nullopt;
+    std::string_view header(line, std::strlen(line));
+    if (header.ends_with("\r\n"))
+      header.remove_suffix(2);
+    else if (header.ends_with('\n'))
+      header.remove_suffix(1);
+    if (header.empty())
+      break;
+    if (header.starts_with(content_length)) {
+      header.remove_prefix(content_length.size());
+      u64 value;
+      auto const [end, error] =
+          std::from_chars(header.data(), header.data() + header.size(), value);
+      if (error != std::errc{})
+        return std::nullopt;
+      length = value;
     }
+    // Content-Type is optional and we only support the default one.
   }
 
-  return params;
+  if (!length)
+    return std::nullopt;
+  // no client sends that much, and trusting it could take all memory.
+  if (*length > MAX_CONTENT_LENGTH) {
+    char chunk[64 * 1024];
+    for (auto left = *length; left != 0;) {
+      auto const size = std::min<u64>(left, sizeof chunk);
+      if (std::fread(chunk, 1, size, in) != size)
+        return std::nullopt;
+      left -= size;
+    }
+    return Content{{}, true};
+  }
+  std::string content(*length, '\0');
+  if (std::fread(content.data(), 1, content.size(), in) != content.size())
+    return std::nullopt;
+  return Content{std::move(content), false};
+}
+
+bool write_message(std::FILE *out, json::value const &message) noexcept {
+  memory::Tagged tagged(memory::Subsystem::Rpc);
+  auto const content = fmt::format("{}", message);
+  auto const header =
+      fmt::format("Content-Length: {}\r\n\r\n", content.size());
+  return std::fwrite(header.data(), 1, header.size(), out) == header.size() &&
+         std::fwrite(content.data(), 1, content.size(), out) ==
+             content.size() &&
+         std::fflush(out) == 0;
+}
+
+void ProgressParams::dump(ProgressParams params,
+                          json::object &target) noexcept {
+  target.set(u"token", dump_id(std::move(params.token)));
+  target.set(u"value", std::move(params.value));
 }
 
 } // namespace rpc::base
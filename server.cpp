@@ -0,0 +1,945 @@
+#include <features/outline.h>
+#include <features/references.h>
+#include <fmt/format.h>
+#include <logging/log.h>
+#include <memory/arena.h>
+#include <server.h>
+#include <workspace/file_ids.h>
+#include <workspace/hash.h>
+#include <workspace/mapped_file.h>
+#include <workspace/uri.h>
+
+using rpc::base::ErrorCode;
+using rpc::base::NotificationMessage;
+using rpc::base::RequestMessage;
+using rpc::base::ResponseError;
+using rpc::base::ResponseMessage;
+
+// Results for workspace/symbol, which clients filter further anyway.
+static constexpr u64 WORKSPACE_SYMBOL_LIMIT = 256;
+// The progress token of the background indexer.
+static constexpr std::u16string_view INDEXING_TOKEN = u"jakt-lsp/indexing";
+
+// Where the symbols of the workspace made of `roots` are saved: a file per
+// workspace in the user's cache directory.
+static std::optional<std::filesystem::path>
+symbols_path(std::vector<std::filesystem::path> const &roots) {
+  if (roots.empty())
+    return std::nullopt;
+  auto const directory = workspace::cache_directory();
+  if (!directory)
+    return std::nullopt;
+  std::string key;
+  for (auto const &root : roots)
+    key += root.string() + '\n';
+  return *directory /
+         fmt::format("{:016x}.symbols", workspace::hash_bytes(key));
+}
+
+static ResponseError error(ErrorCode code, std::u16string_view message) {
+  return ResponseError{code, json::string(message), std::nullopt};
+}
+
+// Dumps every item of a result array.
+template <typename T> static json::array dump_all(std::vector<T> items) {
+  json::array array;
+  array.reserve(items.size());
+  for (auto &item : items) {
+    json::object object;
+    T::dump(std::move(item), object);
+    array.emplace_back(std::move(object));
+  }
+  return array;
+}
+
+Server::~Server() { logging::forward({}); }
+
+int Server::run() noexcept {
+  while (!m_exit) {
+    // what handling the message allocates goes at once, once answered.
+    memory::Arena arena;
+    auto read = rpc::base::read_message(m_in);
+    if (!read)
+      return 1;
+    // its id went with it, so it's answered like invalid JSON.
+    if (read->oversized) {
+      send(ResponseMessage::err(
+          json::null{}, error(ErrorCode::ParseError, u"message too large")));
+      continue;
+    }
+    auto message = json::parse_single(read->text);
+    if (!message) {
+      send(ResponseMessage::err(json::null{},
+                                error(ErrorCode::ParseError, u"invalid JSON")));
+      continue;
+    }
+    apply_file_changes();
+    apply_loaded();
+    apply_indexed();
+    apply_speculated();
+    handle_message(std::move(*message));
+    m_budget.enforce();
+  }
+  // exiting without a shutdown request first is an error.
+  return m_state == State::ShutDown ? 0 : 1;
+}
+
+void Server::handle_message(json::value message) noexcept {
+  if (ResponseMessage::identify(message)) {
+    if (auto response = ResponseMessage::validate(message); response)
+      handle_response(std::move(*response));
+    return;
+  }
+
+  if (RequestMessage::identify(message)) {
+    auto request = RequestMessage::validate(message);
+    if (!request) {
+      send(ResponseMessage::err(
+          json::null{}, error(ErrorCode::InvalidRequest, u"invalid request")));
+      return;
+    }
+    std::variant<json::string, i64, json::null> id;
+    std::visit([&](auto const &value) { id = value; }, request->id);
+    note_request(*request);
+    auto const timed = logging::enabled(logging::Level::Debug);
+    auto const method = timed ? json::to_utf8(request->method) : "";
+    auto const start = std::chrono::steady_clock::now();
+    // the indexer gives way while the client waits.
+    if (m_indexer)
+      m_indexer->pause();
+    auto response = handle_request(std::move(*request));
+    if (m_indexer)
+      m_indexer->resume();
+    if (timed)
+      logging::debug("{} answered in {:.1f} ms", method,
+                     std::chrono::duration<f64, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count());
+    response.id = std::move(id);
+    send(std::move(response));
+    if (m_state == State::Running && !m_background_started)
+      start_background();
+    return;
+  }
+
+  auto notification = NotificationMessage::validate(message);
+  if (notification)
+    handle_notification(std::move(*notification));
+}
+
+void Server::handle_response(ResponseMessage response) noexcept {
+  auto const id = std::get_if<i64>(&response.id);
+  if (id && *id == m_progress_request) {
+    m_progress_request.reset();
+    m_progress_created = !response.error;
+  }
+}
+
+ResponseMessage Server::handle_request(RequestMessage request) noexcept {
+  // the id is filled in by the caller.
+  auto const ok = [](auto result) {
+    return ResponseMessage::ok(json::null{}, json::value(std::move(result)));
+  };
+  auto const err = [](ErrorCode code, std::u16string_view message) {
+    return ResponseMessage::err(json::null{}, error(code, message));
+  };
+
+  if (request.method == u"initialize") {
+    if (m_state != State::Uninitialized)
+      return err(ErrorCode::InvalidRequest, u"server already initialized");
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::InitializeParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid InitializeParams");
+
+    if (params->workspace_folders) {
+      for (auto const &folder : *params->workspace_folders)
+        if (auto path = workspace::path_of(folder.uri); path)
+          m_roots.emplace_back(std::move(*path));
+    } else if (params->root_uri) {
+      if (auto path = workspace::path_of(*params->root_uri); path)
+        m_roots.emplace_back(std::move(*path));
+    }
+    m_work_done_progress = params->work_done_progress;
+    m_pull_diagnostics = params->pull_diagnostics;
+    m_diagnostic_refresh = params->diagnostic_refresh;
+
+    // initializationOptions.memoryBudget : integer (MiB)
+    if (auto &options = params->initialization_options;
+        options && options->is_object() &&
+        options->as_object().has_key(u"memoryBudget")) {
+      auto const budget = options->as_object()
+                              .expect(u"memoryBudget")
+                              .try_integer(INT_CONVERSION_TOLERANCE);
+      if (budget && *budget > 0)
+        m_budget.set_limit(static_cast<u64>(*budget) << 20);
+    }
+    if (auto &options = params->initialization_options;
+        options && options->is_object()) {
+      auto const &object = options->as_object();
+      // initializationOptions.logLevel : "error" | "warning" | "info" |
+      // "debug"
+      if (object.has_key(u"logLevel") && object.expect(u"logLevel").is_string())
+        if (auto const level = logging::level_named(
+                json::to_utf8(object.expect(u"logLevel").as_string())))
+          logging::set_level(*level);
+      // initializationOptions.logToClient : boolean
+      if (object.has_key(u"logToClient") &&
+          object.expect(u"logToClient").is_bool() &&
+          object.expect(u"logToClient").as_bool())
+        logging::forward([this](logging::Level level,
+                                std::string_view message) {
+          if (m_out_failed)
+            return;
+          json::object params;
+          rpc::lsp::LogMessageParams::dump(
+              {static_cast<rpc::lsp::MessageType>(level),
+               json::from_utf8(message)},
+              params);
+          notify(u"window/logMessage", std::move(params));
+        });
+    }
+    for (auto const &root : m_roots)
+      logging::info("workspace root: {}", root.string());
+
+    m_state = State::Running;
+    json::object result;
+    rpc::lsp::ServerCapabilities capabilities{
+        rpc::lsp::TextDocumentSyncKind::Incremental};
+    capabilities.document_symbol_provider = true;
+    capabilities.folding_range_provider = true;
+    capabilities.selection_range_provider = true;
+    capabilities.workspace_symbol_provider = true;
+    capabilities.references_provider = true;
+    capabilities.rename_provider = true;
+    capabilities.completion_provider = true;
+    capabilities.semantic_tokens_provider = true;
+    capabilities.diagnostic_provider = true;
+    capabilities.inter_file_diagnostics = true;
+    rpc::lsp::InitializeResult::dump({capabilities}, result);
+    return ok(std::move(result));
+  }
+
+  if (m_state == State::Uninitialized)
+    return err(ErrorCode::ServerNotInitialized, u"server not initialized");
+  if (m_state == State::ShutDown)
+    return err(ErrorCode::InvalidRequest, u"server is shutting down");
+
+  if (request.method == u"shutdown") {
+    m_state = State::ShutDown;
+    m_speculation.reset();
+    m_scheduler.reset();
+    // what's indexed so far is kept, the rest is left for the next session.
+    m_indexer.reset();
+    apply_indexed();
+    if (m_symbols_path) {
+      update_symbols();
+      m_symbols.save(*m_symbols_path, m_references);
+    }
+    report_allocations();
+    return ok(json::null{});
+  }
+
+  if (request.method == u"textDocument/documentSymbol") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::DocumentSymbolParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid DocumentSymbolParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    if (auto const &speculated = m_speculated_symbols;
+        speculated && speculated->version == snapshot->version &&
+        speculated->file == *workspace::file_ids().find(
+                                params->text_document.uri))
+      return ok(dump_all(speculated->symbols));
+    return ok(dump_all(features::document_symbols(*snapshot)));
+  }
+
+  if (request.method == u"textDocument/foldingRange") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::FoldingRangeParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid FoldingRangeParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    return ok(dump_all(features::folding_ranges(*snapshot)));
+  }
+
+  if (request.method == u"textDocument/selectionRange") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::SelectionRangeParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid SelectionRangeParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    return ok(
+        dump_all(features::selection_ranges(*snapshot, params->positions)));
+  }
+
+  if (request.method == u"workspace/symbol") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::WorkspaceSymbolParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid WorkspaceSymbolParams");
+    update_symbols();
+    std::vector<rpc::lsp::SymbolInformation> symbols;
+    for (auto const &match : m_symbols.query(json::to_utf8(params->query),
+                                             WORKSPACE_SYMBOL_LIMIT)) {
+      auto const &symbol = match.symbol;
+      std::optional<json::string> container;
+      if (!symbol.container.empty())
+        container = json::from_utf8(symbol.container);
+      symbols.push_back(
+          {json::from_utf8(symbol.name), symbol.kind,
+           {workspace::file_ids().uri(match.file), symbol.range},
+           std::move(container)});
+    }
+    return ok(dump_all(std::move(symbols)));
+  }
+
+  if (request.method == u"textDocument/references") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::ReferenceParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid ReferenceParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    auto const name = features::name_at(*snapshot, params->position);
+    if (!name)
+      return ok(json::null{});
+    auto const file = workspace::file_ids().find(params->text_document.uri);
+    if (!file)
+      return ok(json::null{});
+    update_symbols();
+    return ok(dump_all(features::references(
+        features::uses(m_references, *file, *snapshot, params->position,
+                       *name),
+        params->include_declaration)));
+  }
+
+  if (request.method == u"textDocument/completion") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::CompletionParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid CompletionParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    auto const file = *workspace::file_ids().find(params->text_document.uri);
+    // only the first keystroke of a word gathers candidates.
+    auto list = m_completions.complete(file, *snapshot, params->position);
+    if (!list) {
+      update_symbols();
+      list = m_completions.gather(file, *snapshot, params->position,
+                                  m_references);
+    }
+    json::object result;
+    rpc::lsp::CompletionList::dump(std::move(*list), result);
+    return ok(std::move(result));
+  }
+
+  if (request.method == u"textDocument/semanticTokens/full") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::SemanticTokensParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid SemanticTokensParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    auto const file = *workspace::file_ids().find(params->text_document.uri);
+    json::object result;
+    rpc::lsp::SemanticTokens::dump(m_semantic_tokens.full(file, *snapshot),
+                                   result);
+    return ok(std::move(result));
+  }
+
+  if (request.method == u"textDocument/semanticTokens/full/delta") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params =
+        rpc::lsp::SemanticTokensDeltaParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams,
+                 u"invalid SemanticTokensDeltaParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    auto const file = *workspace::file_ids().find(params->text_document.uri);
+    json::object result;
+    std::visit(
+        [&](auto tokens) { decltype(tokens)::dump(std::move(tokens), result); },
+        m_semantic_tokens.delta(file, *snapshot, params->previous_result_id));
+    return ok(std::move(result));
+  }
+
+  if (request.method == u"textDocument/semanticTokens/range") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params =
+        rpc::lsp::SemanticTokensRangeParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams,
+                 u"invalid SemanticTokensRangeParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    json::object result;
+    rpc::lsp::SemanticTokens::dump(
+        features::SemanticTokens::range(*snapshot, params->range), result);
+    return ok(std::move(result));
+  }
+
+  if (request.method == u"textDocument/diagnostic") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::DocumentDiagnosticParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid DocumentDiagnosticParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    auto const file = *workspace::file_ids().find(params->text_document.uri);
+    auto const &report = m_diagnostics.document(file, *snapshot);
+    rpc::lsp::DocumentDiagnosticReport result{report.result_id, std::nullopt};
+    if (params->previous_result_id != report.result_id)
+      result.items = report.items;
+    json::object dumped;
+    rpc::lsp::DocumentDiagnosticReport::dump(std::move(result), dumped);
+    return ok(std::move(dumped));
+  }
+
+  if (request.method == u"workspace/diagnostic") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params =
+        rpc::lsp::WorkspaceDiagnosticParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams,
+                 u"invalid WorkspaceDiagnosticParams");
+    std::pmr::unordered_map<workspace::FileId, json::string> previous(
+        memory::Arena::current());
+    for (auto &[uri, result_id] : params->previous_result_ids)
+      if (auto const file = workspace::file_ids().find(uri))
+        previous.emplace(*file, std::move(result_id));
+
+    rpc::lsp::WorkspaceDiagnosticReport result;
+    auto const add = [&](workspace::FileId file,
+                         features::Diagnostics::Report const &report,
+                         std::optional<i64> version) {
+      auto const found = previous.find(file);
+      auto const known = found != previous.end();
+      // a clean file the client knows nothing about needs no report.
+      if (!known && report.items.empty())
+        return;
+      rpc::lsp::DocumentDiagnosticReport document{report.result_id,
+                                                  std::nullopt};
+      if (!known || found->second != report.result_id)
+        document.items = report.items;
+      result.items.push_back(
+          {workspace::file_ids().uri(file), version, std::move(document)});
+    };
+    auto const open = m_documents.files();
+    for (auto const file : open) {
+      auto const snapshot = m_documents.find(file);
+      add(file, m_diagnostics.document(file, *snapshot), snapshot->version);
+    }
+    update_symbols();
+    for (auto const file : m_symbols.indexed())
+      if (!m_documents.find(file))
+        if (auto const report = m_diagnostics.file(file))
+          add(file, *report, std::nullopt);
+
+    json::object dumped;
+    rpc::lsp::WorkspaceDiagnosticReport::dump(std::move(result), dumped);
+    return ok(std::move(dumped));
+  }
+
+  if (request.method == u"textDocument/rename") {
+    if (!request.params)
+      return err(ErrorCode::InvalidParams, u"missing params");
+    auto params = rpc::lsp::RenameParams::validate(*request.params);
+    if (!params)
+      return err(ErrorCode::InvalidParams, u"invalid RenameParams");
+    auto const snapshot = find_document(params->text_document.uri);
+    if (!snapshot)
+      return err(ErrorCode::RequestFailed, u"document not open");
+    auto const name = features::name_at(*snapshot, params->position);
+    if (!name)
+      return err(ErrorCode::RequestFailed, u"no symbol to rename here");
+    if (!features::is_identifier(json::to_utf8(params->new_name)))
+      return err(ErrorCode::RequestFailed, u"invalid name");
+    auto const file = workspace::file_ids().find(params->text_document.uri);
+    if (!file)
+      return err(ErrorCode::RequestFailed, u"no symbol to rename here");
+    update_symbols();
+    auto const renamed = features::renamed(m_references, *file, *snapshot,
+                                           params->position, *name);
+    if (!renamed)
+      return err(ErrorCode::RequestFailed,
+                 u"can't tell this symbol from others named the same");
+    json::object edit;
+    rpc::lsp::WorkspaceEdit::dump(features::rename(*renamed, params->new_name),
+                                  edit);
+    return ok(std::move(edit));
+  }
+
+  // not part of LSP: how much each subsystem allocated, to tell which one
+  // grows over a long session.
+  if (request.method == u"jakt-lsp/allocations") {
+    json::array subsystems;
+    for (auto const &sample : m_allocations.sample()) {
+      auto const &allocations = sample.allocations;
+      json::object subsystem;
+      subsystem.set(u"name",
+                    json::from_utf8(memory::name_of(sample.subsystem)));
+      subsystem.set(u"liveBytes", static_cast<f64>(allocations.live));
+      subsystem.set(u"peakBytes", static_cast<f64>(allocations.peak));
+      subsystem.set(u"allocations", static_cast<f64>(allocations.count));
+      subsystem.set(u"allocatedBytes", static_cast<f64>(allocations.bytes));
+      subsystem.set(u"allocationsPerSecond", sample.count_per_second);
+      subsystem.set(u"bytesPerSecond", sample.bytes_per_second);
+      subsystems.emplace_back(std::move(subsystem));
+    }
+    json::object result;
+    result.set(u"counting", memory::counting_allocations());
+    result.set(u"subsystems", std::move(subsystems));
+    return ok(std::move(result));
+  }
+
+  return err(ErrorCode::MethodNotFound, u"method not found");
+}
+
+void Server::handle_notification(NotificationMessage notification) noexcept {
+  if (notification.method == u"exit") {
+    m_exit = true;
+    return;
+  }
+  // notifications before initialization are dropped, except for exit.
+  if (m_state != State::Running)
+    return;
+
+  if (notification.method == u"workspace/didChangeWatchedFiles") {
+    if (!notification.params)
+      return;
+    auto params =
+        rpc::lsp::DidChangeWatchedFilesParams::validate(*notification.params);
+    if (!params)
+      return;
+    for (auto const &change : params->changes)
+      if (auto path = workspace::path_of(change.uri); path)
+        file_changed(*path, static_cast<workspace::ChangeKind>(change.type));
+    // open documents may import what changed.
+    for (auto const file : m_documents.files())
+      schedule_check(file, is_visible(file));
+    return;
+  }
+
+  if (notification.method == u"textDocument/didOpen") {
+    if (!notification.params)
+      return;
+    auto params =
+        rpc::lsp::DidOpenTextDocumentParams::validate(*notification.params);
+    if (!params)
+      return;
+    auto const &item = params->text_document;
+    auto const file = workspace::file_ids().intern(item.uri);
+    m_budget.set_open(file, true);
+    m_documents.open(file, item.version, json::to_utf8(item.text));
+    m_stale_symbols.insert(file);
+    m_requested_at[file] = std::chrono::steady_clock::now();
+    m_diagnostics.open(file, *m_documents.find(file));
+    publish_diagnostics(file);
+    schedule_check(file, true);
+    if (m_speculation)
+      m_speculation->edited(file, m_documents.find(file));
+    return;
+  }
+
+  if (notification.method == u"textDocument/didChange") {
+    if (!notification.params)
+      return;
+    auto params =
+        rpc::lsp::DidChangeTextDocumentParams::validate(*notification.params);
+    if (!params)
+      return;
+    auto const file = workspace::file_ids().intern(params->text_document.uri);
+    m_completions.change(file, params->text_document.version,
+                         params->content_changes);
+    m_documents.change(file, params->text_document.version,
+                       params->content_changes);
+    m_stale_symbols.insert(file);
+    // edited where the client shows it.
+    m_requested_at[file] = std::chrono::steady_clock::now();
+    publish_diagnostics(file);
+    schedule_check(file, true);
+    if (m_speculation)
+      m_speculation->edited(file, m_documents.find(file));
+    return;
+  }
+
+  if (notification.method == u"textDocument/didClose") {
+    if (!notification.params)
+      return;
+    auto params =
+        rpc::lsp::DidCloseTextDocumentParams::validate(*notification.params);
+    if (!params)
+      return;
+    auto const file = workspace::file_ids().intern(params->text_document.uri);
+    m_budget.set_open(file, false);
+    m_documents.close(file);
+    m_symbols.close(file);
+    m_references.close(file);
+    m_completions.close(file);
+    m_semantic_tokens.close(file);
+    m_stale_symbols.erase(file);
+    m_requested_at.erase(file);
+    if (m_scheduler)
+      m_scheduler->cancel(file);
+    if (m_speculation)
+      m_speculation->close(file);
+    if (m_speculated_symbols && m_speculated_symbols->file == file)
+      m_speculated_symbols.reset();
+    // what the client shows would otherwise stay there.
+    std::lock_guard lock(m_publish_mutex);
+    if (m_diagnostics.close(file) && !m_pull_diagnostics) {
+      json::object cleared;
+      rpc::lsp::PublishDiagnosticsParams::dump(
+          {params->text_document.uri, std::nullopt, {}}, cleared);
+      notify(u"textDocument/publishDiagnostics", std::move(cleared));
+    }
+    return;
+  }
+
+  // anything else (including `$/` notifications) is ignored.
+}
+
+void Server::publish_diagnostics(workspace::FileId file) noexcept {
+  if (m_pull_diagnostics)
+    return;
+  auto const snapshot = m_documents.find(file);
+  if (!snapshot)
+    return;
+  auto const report = m_diagnostics.document(file, *snapshot);
+  std::lock_guard lock(m_publish_mutex);
+  if (!m_diagnostics.publish(file, report))
+    return;
+  json::object params;
+  rpc::lsp::PublishDiagnosticsParams::dump(
+      {workspace::file_ids().uri(file), snapshot->version, report.items},
+      params);
+  notify(u"textDocument/publishDiagnostics", std::move(params));
+}
+
+void Server::schedule_check(workspace::FileId file, bool visible) noexcept {
+  if (auto snapshot = m_documents.find(file); snapshot && m_scheduler)
+    m_scheduler->schedule(file, std::move(snapshot), visible);
+}
+
+void Server::note_request(RequestMessage const &request) noexcept {
+  // TextDocumentPositionParams and the like
+  if (!request.params || !request.params->is_object() ||
+      !request.params->as_object().has_key(u"textDocument"))
+    return;
+  auto const &document = request.params->as_object().expect(u"textDocument");
+  if (!document.is_object() || !document.as_object().has_key(u"uri"))
+    return;
+  auto const &uri = document.as_object().expect(u"uri");
+  if (!uri.is_string())
+    return;
+  auto const file = workspace::file_ids().find(uri.as_string());
+  if (file && m_documents.find(*file))
+    m_requested_at[*file] = std::chrono::steady_clock::now();
+}
+
+bool Server::is_visible(workspace::FileId file) const noexcept {
+  // editors ask for the tokens, symbols or folds of what they show as soon
+  // as it changes, and rarely about anything else.
+  constexpr auto VISIBLE_FOR = std::chrono::seconds(30);
+  auto const found = m_requested_at.find(file);
+  return found != m_requested_at.end() &&
+         std::chrono::steady_clock::now() - found->second < VISIBLE_FOR;
+}
+
+void Server::compiled(workspace::FileId file, documents::SnapshotPtr snapshot,
+                      compiler::Checked checked) noexcept {
+  if (logging::enabled(logging::Level::Debug))
+    logging::debug(
+        "checked {} in {} ms, {} diagnostics",
+        json::to_utf8(workspace::file_ids().uri(file)),
+        std::chrono::duration_cast<std::chrono::milliseconds>(checked.elapsed)
+            .count(),
+        checked.diagnostics.size());
+  auto const report = m_diagnostics.compiled(file, *snapshot,
+                                             std::move(checked.diagnostics));
+  if (!report)
+    return;
+  if (m_pull_diagnostics) {
+    if (m_diagnostic_refresh)
+      request(u"workspace/diagnostic/refresh", std::nullopt);
+    return;
+  }
+  std::lock_guard lock(m_publish_mutex);
+  if (!m_diagnostics.publish(file, *report))
+    return;
+  json::object params;
+  rpc::lsp::PublishDiagnosticsParams::dump(
+      {workspace::file_ids().uri(file), snapshot->version, report->items},
+      params);
+  notify(u"textDocument/publishDiagnostics", std::move(params));
+}
+
+documents::SnapshotPtr
+Server::find_document(json::string const &uri) const noexcept {
+  // a URI that was never interned can't be open.
+  auto const file = workspace::file_ids().find(uri);
+  return file ? m_documents.find(*file) : nullptr;
+}
+
+void Server::send(ResponseMessage response) noexcept {
+  json::object message;
+  ResponseMessage::dump(std::move(response), message);
+  write(std::move(message));
+}
+
+i64 Server::request(json::string method,
+                    std::optional<json::value> params) noexcept {
+  auto const id = m_next_request_id++;
+  json::object message;
+  RequestMessage::dump(
+      RequestMessage::create(id, std::move(method), std::move(params)),
+      message);
+  write(std::move(message));
+  return id;
+}
+
+void Server::notify(json::string method, json::value params) noexcept {
+  json::object message;
+  NotificationMessage::dump({std::move(method), std::move(params)}, message);
+  write(std::move(message));
+}
+
+void Server::write(json::object message) noexcept {
+  std::lock_guard lock(m_out_mutex);
+  // forwarded, the error would be written and fail in turn, forever.
+  if (!rpc::base::write_message(m_out, std::move(message)) &&
+      !m_out_failed.exchange(true))
+    logging::error("couldn't write a message to the client");
+}
+
+void Server::update_symbols() noexcept {
+  // queries wait for the saved symbols, and so does saving them over.
+  if (m_loader.joinable())
+    m_loader.join();
+  apply_loaded();
+  for (auto const file : m_stale_symbols)
+    if (auto const snapshot = m_documents.find(file)) {
+      auto index = features::index(*snapshot);
+      m_symbols.update(file, std::move(index.symbols), std::nullopt);
+      m_references.update(file, std::move(index.references));
+    }
+  m_stale_symbols.clear();
+  // open documents are indexed from what the client sent instead.
+  std::pmr::unordered_set<workspace::FileId> outdated(
+      memory::Arena::current());
+  for (auto const file : m_symbols.take_outdated())
+    outdated.insert(file);
+  for (auto const file : m_references.take_outdated())
+    outdated.insert(file);
+  outdated.insert(m_created_files.begin(), m_created_files.end());
+  m_created_files.clear();
+  for (auto const file : outdated)
+    if (!m_documents.find(file))
+      index_from_disk(file);
+}
+
+void Server::index_from_disk(workspace::FileId file) noexcept {
+  auto const &path = workspace::file_ids().path(file);
+  if (!path)
+    return;
+  auto stamp = symbols::Stamp::stat(*path);
+  std::optional<symbols::FileIndex> index;
+  if (stamp)
+    index = workspace::with_mapped_file(*path, [&](std::string_view bytes) {
+      stamp->hash = workspace::hash_bytes(bytes);
+      return features::index(bytes);
+    });
+  if (index) {
+    m_symbols.update(file, std::move(index->symbols), stamp);
+    m_references.update(file, std::move(index->references));
+  } else {
+    m_symbols.remove(file);
+    m_references.remove(file);
+  }
+}
+
+void Server::start_background() noexcept {
+  m_background_started = true;
+  m_watcher = workspace::Watcher::start(m_roots, m_file_changes);
+  m_symbols_path = symbols_path(m_roots);
+  // files saved up to date aren't indexed again, once the load tells which.
+  std::promise<std::unordered_set<workspace::FileId>> skip;
+  start_indexer(skip.get_future());
+  if (m_symbols_path) {
+    m_symbols.expect_load();
+    m_loader = std::jthread(
+        [this, path = *m_symbols_path, skip = std::move(skip)]() mutable {
+          auto loaded = symbols::Workspace::read(path);
+          std::unordered_set<workspace::FileId> files;
+          for (auto const &[file, references] : loaded.references)
+            files.insert(file);
+          skip.set_value(std::move(files));
+          m_loaded.send(std::move(loaded));
+        });
+  } else {
+    skip.set_value({});
+  }
+  m_scheduler = std::make_unique<compiler::Scheduler>(
+      m_compiler_path, std::string(m_import_path_flag),
+      [this](workspace::FileId file, documents::SnapshotPtr snapshot,
+             compiler::Checked checked) {
+        compiled(file, std::move(snapshot), std::move(checked));
+      });
+  m_speculation = std::make_unique<features::Speculation>(
+      [this](workspace::FileId file) { m_scheduler->expedite(file); },
+      m_speculated);
+}
+
+void Server::start_indexer(
+    std::future<std::unordered_set<workspace::FileId>> skip) noexcept {
+  if (m_indexer || m_roots.empty())
+    return;
+  if (m_work_done_progress) {
+    json::object params;
+    rpc::lsp::WorkDoneProgressCreateParams::dump(
+        {json::string(INDEXING_TOKEN)}, params);
+    m_progress_request =
+        request(u"window/workDoneProgress/create", std::move(params));
+  }
+
+  // called from the indexer's threads, one at a time.
+  auto report = [this, began = false](
+                    symbols::Indexer::Progress progress) mutable {
+    if (!m_progress_created)
+      return;
+    auto const send_progress = [&](json::object value) {
+      json::object params;
+      rpc::base::ProgressParams::dump(
+          {json::string(INDEXING_TOKEN), std::move(value)}, params);
+      notify(u"$/progress", std::move(params));
+    };
+    auto message = json::from_utf8(
+        fmt::format("{}/{} files", progress.done, progress.total));
+    u64 const percentage = progress.discovered && progress.total != 0
+                               ? progress.done * 100 / progress.total
+                               : 0;
+    json::object value;
+    if (!began) {
+      rpc::lsp::WorkDoneProgressBegin::dump(
+          {json::string(u"Indexing"), message, percentage}, value);
+      send_progress(std::move(value));
+      began = true;
+    }
+    if (progress.discovered && progress.done == progress.total)
+      rpc::lsp::WorkDoneProgressEnd::dump({std::move(message)}, value);
+    else
+      rpc::lsp::WorkDoneProgressReport::dump({std::move(message), percentage},
+                                             value);
+    send_progress(std::move(value));
+  };
+  m_indexer = symbols::Indexer::start(
+      m_roots, std::move(skip),
+      [](std::string_view bytes) { return features::index(bytes); },
+      std::move(report), m_indexed);
+}
+
+void Server::apply_loaded() noexcept {
+  for (auto &loaded : m_loaded.drain())
+    m_symbols.adopt(std::move(loaded), m_references);
+}
+
+void Server::apply_indexed() noexcept {
+  for (auto &indexed : m_indexed.drain()) {
+    // open documents are indexed from what the client sent instead.
+    if (m_documents.find(indexed.file))
+      continue;
+    auto const &path = workspace::file_ids().path(indexed.file);
+    auto const current = symbols::Stamp::stat(*path);
+    auto const changed = !current || !current->same_times(indexed.stamp);
+    // saved symbols of the same contents are kept as they are.
+    auto const known = m_symbols.stamp(indexed.file);
+    if (!known || !known->same_times(indexed.stamp) ||
+        known->hash != indexed.stamp.hash)
+      m_symbols.update(indexed.file, std::move(indexed.index.symbols),
+                       indexed.stamp);
+    m_references.update(indexed.file, std::move(indexed.index.references));
+    // changed while it was indexed, maybe before the watcher could tell.
+    if (changed) {
+      m_symbols.invalidate(indexed.file);
+      m_references.invalidate(indexed.file);
+    }
+  }
+}
+
+void Server::apply_speculated() noexcept {
+  for (auto &speculated : m_speculated.drain()) {
+    auto const file = speculated.file;
+    auto const snapshot = m_documents.find(file);
+    if (!snapshot || snapshot->version != speculated.version)
+      continue;
+    m_semantic_tokens.adopt(file, speculated.version,
+                            std::move(speculated.tokens));
+    if (m_stale_symbols.erase(file)) {
+      m_symbols.update(file, std::move(speculated.index.symbols),
+                       std::nullopt);
+      m_references.update(file, std::move(speculated.index.references));
+    }
+    m_speculated_symbols = std::move(speculated);
+  }
+}
+
+void Server::report_allocations() noexcept {
+  if (!memory::counting_allocations())
+    return;
+  // rates are since the last `jakt-lsp/allocations`, if any.
+  for (auto const &sample : m_allocations.sample()) {
+    auto const &allocations = sample.allocations;
+    logging::info("allocated by {}: {} bytes live, {} at peak, {} "
+                  "allocations of {} bytes ({:.1f}/s)",
+                  memory::name_of(sample.subsystem), allocations.live,
+                  allocations.peak, allocations.count, allocations.bytes,
+                  sample.count_per_second);
+  }
+}
+
+void Server::apply_file_changes() noexcept {
+  for (auto const &batch : m_file_changes.drain()) {
+    if (batch.overflowed) {
+      m_caches.invalidate_all();
+      continue;
+    }
+    for (auto const &change : batch.changes)
+      file_changed(change.path, change.kind);
+  }
+}
+
+void Server::file_changed(std::filesystem::path const &path,
+                          workspace::ChangeKind kind) noexcept {
+  // a new Jakt file is indexed on the next query, like changed ones.
+  if (kind == workspace::ChangeKind::Created && path.extension() == ".jakt")
+    m_created_files.insert(workspace::file_ids().intern_path(path));
+  // files nothing was ever derived from have no id yet.
+  if (auto file = workspace::file_ids().find_path(path); file)
+    m_caches.invalidate(*file);
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include "channel.h"
+#include <atomic>
+#include <chrono>
+#include <compiler/scheduler.h>
+#include <cstdio>
+#include <documents/store.h>
+#include <features/completion.h>
+#include <features/diagnostics.h>
+#include <features/semantic_tokens.h>
+#include <features/speculation.h>
+#include <filesystem>
+#include <future>
+#include <memory/accounting.h>
+#include <memory/budget.h>
+#include <mutex>
+#include <rpc/base.h>
+#include <rpc/lsp.h>
+#include <string_view>
+#include <symbols/indexer.h>
+#include <symbols/references.h>
+#include <symbols/workspace.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <workspace/caches.h>
+#include <workspace/watcher.h>
+
+// Reads messages from the client, dispatches them and writes back the
+// responses.
+class Server {
+public:
+  struct Options {
+    std::string_view compiler_path;
+    // as `compiler::check` takes it
+    std::string_view import_path_flag;
+    // can be overridden by the client in `initializationOptions`.
+    u64 memory_budget = memory::Budget::DEFAULT_LIMIT;
+  };
+
+  Server(Options options, std::FILE *in, std::FILE *out)
+      : m_compiler_path(options.compiler_path),
+        m_import_path_flag(options.import_path_flag), m_in(in), m_out(out),
+        m_budget(options.memory_budget) {
+    m_budget.add(m_documents);
+    m_budget.add(m_symbols);
+    m_budget.add(m_references);
+    m_budget.add(m_completions);
+    m_budget.add(m_semantic_tokens);
+    m_budget.add(m_diagnostics);
+    m_caches.add(m_symbols);
+    m_caches.add(m_references);
+  }
+  // Stops forwarding the log to the client, if it was.
+  ~Server();
+
+  // Runs until the client sends `exit` or closes the input stream.
+  // Returns the process exit code.
+  int run() noexcept;
+
+private:
+  // https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#lifeCycleMessages
+  enum class State { Uninitialized, Running, ShutDown };
+
+  void handle_message(json::value message) noexcept;
+  rpc::base::ResponseMessage
+  handle_request(rpc::base::RequestMessage request) noexcept;
+  void
+  handle_notification(rpc::base::NotificationMessage notification) noexcept;
+  void handle_response(rpc::base::ResponseMessage response) noexcept;
+  void send(rpc::base::ResponseMessage response) noexcept;
+  // Sends a request to the client, whose response goes to `handle_response`.
+  // Returns its id.
+  i64 request(json::string method, std::optional<json::value> params) noexcept;
+  // Notifications may be sent from other threads.
+  void notify(json::string method, json::value params) noexcept;
+  void write(json::object message) noexcept;
+  // Publishes the diagnostics of an open document, unless the client already
+  // has them.
+  void publish_diagnostics(workspace::FileId file) noexcept;
+  // Schedules a compile of an open document.
+  void schedule_check(workspace::FileId file, bool visible) noexcept;
+  // Notes when the client asked about the document of `request`, if open.
+  void note_request(rpc::base::RequestMessage const &request) noexcept;
+  // Whether the client asked about an open document lately, which it does
+  // for the documents it shows.
+  bool is_visible(workspace::FileId file) const noexcept;
+  // Takes what the compiler found in a document, from the scheduler's
+  // threads.
+  void compiled(workspace::FileId file, documents::SnapshotPtr snapshot,
+                compiler::Checked checked) noexcept;
+  // The latest snapshot of an open document.
+  documents::SnapshotPtr find_document(json::string const &uri) const noexcept;
+  // Reindexes the symbols and references of documents changed since the
+  // last query, and of files changed on disk.
+  void update_symbols() noexcept;
+  void index_from_disk(workspace::FileId file) noexcept;
+  // Starts what works in the background: the file watcher, the saved
+  // symbols, the indexer, the compiler scheduler and speculation. None of it
+  // is needed to answer `initialize`, so it starts right after that's sent,
+  // and what takes long (walking the roots to watch them, reading the saved
+  // symbols) goes on threads of its own.
+  void start_background() noexcept;
+  // Starts indexing the files that aren't in `skip`, reporting progress to
+  // the client if it can show it.
+  void start_indexer(
+      std::future<std::unordered_set<workspace::FileId>> skip) noexcept;
+  // Takes the saved symbols, once read.
+  void apply_loaded() noexcept;
+  // Takes the symbols the indexer sent since the last message.
+  void apply_indexed() noexcept;
+  // Takes what was computed ahead of time for the document edited last, if
+  // it wasn't edited since.
+  void apply_speculated() noexcept;
+  // Invalidates what the watcher found changed since the last message.
+  void apply_file_changes() noexcept;
+  // Invalidates what was derived from `path`, and notes new Jakt files to
+  // index.
+  void file_changed(std::filesystem::path const &path,
+                    workspace::ChangeKind kind) noexcept;
+  // Logs how much each subsystem allocated, if allocations are counted.
+  void report_allocations() noexcept;
+
+  std::string_view m_compiler_path;
+  std::string_view m_import_path_flag;
+  std::FILE *m_in;
+  std::FILE *m_out;
+  std::mutex m_out_mutex;
+  // once a write failed, which isn't logged again nor forwarded.
+  std::atomic<bool> m_out_failed = false;
+  State m_state = State::Uninitialized;
+  bool m_exit = false;
+  bool m_background_started = false;
+  // capabilities.window.workDoneProgress
+  bool m_work_done_progress = false;
+  // capabilities.textDocument.diagnostic: if not, diagnostics are published
+  bool m_pull_diagnostics = false;
+  // capabilities.workspace.diagnostics.refreshSupport
+  bool m_diagnostic_refresh = false;
+  // requests are also sent from the compiler scheduler's threads
+  std::atomic<i64> m_next_request_id = 0;
+  memory::Budget m_budget;
+  // for `jakt-lsp/allocations` and the report on shutdown
+  memory::AllocationSampler m_allocations;
+  documents::Store m_documents;
+  symbols::Workspace m_symbols;
+  symbols::References m_references;
+  features::Completions m_completions;
+  features::SemanticTokens m_semantic_tokens;
+  features::Diagnostics m_diagnostics;
+  // so that diagnostics published from the main thread and the scheduler's
+  // come in the order they were decided
+  std::mutex m_publish_mutex;
+  // by open document, when the client last asked about it
+  std::unordered_map<workspace::FileId, std::chrono::steady_clock::time_point>
+      m_requested_at;
+  // where the symbols are saved between sessions, if anywhere
+  std::optional<std::filesystem::path> m_symbols_path;
+  // open documents whose symbols and references are out of date.
+  std::unordered_set<workspace::FileId> m_stale_symbols;
+  // files created on disk since the last query, not indexed yet.
+  std::unordered_set<workspace::FileId> m_created_files;
+  std::vector<std::filesystem::path> m_roots;
+  workspace::Caches m_caches;
+  Channel<workspace::Watcher::Batch> m_file_changes;
+  // started once the client is initialized; sends to `m_file_changes`.
+  std::unique_ptr<workspace::Watcher> m_watcher;
+  Channel<symbols::Workspace::Loaded> m_loaded;
+  // started once the client is initialized, if symbols are saved; reads
+  // them, tells the indexer which files to skip and sends to `m_loaded`.
+  std::jthread m_loader;
+  Channel<symbols::Indexer::Indexed> m_indexed;
+  // the request creating the progress token of the indexer, until answered
+  std::optional<i64> m_progress_request;
+  // set once the client created the token, for the indexer's reports
+  std::atomic<bool> m_progress_created = false;
+  // started once the client is initialized; calls `compiled`.
+  std::unique_ptr<compiler::Scheduler> m_scheduler;
+  Channel<features::Speculation::Speculated> m_speculated;
+  // the document symbols of the last document speculated about
+  std::optional<features::Speculation::Speculated> m_speculated_symbols;
+  // started once the client is initialized; sends to `m_speculated`, and
+  // expedites checks in `m_scheduler`.
+  std::unique_ptr<features::Speculation> m_speculation;
+  // started once the client is initialized; sends to `m_indexed`.
+  std::unique_ptr<symbols::Indexer> m_indexer;
+};
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <matching/fuzzy.h>
+#include <symbols/disk_index.h>
+#include <symbols/trigrams.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace symbols {
+
+namespace {
+// Whether `count` items of `size` bytes fit after `offset` in `total` bytes.
+bool fits(u64 offset, u64 count, u64 size, u64 total) noexcept {
+  return offset <= total && count <= (total - offset) / size;
+}
+
+u64 aligned(u64 offset) noexcept { return (offset + 7) & ~u64(7); }
+} // namespace
+
+std::optional<Stamp> Stamp::stat(std::filesystem::path const &path) noexcept {
+  struct stat info;
+  if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+    return std::nullopt;
+  return Stamp{static_cast<u64>(info.st_size),
+               static_cast<i64>(info.st_mtim.tv_sec) * 1'000'000'000 +
+                   info.st_mtim.tv_nsec,
+               0};
+}
+
+bool DiskIndex::write(std::filesystem::path const &path,
+                      std::vector<File> const &files) {
+  std::vector<FileRecord> file_records;
+  std::vector<SymbolRecord> symbol_records;
+  std::vector<NameRecord> name_records;
+  std::vector<OccurrenceRecord> occurrence_records;
+  std::string strings;
+  std::unordered_map<u32, Postings> lists;
+  auto const add_string = [&](std::string_view string) {
+    auto const offset = strings.size();
+    strings.append(string);
+    return offset;
+  };
+
+  // symbols get ids in the order of their files.
+  file_records.reserve(files.size());
+  for (auto const &file : files) {
+    auto const number = static_cast<u32>(file_records.size());
+    auto const names =
+        file.references ? static_cast<u32>(file.references->size()) : 0;
+    file_records.push_back(
+        {add_string(file.path), static_cast<u32>(file.path.size()),
+         static_cast<u32>(symbol_records.size()),
+         static_cast<u32>(file.symbols.size()),
+         static_cast<u32>(name_records.size()), names,
+         file.references != nullptr, file.stamp.size, file.stamp.modified,
+         file.stamp.hash});
+    if (file.references)
+      for (auto const &[name, occurrences] : *file.references) {
+        name_records.push_back({add_string(name),
+                                static_cast<u32>(name.size()),
+                                static_cast<u32>(occurrence_records.size()),
+                                static_cast<u32>(occurrences.size()), 0});
+        for (auto const &[range, role] : occurrences)
+          occurrence_records.push_back(
+              {static_cast<u32>(range.start.line),
+               static_cast<u32>(range.start.character),
+               static_cast<u32>(range.end.line),
+               static_cast<u32>(range.end.character),
+               static_cast<u32>(role)});
+      }
+    for (auto const &symbol : file.symbols) {
+      auto const id = static_cast<u32>(symbol_records.size());
+      for (auto const key : keys_of_name(symbol.name))
+        lists[key].append(id);
+      auto const &range = symbol.range;
+      symbol_records.push_back(
+          {add_string(symbol.name), add_string(symbol.container),
+           static_cast<u32>(symbol.name.size()),
+           static_cast<u32>(symbol.container.size()), number,
+           static_cast<u32>(symbol.kind),
+           static_cast<u32>(range.start.line),
+           static_cast<u32>(range.start.character),
+           static_cast<u32>(range.end.line),
+           static_cast<u32>(range.end.character)});
+    }
+  }
+
+  std::vector<u32> keys;
+  keys.reserve(lists.size());
+  for (auto const &[key, list] : lists)
+    keys.push_back(key);
+  std::sort(keys.begin(), keys.end());
+  std::vector<KeyRecord> key_records;
+  std::vector<Postings::Skip> skips;
+  std::vector<u8> bytes;
+  key_records.reserve(keys.size());
+  for (auto const key : keys) {
+    auto const list = lists[key].view();
+    key_records.push_back({key, 0, list.size, skips.size(), list.skips.size(),
+                           bytes.size(), list.bytes.size()});
+    skips.insert(skips.end(), list.skips.begin(), list.skips.end());
+    bytes.insert(bytes.end(), list.bytes.begin(), list.bytes.end());
+  }
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+  header.version = VERSION;
+  header.order = ORDER;
+  u64 offset = sizeof(Header);
+  auto const place = [&](Section &section, u64 count, u64 size) {
+    section = {aligned(offset), count};
+    offset = section.offset + count * size;
+  };
+  place(header.files, file_records.size(), sizeof(FileRecord));
+  place(header.symbols, symbol_records.size(), sizeof(SymbolRecord));
+  place(header.keys, key_records.size(), sizeof(KeyRecord));
+  place(header.skips, skips.size(), sizeof(Postings::Skip));
+  place(header.names, name_records.size(), sizeof(NameRecord));
+  place(header.occurrences, occurrence_records.size(),
+        sizeof(OccurrenceRecord));
+  place(header.bytes, bytes.size(), 1);
+  place(header.strings, strings.size(), 1);
+  header.size = offset;
+
+  // written next to the index, then moved over it.
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  auto temporary = path;
+  temporary += ".tmp" + std::to_string(::getpid());
+  auto const out = std::fopen(temporary.c_str(), "wb");
+  if (!out)
+    return false;
+  u64 written = 0;
+  auto const put = [&](Section const &section, void const *data, u64 size) {
+    static constexpr char ZEROES[8] = {};
+    std::fwrite(ZEROES, 1, section.offset - written, out);
+    std::fwrite(data, 1, size, out);
+    written = section.offset + size;
+  };
+  put({0, 1}, &header, sizeof header);
+  put(header.files, file_records.data(),
+      file_records.size() * sizeof(FileRecord));
+  put(header.symbols, symbol_records.data(),
+      symbol_records.size() * sizeof(SymbolRecord));
+  put(header.keys, key_records.data(), key_records.size() * sizeof(KeyRecord));
+  put(header.skips, skips.data(), skips.size() * sizeof(Postings::Skip));
+  put(header.names, name_records.data(),
+      name_records.size() * sizeof(NameRecord));
+  put(header.occurrences, occurrence_records.data(),
+      occurrence_records.size() * sizeof(OccurrenceRecord));
+  put(header.bytes, bytes.data(), bytes.size());
+  put(header.strings, strings.data(), strings.size());
+  auto const ok = !std::ferror(out);
+  if (std::fclose(out) != 0 || !ok) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+std::optional<DiskIndex> DiskIndex::open(std::filesystem::path const &path) {
+  auto file =
+      workspace::MappedFile::open(path, workspace::MappedFile::Access::Random);
+  if (!file)
+    return std::nullopt;
+  DiskIndex index(std::move(*file));
+  if (!index.check())
+    return std::nullopt;
+  return index;
+}
+
+bool DiskIndex::check() noexcept {
+  auto const data = m_file.bytes();
+  if (data.size() < sizeof(Header))
+    return false;
+  auto const &header = *reinterpret_cast<Header const *>(data.data());
+  if (std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0 ||
+      header.version != VERSION || header.order != ORDER ||
+      header.size != data.size())
+    return false;
+
+  auto const take = [&]<typename T>(Section const &section,
+                                    std::span<T const> &span) {
+    if (section.offset % alignof(T) != 0 ||
+        !fits(section.offset, section.count, sizeof(T), data.size()))
+      return false;
+    span = {reinterpret_cast<T const *>(data.data() + section.offset),
+            section.count};
+    return true;
+  };
+  std::span<char const> strings;
+  if (!take(header.files, m_files) || !take(header.symbols, m_symbols) ||
+      !take(header.keys, m_keys) || !take(header.skips, m_skips) ||
+      !take(header.names, m_names) ||
+      !take(header.occurrences, m_occurrences) ||
+      !take(header.bytes, m_bytes) || !take(header.strings, strings))
+    return false;
+  m_strings = {strings.data(), strings.size()};
+
+  // cursors trust skip entries to go forward, and lookups keys to be sorted.
+  for (u64 i = 0; i != m_keys.size(); ++i) {
+    auto const &key = m_keys[i];
+    if ((i != 0 && m_keys[i - 1].key >= key.key) ||
+        !fits(key.first_skip, key.skip_count, 1, m_skips.size()) ||
+        !fits(key.first_byte, key.byte_count, 1, m_bytes.size()))
+      return false;
+    auto const skips = m_skips.subspan(key.first_skip, key.skip_count);
+    for (u64 skip = 0; skip != skips.size(); ++skip)
+      if (skips[skip].offset >= key.byte_count ||
+          (skip != 0 && (skips[skip - 1].offset >= skips[skip].offset ||
+                         skips[skip - 1].first >= skips[skip].first)))
+        return false;
+  }
+  return true;
+}
+
+std::string_view DiskIndex::string(u64 offset, u64 length) const noexcept {
+  if (!fits(offset, length, 1, m_strings.size()))
+    return {};
+  return m_strings.substr(offset, length);
+}
+
+SymbolView DiskIndex::symbol(SymbolRecord const &record) const noexcept {
+  auto const kind = record.kind >= 1 && record.kind <= 26
+                        ? static_cast<rpc::lsp::SymbolKind>(record.kind)
+                        : rpc::lsp::SymbolKind::Variable;
+  return {string(record.name, record.name_length), kind,
+          {{record.start_line, record.start_character},
+           {record.end_line, record.end_character}},
+          string(record.container, record.container_length)};
+}
+
+std::string_view DiskIndex::path(u32 file) const noexcept {
+  auto const &record = m_files[file];
+  return string(record.path, record.path_length);
+}
+
+Stamp DiskIndex::stamp(u32 file) const noexcept {
+  auto const &record = m_files[file];
+  return {record.size, record.modified, record.hash};
+}
+
+std::vector<SymbolView> DiskIndex::symbols(u32 file) const {
+  auto const &record = m_files[file];
+  std::vector<SymbolView> symbols;
+  if (!fits(record.first_symbol, record.symbol_count, 1, m_symbols.size()))
+    return symbols;
+  symbols.reserve(record.symbol_count);
+  for (auto const &symbol :
+       m_symbols.subspan(record.first_symbol, record.symbol_count))
+    symbols.push_back(this->symbol(symbol));
+  return symbols;
+}
+
+std::optional<Shard> DiskIndex::references(u32 file) const {
+  auto const &record = m_files[file];
+  if (!record.references ||
+      !fits(record.first_name, record.name_count, 1, m_names.size()))
+    return std::nullopt;
+  Shard shard;
+  shard.reserve(record.name_count);
+  for (auto const &name :
+       m_names.subspan(record.first_name, record.name_count)) {
+    if (!fits(name.first_occurrence, name.occurrence_count, 1,
+              m_occurrences.size()))
+      return std::nullopt;
+    auto &occurrences =
+        shard[std::string(string(name.name, name.name_length))];
+    occurrences.reserve(name.occurrence_count);
+    for (auto const &occurrence : m_occurrences.subspan(
+             name.first_occurrence, name.occurrence_count))
+      occurrences.push_back(
+          {{{occurrence.start_line, occurrence.start_character},
+            {occurrence.end_line, occurrence.end_character}},
+           occurrence.role <= static_cast<u32>(Role::Label)
+               ? static_cast<Role>(occurrence.role)
+               : Role::Use});
+  }
+  return shard;
+}
+
+std::optional<Postings::View> DiskIndex::postings(u32 key) const noexcept {
+  auto const found = std::lower_bound(
+      m_keys.begin(), m_keys.end(), key,
+      [](KeyRecord const &record, u32 key) { return record.key < key; });
+  if (found == m_keys.end() || found->key != key)
+    return std::nullopt;
+  return Postings::View{m_bytes.subspan(found->first_byte, found->byte_count),
+                        m_skips.subspan(found->first_skip, found->skip_count),
+                        found->size};
+}
+
+auto DiskIndex::query(std::string_view query, u64 limit,
+                      std::vector<bool> const &visible) const
+    -> std::vector<Match> {
+  std::vector<Match> matches;
+  auto const is_visible = [&](SymbolRecord const &record) {
+    return record.file < visible.size() && visible[record.file];
+  };
+  if (query.empty()) {
+    for (auto const &record : m_symbols) {
+      if (matches.size() == limit)
+        break;
+      if (is_visible(record))
+        matches.push_back({record.file, symbol(record), 0});
+    }
+    return matches;
+  }
+
+  std::vector<Postings::View> lists;
+  for (auto const key : keys_of_query(query)) {
+    auto const list = postings(key);
+    if (!list)
+      return matches;
+    lists.push_back(*list);
+  }
+  matching::Pattern const pattern(query);
+  matching::TopK top(limit);
+  for (auto const id : intersect(std::move(lists))) {
+    if (id >= m_symbols.size() || !is_visible(m_symbols[id]))
+      continue;
+    auto const &record = m_symbols[id];
+    auto const name = string(record.name, record.name_length);
+    if (auto const score = pattern.score(name))
+      top.push(id, *score, name.size());
+  }
+  for (auto const &ranked : std::move(top).take()) {
+    auto const &record = m_symbols[ranked.index];
+    matches.push_back({record.file, symbol(record), ranked.score});
+  }
+  return matches;
+}
+
+} // namespace symbols
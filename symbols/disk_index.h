@@ -0,0 +1,158 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <symbols/index.h>
+#include <symbols/references.h>
+#include <vector>
+#include <workspace/mapped_file.h>
+
+namespace symbols {
+
+// What symbols were extracted from: the size and modification time of a
+// file, to tell cheaply that it hasn't changed, and a hash of its contents
+// for when those changed but the contents didn't.
+struct Stamp {
+  u64 size;
+  i64 modified;
+  u64 hash;
+
+  // The size and modification time of `path`, with no hash.
+  static std::optional<Stamp>
+  stat(std::filesystem::path const &path) noexcept;
+  bool same_times(Stamp const &other) const noexcept {
+    return size == other.size && modified == other.modified;
+  }
+};
+
+// Symbols of the workspace saved by a previous session, in a flat file that
+// is mapped and queried in place: opening one costs a few checks whatever
+// its size, and its pages are only read as queries touch them.
+//
+// The file is a header, then arrays of fixed-size records (files, symbols,
+// posting list keys, skip entries, and the names each file uses with their
+// occurrences), then the bytes of the posting lists and the strings.
+// Posting lists are laid out as `Postings` keeps them in memory, and keyed
+// the same way as in `Index`. Offsets and lengths are checked as they're
+// read, so a corrupt file can give wrong results, but never reads out of
+// bounds.
+class DiskIndex {
+public:
+  static constexpr u32 VERSION = 2;
+
+  // A file to save, with the symbols and the occurrences of names extracted
+  // from it as of `stamp`. Occurrences may be missing, for the file to be
+  // indexed again.
+  struct File {
+    std::string path;
+    Stamp stamp;
+    std::vector<SymbolView> symbols;
+    Shard const *references;
+  };
+  // Writes `files` to `path`, replacing what's there at once: readers of
+  // the previous index keep their mapping.
+  static bool write(std::filesystem::path const &path,
+                    std::vector<File> const &files);
+
+  // Nothing if there's no index at `path`, or if it's from another version
+  // of the format.
+  static std::optional<DiskIndex> open(std::filesystem::path const &path);
+
+  u32 files() const noexcept { return static_cast<u32>(m_files.size()); }
+  std::string_view path(u32 file) const noexcept;
+  Stamp stamp(u32 file) const noexcept;
+  std::vector<SymbolView> symbols(u32 file) const;
+  // Nothing if they weren't saved.
+  std::optional<Shard> references(u32 file) const;
+
+  struct Match {
+    u32 file;
+    SymbolView symbol;
+    i32 score;
+  };
+  // The best `limit` matches among the files whose bit is set in `visible`,
+  // best first.
+  std::vector<Match> query(std::string_view query, u64 limit,
+                           std::vector<bool> const &visible) const;
+
+private:
+  struct Section {
+    u64 offset;
+    u64 count;
+  };
+  struct Header {
+    char magic[8];
+    u32 version;
+    // `ORDER` as written, to reject files from machines of another byte
+    // order
+    u32 order;
+    // of the whole file
+    u64 size;
+    Section files, symbols, keys, skips, names, occurrences, bytes, strings;
+  };
+  struct FileRecord {
+    u64 path;
+    u32 path_length;
+    u32 first_symbol;
+    u32 symbol_count;
+    u32 first_name;
+    u32 name_count;
+    // whether the names were saved
+    u32 references;
+    u64 size;
+    i64 modified;
+    u64 hash;
+  };
+  struct SymbolRecord {
+    u64 name;
+    u64 container;
+    u32 name_length;
+    u32 container_length;
+    u32 file;
+    u32 kind;
+    u32 start_line, start_character, end_line, end_character;
+  };
+  struct KeyRecord {
+    u32 key;
+    u32 padding;
+    // ids in the list
+    u64 size;
+    u64 first_skip;
+    u64 skip_count;
+    u64 first_byte;
+    u64 byte_count;
+  };
+  struct NameRecord {
+    u64 name;
+    u32 name_length;
+    u32 first_occurrence;
+    u32 occurrence_count;
+    u32 padding;
+  };
+  struct OccurrenceRecord {
+    u32 start_line, start_character, end_line, end_character;
+    u32 role;
+  };
+  static constexpr char MAGIC[8] = {'J', 'A', 'K', 'T', 'S', 'Y', 'M', 'S'};
+  static constexpr u32 ORDER = 0x01020304;
+
+  explicit DiskIndex(workspace::MappedFile file) noexcept
+      : m_file(std::move(file)) {}
+  // Checks the header and the layout of posting lists.
+  bool check() noexcept;
+  std::string_view string(u64 offset, u64 length) const noexcept;
+  SymbolView symbol(SymbolRecord const &record) const noexcept;
+  std::optional<Postings::View> postings(u32 key) const noexcept;
+
+  workspace::MappedFile m_file;
+  std::span<FileRecord const> m_files;
+  std::span<SymbolRecord const> m_symbols;
+  std::span<KeyRecord const> m_keys;
+  std::span<Postings::Skip const> m_skips;
+  std::span<NameRecord const> m_names;
+  std::span<OccurrenceRecord const> m_occurrences;
+  std::span<u8 const> m_bytes;
+  std::string_view m_strings;
+};
+
+} // namespace symbols
@@ -0,0 +1,101 @@
+#include <matching/fuzzy.h>
+#include <symbols/index.h>
+#include <symbols/trigrams.h>
+
+namespace symbols {
+
+namespace {
+// dead entries allowed before rebuilding, if they're also half of them.
+constexpr u64 COMPACT_THRESHOLD = 4096;
+} // namespace
+
+void Index::add(workspace::FileId file, Symbol symbol) {
+  auto const id = static_cast<u32>(m_entries.size());
+  auto const keys = keys_of_name(symbol.name);
+  for (auto const key : keys)
+    m_postings[key].append(id);
+  m_files[file].push_back(id);
+  // a posting takes a byte or two.
+  m_usage += sizeof(Entry) + symbol.name.size() + symbol.container.size() +
+             keys.size() * 2;
+  m_entries.push_back({file, std::move(symbol), true});
+}
+
+void Index::update(workspace::FileId file, std::vector<Symbol> symbols) {
+  remove(file);
+  for (auto &symbol : symbols)
+    add(file, std::move(symbol));
+  if (m_dead > COMPACT_THRESHOLD && m_dead > m_entries.size() / 2)
+    compact();
+}
+
+void Index::remove(workspace::FileId file) {
+  auto const found = m_files.find(file);
+  if (found == m_files.end())
+    return;
+  for (auto const id : found->second)
+    m_entries[id].live = false;
+  m_dead += found->second.size();
+  m_files.erase(found);
+}
+
+std::vector<SymbolView> Index::symbols(workspace::FileId file) const {
+  std::vector<SymbolView> symbols;
+  if (auto const found = m_files.find(file); found != m_files.end())
+    for (auto const id : found->second)
+      symbols.emplace_back(m_entries[id].symbol);
+  return symbols;
+}
+
+void Index::compact() {
+  auto entries = std::move(m_entries);
+  m_entries.clear();
+  m_files.clear();
+  m_postings.clear();
+  m_dead = 0;
+  m_usage = 0;
+  for (auto &entry : entries)
+    if (entry.live)
+      add(entry.file, std::move(entry.symbol));
+}
+
+auto Index::query(std::string_view query, u64 limit) const
+    -> std::vector<Match> {
+  std::vector<Match> matches;
+  if (query.empty()) {
+    for (auto const &entry : m_entries) {
+      if (matches.size() == limit)
+        break;
+      if (entry.live)
+        matches.push_back({entry.file, &entry.symbol, 0});
+    }
+    return matches;
+  }
+
+  matching::Pattern const pattern(query);
+  matching::TopK top(limit);
+  std::vector<Postings::View> lists;
+  for (auto const key : keys_of_query(query)) {
+    auto const found = m_postings.find(key);
+    if (found == m_postings.end())
+      return matches;
+    lists.push_back(found->second.view());
+  }
+  for (auto const id : intersect(std::move(lists))) {
+    auto const &entry = m_entries[id];
+    if (!entry.live)
+      continue;
+    // trigrams found in any order still have to match in order.
+    if (auto const score = pattern.score(entry.symbol.name))
+      top.push(id, *score, entry.symbol.name.size());
+  }
+  for (auto const &ranked : std::move(top).take()) {
+    auto const &entry = m_entries[ranked.index];
+    matches.push_back({entry.file, &entry.symbol, ranked.score});
+  }
+  return matches;
+}
+
+u64 Index::usage() const noexcept { return m_usage; }
+
+} // namespace symbols
@@ -0,0 +1,94 @@
+#pragma once
+#include <memory/budget.h>
+#include <rpc/lsp.h>
+#include <string>
+#include <symbols/postings.h>
+#include <unordered_map>
+#include <vector>
+#include <workspace/file_ids.h>
+
+// Declarations across the workspace, for the requests that aren't about a
+// single document.
+namespace symbols {
+
+struct Symbol {
+  std::string name;
+  rpc::lsp::SymbolKind kind;
+  // of the name
+  rpc::lsp::Range range;
+  // name of the declaration this one is in, if any
+  std::string container;
+};
+
+// A symbol read in place, from memory or from a mapped index.
+struct SymbolView {
+  std::string_view name;
+  rpc::lsp::SymbolKind kind;
+  rpc::lsp::Range range;
+  std::string_view container;
+
+  SymbolView(Symbol const &symbol) noexcept
+      : name(symbol.name), kind(symbol.kind), range(symbol.range),
+        container(symbol.container) {}
+  SymbolView(std::string_view name, rpc::lsp::SymbolKind kind,
+             rpc::lsp::Range range, std::string_view container) noexcept
+      : name(name), kind(kind), range(range), container(container) {}
+};
+
+// Symbols of the workspace by file, searchable by fuzzy name.
+//
+// Names are indexed by trigram: every three characters that a fuzzy query
+// could have typed in a row, either because they follow each other in the
+// name or because they start its words ("fba" for "FooBar"). A query is then
+// an intersection of the posting lists of its own trigrams, and only those
+// candidates get scored. Queries too short for trigrams look at the first
+// one or two characters of names instead.
+//
+// Symbols get ids in the order they're added, so that posting lists only
+// ever grow at the end. Replacing a file's symbols leaves the old ones
+// behind as dead, until enough have piled up to rebuild the lists.
+class Index : public memory::Consumer {
+public:
+  struct Match {
+    workspace::FileId file;
+    Symbol const *symbol;
+    i32 score;
+  };
+
+  // Replaces the symbols of `file`.
+  void update(workspace::FileId file, std::vector<Symbol> symbols);
+  void remove(workspace::FileId file);
+
+  bool contains(workspace::FileId file) const noexcept {
+    return m_files.contains(file);
+  }
+  // The symbols of `file`, in the order they were given.
+  std::vector<SymbolView> symbols(workspace::FileId file) const;
+
+  // The best `limit` matches, best first. Pointers are valid until the next
+  // change.
+  std::vector<Match> query(std::string_view query, u64 limit) const;
+
+  // memory::Consumer
+  std::string_view name() const noexcept override { return "symbols"; }
+  u64 usage() const noexcept override;
+
+private:
+  struct Entry {
+    workspace::FileId file;
+    Symbol symbol;
+    bool live;
+  };
+
+  void add(workspace::FileId file, Symbol symbol);
+  // Rebuilds everything without the dead entries.
+  void compact();
+
+  std::vector<Entry> m_entries;
+  u64 m_dead = 0;
+  u64 m_usage = 0;
+  std::unordered_map<workspace::FileId, std::vector<u32>> m_files;
+  std::unordered_map<u32, Postings> m_postings;
+};
+
+} // namespace symbols
@@ -0,0 +1,184 @@
+#include <pthread.h>
+#include <sched.h>
+#include <symbols/indexer.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <workspace/file_ids.h>
+#include <workspace/hash.h>
+#include <workspace/mapped_file.h>
+
+namespace symbols {
+
+namespace fs = std::filesystem;
+
+namespace {
+// files discovered between two pushes to the queue.
+constexpr u64 DISCOVERY_BATCH = 64;
+
+bool is_hidden(fs::path const &path) {
+  auto const name = path.filename().native();
+  return !name.empty() && name[0] == '.';
+}
+
+// Leaves the calling thread the cores, and the disk, only when nothing else
+// wants them.
+void lower_priority() noexcept {
+  sched_param param{};
+  if (::pthread_setschedparam(::pthread_self(), SCHED_IDLE, &param) != 0)
+    ::setpriority(PRIO_PROCESS, static_cast<id_t>(::gettid()), 19);
+#ifdef SYS_ioprio_set
+  // IOPRIO_WHO_PROCESS, of this thread, in IOPRIO_CLASS_IDLE.
+  ::syscall(SYS_ioprio_set, 1, 0, 3 << 13);
+#endif
+}
+} // namespace
+
+std::unique_ptr<Indexer>
+Indexer::start(std::vector<fs::path> roots,
+               std::future<std::unordered_set<workspace::FileId>> skip,
+               Extract extract, Report report, Channel<Indexed> &out) {
+  std::unique_ptr<Indexer> indexer(
+      new Indexer(std::move(extract), std::move(report), out));
+  auto const workers = std::max(1u, std::thread::hardware_concurrency());
+  for (u32 i = 0; i != workers; ++i)
+    indexer->m_workers.emplace_back(
+        [indexer = indexer.get()](std::stop_token stop) {
+          indexer->work(std::move(stop));
+        });
+  indexer->m_discovery =
+      std::jthread([indexer = indexer.get(), roots = std::move(roots),
+                    skip = std::move(skip)](std::stop_token stop) mutable {
+        indexer->discover(std::move(stop), roots, std::move(skip));
+      });
+  return indexer;
+}
+
+Indexer::~Indexer() {
+  // all at once, then joined as members go.
+  m_discovery.request_stop();
+  for (auto &worker : m_workers)
+    worker.request_stop();
+}
+
+void Indexer::pause() noexcept {
+  std::lock_guard lock(m_mutex);
+  ++m_paused;
+}
+
+void Indexer::resume() noexcept {
+  {
+    std::lock_guard lock(m_mutex);
+    if (--m_paused != 0)
+      return;
+  }
+  m_available.notify_all();
+}
+
+void Indexer::discover(
+    std::stop_token stop, std::vector<fs::path> const &roots,
+    std::future<std::unordered_set<workspace::FileId>> skip_future) {
+  lower_priority();
+  auto const skip = skip_future.get();
+  using clock = std::chrono::steady_clock;
+  auto last_report = clock::now();
+  // roots may be nested.
+  std::unordered_set<workspace::FileId> found;
+  std::vector<workspace::FileId> batch;
+  auto const flush = [&] {
+    Progress progress;
+    {
+      std::lock_guard lock(m_mutex);
+      m_queue.insert(m_queue.end(), batch.begin(), batch.end());
+      m_total += batch.size();
+      progress = {m_done, m_total, false};
+    }
+    batch.clear();
+    m_available.notify_all();
+    if (auto const now = clock::now(); now - last_report >= PROGRESS_PERIOD) {
+      last_report = now;
+      m_report(progress);
+    }
+  };
+
+  for (auto const &root : roots) {
+    std::error_code error;
+    fs::recursive_directory_iterator entry(
+        root, fs::directory_options::skip_permission_denied, error);
+    for (; !error && entry != fs::recursive_directory_iterator();
+         entry.increment(error)) {
+      if (stop.stop_requested())
+        return;
+      auto const &path = entry->path();
+      if (is_hidden(path)) {
+        entry.disable_recursion_pending();
+        continue;
+      }
+      std::error_code type_error;
+      if (path.extension() != ".jakt" || !entry->is_regular_file(type_error))
+        continue;
+      auto const file = workspace::file_ids().intern_path(path);
+      if (skip.contains(file) || !found.insert(file).second)
+        continue;
+      batch.push_back(file);
+      if (batch.size() == DISCOVERY_BATCH)
+        flush();
+    }
+  }
+  flush();
+  {
+    std::lock_guard lock(m_mutex);
+    m_discovered = true;
+  }
+  m_available.notify_all();
+
+  for (;;) {
+    Progress progress;
+    {
+      std::unique_lock lock(m_mutex);
+      m_progress.wait_for(lock, stop, PROGRESS_PERIOD,
+                          [&] { return m_done == m_total; });
+      if (stop.stop_requested())
+        return;
+      progress = {m_done, m_total, true};
+    }
+    m_report(progress);
+    if (progress.done == progress.total)
+      return;
+  }
+}
+
+void Indexer::work(std::stop_token stop) {
+  lower_priority();
+  while (auto const file = take(stop)) {
+    auto const &path = workspace::file_ids().path(*file);
+    auto stamp = Stamp::stat(*path);
+    std::optional<FileIndex> index;
+    if (stamp)
+      index = workspace::with_mapped_file(*path, [&](std::string_view bytes) {
+        stamp->hash = workspace::hash_bytes(bytes);
+        return m_extract(bytes);
+      });
+    if (index)
+      m_out.send({*file, std::move(*index), *stamp});
+    {
+      std::lock_guard lock(m_mutex);
+      ++m_done;
+    }
+    m_progress.notify_one();
+  }
+}
+
+std::optional<workspace::FileId> Indexer::take(std::stop_token const &stop) {
+  std::unique_lock lock(m_mutex);
+  m_available.wait(lock, stop, [&] {
+    return m_paused == 0 && (!m_queue.empty() || m_discovered);
+  });
+  if (stop.stop_requested() || m_queue.empty())
+    return std::nullopt;
+  auto const file = m_queue.front();
+  m_queue.pop_front();
+  return file;
+}
+
+} // namespace symbols
@@ -0,0 +1,93 @@
+#pragma once
+#include "channel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <symbols/disk_index.h>
+#include <symbols/references.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace symbols {
+
+// Indexes the files of the workspace in the background, once, from threads of
+// the lowest priority: one discovering `.jakt` files below the roots (skipping
+// hidden directories, like the watcher), and one per core extracting their
+// symbols and references as they're found.
+//
+// Files are sent as each one is done, so they can be searched before the
+// whole workspace is. Workers stop between files while the server is
+// paused, to leave it the cores and the locks it shares with them.
+class Indexer {
+public:
+  // A file as of `stamp`.
+  struct Indexed {
+    workspace::FileId file;
+    FileIndex index;
+    Stamp stamp;
+  };
+  struct Progress {
+    // files indexed, and found so far
+    u64 done;
+    u64 total;
+    // whether `total` is final
+    bool discovered;
+  };
+  using Extract = std::function<FileIndex(std::string_view bytes)>;
+  // Called from the indexer's threads, at most every `PROGRESS_PERIOD` and
+  // once all is done.
+  using Report = std::function<void(Progress)>;
+  static constexpr std::chrono::milliseconds PROGRESS_PERIOD{200};
+
+  // Files in `skip` are left out: their symbols and references are up to
+  // date already, as saved by a previous session. Discovery waits for it,
+  // while workers start.
+  static std::unique_ptr<Indexer>
+  start(std::vector<std::filesystem::path> roots,
+        std::future<std::unordered_set<workspace::FileId>> skip,
+        Extract extract, Report report, Channel<Indexed> &out);
+  ~Indexer();
+
+  // Stops workers between files until as many `resume`.
+  void pause() noexcept;
+  void resume() noexcept;
+
+private:
+  Indexer(Extract extract, Report report, Channel<Indexed> &out) noexcept
+      : m_extract(std::move(extract)), m_report(std::move(report)),
+        m_out(out) {}
+
+  // Walks the roots, then reports progress until workers are done.
+  void discover(std::stop_token stop,
+                std::vector<std::filesystem::path> const &roots,
+                std::future<std::unordered_set<workspace::FileId>> skip);
+  void work(std::stop_token stop);
+  // The next file to index, or nothing once all are taken or when stopping.
+  std::optional<workspace::FileId> take(std::stop_token const &stop);
+
+  Extract m_extract;
+  Report m_report;
+  Channel<Indexed> &m_out;
+
+  std::mutex m_mutex;
+  // for workers: files were queued, discovery ended, or the indexer resumed
+  std::condition_variable_any m_available;
+  // for discovery: a file is done
+  std::condition_variable_any m_progress;
+  std::deque<workspace::FileId> m_queue;
+  bool m_discovered = false;
+  u64 m_total = 0;
+  u64 m_done = 0;
+  u32 m_paused = 0;
+
+  std::vector<std::jthread> m_workers;
+  std::jthread m_discovery;
+};
+
+} // namespace symbols
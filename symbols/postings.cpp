@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <symbols/postings.h>
+
+namespace symbols {
+
+void Postings::append(u32 id) {
+  if (m_size % BLOCK_SIZE == 0)
+    m_skips.push_back({id, m_last, m_bytes.size()});
+  // 7 bits per byte, the high bit set on all bytes but the last one.
+  auto delta = id - m_last;
+  while (delta >= 0x80) {
+    m_bytes.push_back(static_cast<u8>(delta | 0x80));
+    delta >>= 7;
+  }
+  m_bytes.push_back(static_cast<u8>(delta));
+  m_last = id;
+  ++m_size;
+}
+
+Postings::Cursor::Cursor(View list, u64 first, u64 last) noexcept
+    : m_list(list), m_block(first), m_last(std::min(last, list.skips.size())) {
+  m_end = m_last < list.skips.size()
+              ? std::min<u64>(list.skips[m_last].offset, list.bytes.size())
+              : list.bytes.size();
+  if (first >= m_last) {
+    m_done = true;
+    return;
+  }
+  enter(first);
+  next();
+}
+
+void Postings::Cursor::enter(u64 block) noexcept {
+  auto const &skip = m_list.skips[block];
+  m_block = block;
+  m_offset = skip.offset;
+  m_value = skip.base;
+}
+
+void Postings::Cursor::next() noexcept {
+  if (m_offset >= m_end) {
+    m_done = true;
+    return;
+  }
+  auto const skips = m_list.skips;
+  if (m_block + 1 < m_last && m_offset == skips[m_block + 1].offset)
+    ++m_block;
+  auto const bytes = m_list.bytes;
+  u32 delta = 0;
+  for (u32 shift = 0; m_offset != m_end && shift < 32; shift += 7) {
+    auto const byte = bytes[m_offset++];
+    delta |= static_cast<u32>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+  }
+  m_value += delta;
+}
+
+void Postings::Cursor::seek(u32 target) noexcept {
+  if (m_done || m_value >= target)
+    return;
+  // the last block starting at or before `target`, if it's ahead of us.
+  auto const skips = m_list.skips;
+  auto const found =
+      std::upper_bound(skips.begin() + static_cast<i64>(m_block) + 1,
+                       skips.begin() + static_cast<i64>(m_last), target,
+                       [](u32 target, Skip const &skip) {
+                         return target < skip.first;
+                       });
+  if (found != skips.begin() + static_cast<i64>(m_block) + 1) {
+    enter(static_cast<u64>(found - skips.begin()) - 1);
+    next();
+  }
+  while (!m_done && m_value < target)
+    next();
+}
+
+} // namespace symbols
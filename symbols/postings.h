@@ -0,0 +1,78 @@
+#pragma once
+#include "numbers.h"
+#include <span>
+#include <vector>
+
+namespace symbols {
+
+// An increasing list of ids, stored as varint-encoded deltas. Every
+// `BLOCK_SIZE` ids, a skip entry records where a block starts, so that
+// cursors can jump ahead without decoding everything in between, and
+// intersections can be split by block.
+class Postings {
+public:
+  static constexpr u64 BLOCK_SIZE = 128;
+
+  struct Skip {
+    u32 first;
+    // the id before `first` (its delta is from there), and where it starts
+    u32 base;
+    u64 offset;
+  };
+
+  // A list as laid out in memory, or in a mapped file.
+  struct View {
+    std::span<u8 const> bytes;
+    std::span<Skip const> skips;
+    u64 size;
+  };
+
+  // `id` must be greater than every id already in the list.
+  void append(u32 id);
+
+  u64 size() const noexcept { return m_size; }
+  u64 blocks() const noexcept { return m_skips.size(); }
+  // The first id of `block`.
+  u32 first_of(u64 block) const noexcept { return m_skips[block].first; }
+  // Bytes used.
+  u64 usage() const noexcept {
+    return m_bytes.capacity() + m_skips.capacity() * sizeof(Skip);
+  }
+  View view() const noexcept { return {m_bytes, m_skips, m_size}; }
+
+  // Reads the ids of blocks [first, last) of a list in order. Lists that
+  // were mapped are checked as they're read: reading stops at the end of the
+  // bytes of the blocks whatever they hold.
+  class Cursor {
+  public:
+    Cursor(View list, u64 first, u64 last) noexcept;
+
+    bool done() const noexcept { return m_done; }
+    u32 value() const noexcept { return m_value; }
+    void next() noexcept;
+    // Moves to the first id not less than `target`.
+    void seek(u32 target) noexcept;
+
+  private:
+    void enter(u64 block) noexcept;
+
+    View m_list;
+    u64 m_block;
+    u64 m_last;
+    // offset of the next byte, and of the end of the readable bytes
+    u64 m_offset;
+    u64 m_end;
+    u32 m_value = 0;
+    bool m_done = false;
+  };
+
+  Cursor cursor() const noexcept { return Cursor(view(), 0, blocks()); }
+
+private:
+  std::vector<u8> m_bytes;
+  std::vector<Skip> m_skips;
+  u64 m_size = 0;
+  u32 m_last = 0;
+};
+
+} // namespace symbols
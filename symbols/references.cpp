@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <symbols/references.h>
+
+namespace symbols {
+
+u64 References::usage_of(Shard const &shard) noexcept {
+  // a hash node and the name in each file list, besides the shard's own.
+  u64 usage = 0;
+  for (auto const &[name, occurrences] : shard)
+    usage += 2 * (name.size() + 64) + sizeof(workspace::FileId) +
+             occurrences.capacity() * sizeof(Occurrence);
+  return usage;
+}
+
+void References::update(workspace::FileId file, Shard shard) {
+  auto const usage = usage_of(shard);
+  if (auto const previous = m_shards.find(file)) {
+    // names used before and after keep their place in the file lists.
+    for (auto const &[name, occurrences] : *previous)
+      if (!shard.contains(name)) {
+        auto &files = m_files[name];
+        files.erase(std::lower_bound(files.begin(), files.end(), file));
+        if (files.empty())
+          m_files.erase(name);
+      }
+    for (auto const &[name, occurrences] : shard)
+      if (!previous->contains(name)) {
+        auto &files = m_files[name];
+        files.insert(std::lower_bound(files.begin(), files.end(), file), file);
+      }
+  } else {
+    for (auto const &[name, occurrences] : shard) {
+      auto &files = m_files[name];
+      files.insert(std::lower_bound(files.begin(), files.end(), file), file);
+    }
+  }
+  m_shards.put(file, std::move(shard), usage, now());
+  m_outdated.erase(file);
+}
+
+void References::remove(workspace::FileId file) {
+  m_outdated.erase(file);
+  auto const found = m_shards.find(file);
+  if (!found)
+    return;
+  for (auto const &[name, occurrences] : *found) {
+    auto &files = m_files[name];
+    files.erase(std::lower_bound(files.begin(), files.end(), file));
+    if (files.empty())
+      m_files.erase(name);
+  }
+  m_shards.erase(file);
+}
+
+void References::close(workspace::FileId file) {
+  remove(file);
+  m_outdated.insert(file);
+}
+
+std::vector<workspace::FileId> References::take_outdated() {
+  std::vector<workspace::FileId> files(m_outdated.begin(), m_outdated.end());
+  m_outdated.clear();
+  return files;
+}
+
+auto References::find(std::string const &name) const
+    -> std::vector<Location> {
+  std::vector<Location> locations;
+  auto const files = m_files.find(name);
+  if (files == m_files.end())
+    return locations;
+  auto const used = now();
+  for (auto const file : files->second) {
+    m_shards.use(file, used);
+    for (auto const &occurrence : m_shards.find(file)->at(name))
+      locations.push_back({file, occurrence});
+  }
+  return locations;
+}
+
+void References::invalidate(workspace::FileId file) noexcept {
+  // whatever is there stays until indexed again.
+  if (m_shards.contains(file))
+    m_outdated.insert(file);
+}
+
+void References::invalidate_all() noexcept {
+  m_shards.visit([&](workspace::FileId file, Shard const &) {
+    m_outdated.insert(file);
+  });
+}
+
+std::optional<u64> References::oldest(bool) const noexcept {
+  auto const entry = oldest_of(m_shards, false);
+  if (!entry)
+    return std::nullopt;
+  return entry->last_used;
+}
+
+void References::evict_oldest(bool) noexcept {
+  if (auto const entry = oldest_of(m_shards, false))
+    close(entry->file);
+}
+
+} // namespace symbols
@@ -0,0 +1,111 @@
+#pragma once
+#include <memory/budget.h>
+#include <rpc/lsp.h>
+#include <string>
+#include <symbols/index.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <workspace/caches.h>
+
+namespace symbols {
+
+// What a name is at one of its occurrences, as far as the tokens around it
+// tell.
+enum class Role : u8 {
+  // anything else, such as a call or a type
+  Use,
+  // the name of a declaration of the outline
+  Declaration,
+  // the name of a field, a variant or a method, declared in a type
+  MemberDeclaration,
+  // after a `.`: a member of some value, of a type unknown
+  Member,
+  // bound by `let`, `mut` or `for`
+  Binding,
+  // of a parameter that calls pass by name
+  Parameter,
+  // the name an argument is passed by in a call
+  Label,
+};
+
+// Where a name is used in a file.
+struct Occurrence {
+  rpc::lsp::Range range;
+  Role role;
+
+  bool declares() const noexcept {
+    return role == Role::Declaration || role == Role::MemberDeclaration;
+  }
+};
+
+// The occurrences of every name used in a file, by name.
+using Shard = std::unordered_map<std::string, std::vector<Occurrence>>;
+
+// What the workspace indexes of a file.
+struct FileIndex {
+  std::vector<Symbol> symbols;
+  Shard references;
+};
+
+// Every use of every name in the workspace, for the requests that need all
+// of them at once (references, rename).
+//
+// Occurrences are kept in one shard per file, and a name maps to the files
+// whose shard has it. Reindexing a file swaps its shard, and only touches the
+// file lists of the names it had or has: a lookup then costs one probe per
+// file using the name, however big the workspace.
+class References : public memory::Consumer, public workspace::FileCache {
+public:
+  struct Location {
+    workspace::FileId file;
+    Occurrence occurrence;
+  };
+
+  // Replaces the occurrences in `file`.
+  void update(workspace::FileId file, Shard shard);
+  void remove(workspace::FileId file);
+  // Drops the occurrences of an open document that was closed, for them to
+  // be indexed again from the disk.
+  void close(workspace::FileId file);
+
+  bool contains(workspace::FileId file) const noexcept {
+    return m_shards.contains(file);
+  }
+  // The occurrences in `file`, if any.
+  Shard const *shard(workspace::FileId file) const noexcept {
+    return m_shards.find(file);
+  }
+  // Files whose occurrences got out of date since the last call.
+  std::vector<workspace::FileId> take_outdated();
+
+  // Every occurrence of `name`, by file, in the order of each shard.
+  std::vector<Location> find(std::string const &name) const;
+  // Calls `visit(std::string const &name)` for every name used anywhere.
+  template <typename Visitor> void visit_names(Visitor &&visit) const {
+    for (auto const &[name, files] : m_files)
+      visit(name);
+  }
+
+  // memory::Consumer
+  std::string_view name() const noexcept override { return "references"; }
+  u64 usage() const noexcept override { return m_shards.usage(); }
+  // Occurrences in files on the disk are evicted and reported outdated, to
+  // be indexed again when next needed. Those of open documents stay.
+  std::optional<u64> oldest(bool open_too) const noexcept override;
+  void evict_oldest(bool open_too) noexcept override;
+
+  // workspace::FileCache
+  void invalidate(workspace::FileId file) noexcept override;
+  void invalidate_all() noexcept override;
+
+private:
+  static u64 usage_of(Shard const &shard) noexcept;
+
+  memory::Cache<Shard> m_shards;
+  // by name, the files using it, sorted
+  std::unordered_map<std::string, std::vector<workspace::FileId>> m_files;
+  std::unordered_set<workspace::FileId> m_outdated;
+};
+
+} // namespace symbols
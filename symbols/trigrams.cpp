@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <future>
+#include <symbols/trigrams.h>
+#include <thread>
+
+namespace symbols {
+
+namespace {
+// ids in the shortest posting list above which intersections are split
+// across threads.
+constexpr u64 PARALLEL_THRESHOLD = u64(1) << 15;
+
+char lower(char c) noexcept {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+bool is_alnum(char c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9');
+}
+
+// Trigrams, and prefixes of one or two characters, with their length in the
+// high byte so they never collide.
+u32 key(u32 length, char a, char b = 0, char c = 0) noexcept {
+  return length << 24 | u32(static_cast<u8>(a)) << 16 |
+         u32(static_cast<u8>(b)) << 8 | u32(static_cast<u8>(c));
+}
+
+// The ids in all of `lists`, looking only at blocks [first, last) of the
+// first one, which should be the shortest.
+std::vector<u32> leapfrog(std::vector<Postings::View> const &lists,
+                          u64 first, u64 last) {
+  std::vector<u32> ids;
+  Postings::Cursor lead(lists.front(), first, last);
+  std::vector<Postings::Cursor> others;
+  others.reserve(lists.size() - 1);
+  for (auto list = lists.begin() + 1; list != lists.end(); ++list)
+    others.emplace_back(*list, 0, list->skips.size());
+
+  while (!lead.done()) {
+    auto const candidate = lead.value();
+    bool in_all = true;
+    for (auto &other : others) {
+      other.seek(candidate);
+      if (other.done())
+        return ids;
+      if (other.value() != candidate) {
+        lead.seek(other.value());
+        in_all = false;
+        break;
+      }
+    }
+    if (in_all) {
+      ids.push_back(candidate);
+      lead.next();
+    }
+  }
+  return ids;
+}
+} // namespace
+
+std::vector<u32> keys_of_name(std::string_view name) {
+  std::vector<u32> keys;
+  if (name.empty())
+    return keys;
+
+  // where each word of the name starts: fooBar, foo_bar, foo2.
+  auto const is_head = [&](u64 i) {
+    if (i == 0)
+      return true;
+    auto const c = name[i], previous = name[i - 1];
+    if (!is_alnum(c))
+      return false;
+    return !is_alnum(previous) ||
+           (c >= 'A' && c <= 'Z' && previous >= 'a' && previous <= 'z') ||
+           (c >= '0' && c <= '9' && !(previous >= '0' && previous <= '9'));
+  };
+  std::vector<u64> next_head(name.size() + 1, name.size());
+  for (auto i = name.size(); i-- > 1;)
+    next_head[i - 1] = is_head(i) ? i : next_head[i];
+
+  // from each character, the one after it or the start of the next word.
+  auto const visit_next = [&](u64 from, auto &&visit) {
+    if (from + 1 < name.size())
+      visit(from + 1);
+    if (next_head[from] != from + 1 && next_head[from] < name.size())
+      visit(next_head[from]);
+  };
+  keys.reserve(name.size() * 4 + 2);
+  for (u64 a = 0; a < name.size(); ++a)
+    visit_next(a, [&](u64 b) {
+      visit_next(b, [&](u64 c) {
+        keys.push_back(
+            key(3, lower(name[a]), lower(name[b]), lower(name[c])));
+      });
+    });
+  keys.push_back(key(1, lower(name[0])));
+  if (name.size() >= 2)
+    keys.push_back(key(2, lower(name[0]), lower(name[1])));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+std::vector<u32> keys_of_query(std::string_view query) {
+  std::vector<u32> keys;
+  if (query.size() == 1)
+    keys.push_back(key(1, lower(query[0])));
+  else if (query.size() == 2)
+    keys.push_back(key(2, lower(query[0]), lower(query[1])));
+  for (u64 i = 0; i + 3 <= query.size(); ++i)
+    keys.push_back(
+        key(3, lower(query[i]), lower(query[i + 1]), lower(query[i + 2])));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+std::vector<u32> intersect(std::vector<Postings::View> lists) {
+  if (lists.empty())
+    return {};
+  std::sort(lists.begin(), lists.end(),
+            [](auto const &a, auto const &b) { return a.size < b.size; });
+
+  auto const &shortest = lists.front();
+  auto const parts =
+      std::min<u64>(std::max(1u, std::thread::hardware_concurrency()),
+                    shortest.size / PARALLEL_THRESHOLD + 1);
+  auto const blocks = shortest.skips.size();
+  if (parts == 1)
+    return leapfrog(lists, 0, blocks);
+
+  // each part leads with its own blocks of the shortest list.
+  std::vector<std::future<std::vector<u32>>> futures;
+  for (u64 part = 0; part != parts; ++part)
+    futures.push_back(std::async(std::launch::async, leapfrog,
+                                 std::cref(lists), blocks * part / parts,
+                                 blocks * (part + 1) / parts));
+  std::vector<u32> ids;
+  for (auto &future : futures) {
+    auto const part = future.get();
+    ids.insert(ids.end(), part.begin(), part.end());
+  }
+  return ids;
+}
+
+} // namespace symbols
@@ -0,0 +1,23 @@
+#pragma once
+#include "numbers.h"
+#include <string_view>
+#include <symbols/postings.h>
+#include <vector>
+
+// The keys symbol names are indexed by, shared by the index in memory and
+// the one saved on disk.
+namespace symbols {
+
+// Trigrams of `name` a fuzzy query could have typed in a row, either because
+// they follow each other in the name or because they start its words ("fba"
+// for "FooBar"), plus its first one and two characters. Sorted, without
+// duplicates.
+std::vector<u32> keys_of_name(std::string_view name);
+// Keys a name needs all of to match `query`: its trigrams, or for queries too
+// short to have any, the prefix of names they must be.
+std::vector<u32> keys_of_query(std::string_view query);
+
+// Ids in all of `lists`. Large intersections are split across threads.
+std::vector<u32> intersect(std::vector<Postings::View> lists);
+
+} // namespace symbols
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <deque>
+#include <matching/fuzzy.h>
+#include <symbols/workspace.h>
+#include <utility>
+#include <workspace/file_ids.h>
+#include <workspace/hash.h>
+#include <workspace/mapped_file.h>
+
+namespace symbols {
+
+Workspace::Loaded Workspace::read(std::filesystem::path const &path) {
+  Loaded loaded{DiskIndex::open(path), {}, {}, {}, {}, false};
+  // from nothing, even an empty index is worth saving.
+  loaded.changed = !loaded.disk;
+  if (!loaded.disk)
+    return loaded;
+
+  auto const &disk = *loaded.disk;
+  auto const files = disk.files();
+  loaded.files.reserve(files);
+  for (u32 number = 0; number != files; ++number) {
+    std::filesystem::path const file_path(disk.path(number));
+    auto const file = workspace::file_ids().intern_path(file_path);
+    loaded.files.push_back(file);
+    // deleted since
+    auto current = Stamp::stat(file_path);
+    if (!current) {
+      loaded.changed = true;
+      continue;
+    }
+    auto const saved = disk.stamp(number);
+    if (!current->same_times(saved)) {
+      // touched, but not necessarily changed.
+      auto const hash = workspace::with_mapped_file(
+          file_path, [](std::string_view bytes) {
+            return workspace::hash_bytes(bytes);
+          });
+      loaded.changed = true;
+      if (!hash || *hash != saved.hash) {
+        loaded.outdated.insert(file);
+        continue;
+      }
+    }
+    current->hash = saved.hash;
+    loaded.saved[file] = {number, *current};
+    if (auto references = disk.references(number))
+      loaded.references.emplace(file, std::move(*references));
+  }
+  return loaded;
+}
+
+void Workspace::expect_load() noexcept {
+  m_loading = true;
+  m_invalidated_while_loading.clear();
+  m_all_invalidated_while_loading = false;
+}
+
+void Workspace::adopt(Loaded loaded, References &references) {
+  m_disk = std::move(loaded.disk);
+  m_disk_files = std::move(loaded.files);
+  m_saved.clear();
+  m_visible.assign(m_disk_files.size(), false);
+  m_changed |= loaded.changed;
+  for (auto const &[file, saved] : loaded.saved) {
+    // indexed again since, or changed after it was checked.
+    if (m_stamps.contains(file) ||
+        m_invalidated_while_loading.contains(file)) {
+      m_changed = true;
+      if (!m_stamps.contains(file))
+        m_outdated.insert(file);
+      continue;
+    }
+    m_saved[file] = saved;
+    m_visible[saved.number] = !m_memory.contains(file);
+    if (auto const shard = loaded.references.find(file);
+        shard != loaded.references.end() && !references.contains(file))
+      references.update(file, std::move(shard->second));
+  }
+  for (auto const file : loaded.outdated)
+    if (!m_stamps.contains(file))
+      m_outdated.insert(file);
+
+  m_loading = false;
+  m_invalidated_while_loading.clear();
+  if (std::exchange(m_all_invalidated_while_loading, false))
+    invalidate_all();
+}
+
+bool Workspace::save(std::filesystem::path const &path,
+                     References const &references) {
+  if (!m_changed)
+    return true;
+  std::vector<DiskIndex::File> files;
+  files.reserve(m_saved.size() + m_stamps.size());
+  // occurrences saved before, read back to be written again.
+  std::deque<Shard> saved_references;
+  for (auto const &[file, saved] : m_saved) {
+    auto shard = m_disk->references(saved.number);
+    // an open document's may have changes that aren't saved.
+    auto const *found = m_memory.contains(file) ? nullptr
+                                                : references.shard(file);
+    if (shard)
+      found = &saved_references.emplace_back(std::move(*shard));
+    files.push_back({std::string(m_disk->path(saved.number)), saved.stamp,
+                     m_disk->symbols(saved.number), found});
+  }
+  for (auto const &[file, stamp] : m_stamps)
+    if (auto const &file_path = workspace::file_ids().path(file))
+      files.push_back({file_path->string(), stamp, m_memory.symbols(file),
+                       references.shard(file)});
+  // files of the same directory end up next to each other.
+  std::sort(files.begin(), files.end(),
+            [](auto const &a, auto const &b) { return a.path < b.path; });
+  if (!DiskIndex::write(path, files))
+    return false;
+  m_changed = false;
+  return true;
+}
+
+void Workspace::update(workspace::FileId file, std::vector<Symbol> symbols,
+                       std::optional<Stamp> stamp) {
+  m_memory.update(file, std::move(symbols));
+  set_visible(file, false);
+  if (!stamp) {
+    m_changed |= m_stamps.erase(file) != 0;
+    return;
+  }
+  m_changed = true;
+  m_stamps[file] = *stamp;
+  m_saved.erase(file);
+  m_outdated.erase(file);
+}
+
+void Workspace::close(workspace::FileId file) {
+  // never indexed as an open document.
+  if (m_stamps.contains(file))
+    return;
+  m_memory.remove(file);
+  if (m_saved.contains(file))
+    set_visible(file, true);
+  else
+    m_outdated.insert(file);
+}
+
+void Workspace::remove(workspace::FileId file) {
+  if (m_loading)
+    m_invalidated_while_loading.insert(file);
+  m_memory.remove(file);
+  set_visible(file, false);
+  m_changed |= m_stamps.erase(file) + m_saved.erase(file) != 0;
+  m_outdated.erase(file);
+}
+
+std::unordered_set<workspace::FileId> Workspace::indexed() const {
+  std::unordered_set<workspace::FileId> files;
+  files.reserve(m_saved.size() + m_stamps.size());
+  for (auto const &[file, saved] : m_saved)
+    files.insert(file);
+  for (auto const &[file, stamp] : m_stamps)
+    files.insert(file);
+  return files;
+}
+
+std::optional<Stamp> Workspace::stamp(workspace::FileId file) const {
+  if (auto const found = m_stamps.find(file); found != m_stamps.end())
+    return found->second;
+  if (auto const found = m_saved.find(file); found != m_saved.end())
+    return found->second.stamp;
+  return std::nullopt;
+}
+
+std::vector<workspace::FileId> Workspace::take_outdated() {
+  std::vector<workspace::FileId> files(m_outdated.begin(), m_outdated.end());
+  m_outdated.clear();
+  return files;
+}
+
+auto Workspace::query(std::string_view query, u64 limit) const
+    -> std::vector<Match> {
+  auto const fresh = m_memory.query(query, limit);
+  std::vector<DiskIndex::Match> saved;
+  if (m_disk)
+    saved = m_disk->query(query, limit, m_visible);
+
+  // both are ranked already, the best of them are taken again.
+  matching::TopK top(limit);
+  for (u64 i = 0; i != fresh.size(); ++i)
+    top.push(static_cast<u32>(i), fresh[i].score, fresh[i].symbol->name.size());
+  for (u64 i = 0; i != saved.size(); ++i)
+    top.push(static_cast<u32>(fresh.size() + i), saved[i].score,
+             saved[i].symbol.name.size());
+  std::vector<Match> matches;
+  for (auto const &ranked : std::move(top).take()) {
+    if (ranked.index < fresh.size()) {
+      auto const &match = fresh[ranked.index];
+      matches.push_back({match.file, *match.symbol, match.score});
+    } else {
+      auto const &match = saved[ranked.index - fresh.size()];
+      matches.push_back({m_disk_files[match.file], match.symbol, match.score});
+    }
+  }
+  return matches;
+}
+
+void Workspace::invalidate(workspace::FileId file) noexcept {
+  if (m_loading)
+    m_invalidated_while_loading.insert(file);
+  if (m_saved.contains(file)) {
+    set_visible(file, false);
+    m_saved.erase(file);
+    m_outdated.insert(file);
+    m_changed = true;
+  }
+  // whatever is in memory stays until indexed again.
+  if (m_stamps.erase(file)) {
+    m_outdated.insert(file);
+    m_changed = true;
+  }
+}
+
+void Workspace::invalidate_all() noexcept {
+  m_all_invalidated_while_loading |= m_loading;
+  for (auto const &[file, saved] : m_saved)
+    m_outdated.insert(file);
+  for (auto const &[file, stamp] : m_stamps)
+    m_outdated.insert(file);
+  m_changed |= !m_saved.empty() || !m_stamps.empty();
+  m_saved.clear();
+  m_stamps.clear();
+  m_visible.assign(m_visible.size(), false);
+}
+
+void Workspace::set_visible(workspace::FileId file, bool visible) {
+  if (auto const found = m_saved.find(file); found != m_saved.end())
+    m_visible[found->second.number] = visible;
+}
+
+} // namespace symbols
@@ -0,0 +1,117 @@
+#pragma once
+#include <filesystem>
+#include <memory/budget.h>
+#include <optional>
+#include <symbols/disk_index.h>
+#include <symbols/index.h>
+#include <symbols/references.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <workspace/caches.h>
+
+namespace symbols {
+
+// The symbols of every file of the workspace: the ones indexed during this
+// session, in memory, over the ones saved by the previous session.
+//
+// Saved files are trusted as long as they have the same size and
+// modification time on disk, or failing that the same hash. The others are
+// reported outdated, to be indexed again. Open documents hide their saved
+// symbols while they're open, without replacing them: unsaved changes are
+// never saved. The occurrences of names in each file are saved along, for
+// `References`.
+class Workspace : public memory::Consumer, public workspace::FileCache {
+public:
+  struct Match {
+    workspace::FileId file;
+    SymbolView symbol;
+    i32 score;
+  };
+  // A saved file still up to date, with its number in the index and its
+  // stamp as checked against the disk.
+  struct Saved {
+    u32 number;
+    Stamp stamp;
+  };
+  // What `read` found, for `adopt`.
+  struct Loaded {
+    std::optional<DiskIndex> disk;
+    // by number in `disk`
+    std::vector<workspace::FileId> files;
+    std::unordered_map<workspace::FileId, Saved> saved;
+    // of the files in `saved` that had them saved
+    std::unordered_map<workspace::FileId, Shard> references;
+    std::unordered_set<workspace::FileId> outdated;
+    bool changed;
+  };
+
+  // Maps the index saved at `path`, if there's a valid one, and checks its
+  // files against the disk. Runs on any thread, since that takes a while in
+  // large workspaces.
+  static Loaded read(std::filesystem::path const &path);
+  // From now until `adopt`, keeps track of the files invalidated, which
+  // `read` may have checked before they changed.
+  void expect_load() noexcept;
+  // Takes over what `read` found, and gives `references` the occurrences
+  // saved of the files it hasn't got. Files indexed or invalidated meanwhile
+  // stay as they are.
+  void adopt(Loaded loaded, References &references);
+  // Saves the symbols of files as they are on disk to `path`, with their
+  // occurrences in `references` if it has them, unless nothing changed
+  // since they were loaded or saved.
+  bool save(std::filesystem::path const &path, References const &references);
+
+  // Replaces the symbols of `file`, extracted from its contents on disk as
+  // of `stamp`, or from its open document if there's none.
+  void update(workspace::FileId file, std::vector<Symbol> symbols,
+              std::optional<Stamp> stamp);
+  // Drops the symbols of an open document that was closed.
+  void close(workspace::FileId file);
+  // Drops the symbols of a file that's gone.
+  void remove(workspace::FileId file);
+
+  // Files whose symbols are up to date with their contents on disk.
+  std::unordered_set<workspace::FileId> indexed() const;
+  // What the symbols of `file` were extracted from, if it's one of those.
+  std::optional<Stamp> stamp(workspace::FileId file) const;
+  // Files whose symbols got out of date since the last call.
+  std::vector<workspace::FileId> take_outdated();
+
+  // The best `limit` matches, best first. Symbols are valid until the next
+  // change.
+  std::vector<Match> query(std::string_view query, u64 limit) const;
+
+  // memory::Consumer
+  std::string_view name() const noexcept override { return "symbols"; }
+  u64 usage() const noexcept override { return m_memory.usage(); }
+
+  // workspace::FileCache
+  void invalidate(workspace::FileId file) noexcept override;
+  void invalidate_all() noexcept override;
+
+private:
+  // Shows or hides the saved symbols of `file`, if it has any.
+  void set_visible(workspace::FileId file, bool visible);
+
+  Index m_memory;
+  // files in `m_memory` indexed from their contents on disk
+  std::unordered_map<workspace::FileId, Stamp> m_stamps;
+
+  std::optional<DiskIndex> m_disk;
+  // by number in `m_disk`
+  std::vector<workspace::FileId> m_disk_files;
+  // saved files still up to date
+  std::unordered_map<workspace::FileId, Saved> m_saved;
+  // by number in `m_disk`: whether the file is saved and not hidden
+  std::vector<bool> m_visible;
+
+  std::unordered_set<workspace::FileId> m_outdated;
+  // whether what `save` would write changed
+  bool m_changed = false;
+  // between `expect_load` and `adopt`
+  bool m_loading = false;
+  std::unordered_set<workspace::FileId> m_invalidated_while_loading;
+  bool m_all_invalidated_while_loading = false;
+};
+
+} // namespace symbols
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <array>
+#include <syntax/lexer.h>
+
+namespace syntax {
+
+namespace {
+constexpr std::array<std::string_view, 57> KEYWORDS = {
+    "and", "anon", "as", "boxed", "break", "catch", "class", "comptime",
+    "continue", "cpp", "defer", "destructor", "else", "enum", "export",
+    "extern", "false", "fn", "for", "function", "guard", "if", "implements",
+    "import", "in", "is", "let", "loop", "match", "must", "mut", "namespace",
+    "not", "or", "override", "private", "public", "raw", "reflect", "relative",
+    "requires", "restricted", "return", "sizeof", "struct", "this", "throw",
+    "throws", "trait", "true", "try", "unsafe", "use", "virtual", "weak",
+    "while", "yield"};
+static_assert(std::is_sorted(KEYWORDS.begin(), KEYWORDS.end()));
+static_assert(KEYWORDS.size() == static_cast<u64>(Keyword::Yield));
+
+bool is_space(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+bool is_identifier_start(char c) noexcept {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+bool is_identifier(char c) noexcept {
+  return is_identifier_start(c) || is_digit(c);
+}
+} // namespace
+
+Keyword keyword_of(std::string_view word) noexcept {
+  auto const found = std::lower_bound(KEYWORDS.begin(), KEYWORDS.end(), word);
+  if (found == KEYWORDS.end() || *found != word)
+    return Keyword::None;
+  return static_cast<Keyword>(found - KEYWORDS.begin() + 1);
+}
+
+std::string_view spelling(Keyword keyword) noexcept {
+  if (keyword == Keyword::None)
+    return {};
+  return KEYWORDS[static_cast<u64>(keyword) - 1];
+}
+
+std::optional<Token> Lexer::next() {
+  while (is_space(peek()))
+    ++m_offset;
+  auto const start = m_offset;
+  auto const c = peek();
+  if (c == '\0' && start >= m_size)
+    return std::nullopt;
+
+  auto const token = [&](TokenKind kind, Keyword keyword = Keyword::None) {
+    return Token{start, static_cast<u32>(m_offset - start), kind, keyword};
+  };
+
+  if (is_identifier_start(c)) {
+    // b'c' and c'c' are byte and C characters.
+    if ((c == 'b' || c == 'c') && peek(1) == '\'') {
+      ++m_offset;
+      skip_quoted('\'');
+      return token(TokenKind::Character);
+    }
+    // keywords are short, longer words needn't be kept.
+    std::array<char, 16> word;
+    u64 length = 0;
+    for (char next = c; is_identifier(next); next = peek()) {
+      if (length < word.size())
+        word[length] = next;
+      ++length;
+      ++m_offset;
+    }
+    auto const keyword =
+        length > word.size()
+            ? Keyword::None
+            : keyword_of(std::string_view(word.data(), length));
+    return token(keyword == Keyword::None ? TokenKind::Identifier
+                                          : TokenKind::Keyword,
+                 keyword);
+  }
+  if (is_digit(c)) {
+    skip_number();
+    return token(TokenKind::Number);
+  }
+  if (c == '"') {
+    skip_quoted('"');
+    return token(TokenKind::String);
+  }
+  if (c == '\'') {
+    skip_quoted('\'');
+    return token(TokenKind::Character);
+  }
+  if (c == '/' && peek(1) == '/') {
+    skip_line();
+    return token(TokenKind::Comment);
+  }
+  if (c == '/' && peek(1) == '*') {
+    skip_block_comment();
+    return token(TokenKind::Comment);
+  }
+  if (static_cast<u8>(c) >= 0x80) {
+    // a whole UTF-8 sequence, so that positions stay on characters.
+    ++m_offset;
+    while ((static_cast<u8>(peek()) & 0xc0) == 0x80)
+      ++m_offset;
+    return token(TokenKind::Unknown);
+  }
+  auto const kind = punctuation();
+  return token(kind);
+}
+
+void Lexer::skip_line() {
+  for (auto c = peek(); c != '\n' && c != '\0'; c = peek())
+    ++m_offset;
+}
+
+void Lexer::skip_block_comment() {
+  m_offset += 2;
+  while (true) {
+    auto const c = peek();
+    if (c == '\0' && m_offset >= m_size)
+      return;
+    ++m_offset;
+    if (c == '*' && peek() == '/') {
+      ++m_offset;
+      return;
+    }
+  }
+}
+
+void Lexer::skip_quoted(char quote) {
+  ++m_offset;
+  while (true) {
+    auto const c = peek();
+    // an unterminated literal ends with its line.
+    if (c == '\n' || (c == '\0' && m_offset >= m_size))
+      return;
+    ++m_offset;
+    if (c == quote)
+      return;
+    // nothing to escape past the end.
+    if (c == '\\' && m_offset < m_size && peek() != '\n')
+      ++m_offset;
+  }
+}
+
+void Lexer::skip_number() {
+  // prefixes (0x), digit separators and suffixes (u8, f64) are all
+  // identifier characters.
+  while (is_identifier(peek()))
+    ++m_offset;
+  // a fraction, but not the start of a range such as `0..10`.
+  if (peek() == '.' && is_digit(peek(1))) {
+    ++m_offset;
+    while (is_identifier(peek()))
+      ++m_offset;
+  }
+}
+
+TokenKind Lexer::punctuation() {
+  auto const c = peek();
+  auto const next = peek(1);
+  ++m_offset;
+  switch (c) {
+  case '(':
+    return TokenKind::OpenParen;
+  case ')':
+    return TokenKind::CloseParen;
+  case '{':
+    return TokenKind::OpenBrace;
+  case '}':
+    return TokenKind::CloseBrace;
+  case '[':
+    return TokenKind::OpenBracket;
+  case ']':
+    return TokenKind::CloseBracket;
+  case ',':
+    return TokenKind::Comma;
+  case ';':
+    return TokenKind::Semicolon;
+  case ':':
+    if (next != ':')
+      return TokenKind::Colon;
+    ++m_offset;
+    return TokenKind::ColonColon;
+  case '.':
+    if (next != '.')
+      return TokenKind::Dot;
+    ++m_offset;
+    return TokenKind::Operator;
+  case '-':
+    if (next == '>') {
+      ++m_offset;
+      return TokenKind::Arrow;
+    }
+    if (next == '-' || next == '=')
+      ++m_offset;
+    return TokenKind::Operator;
+  case '=':
+    if (next == '>') {
+      ++m_offset;
+      return TokenKind::FatArrow;
+    }
+    if (next == '=')
+      ++m_offset;
+    return TokenKind::Operator;
+  case '<':
+  case '>':
+    // <<, <<<, <<=, <=
+    if (next == c) {
+      ++m_offset;
+      if (peek() == c || peek() == '=')
+        ++m_offset;
+    } else if (next == '=') {
+      ++m_offset;
+    }
+    return TokenKind::Operator;
+  case '?':
+    // ??, ??=
+    if (next == '?') {
+      ++m_offset;
+      if (peek() == '=')
+        ++m_offset;
+    }
+    return TokenKind::Operator;
+  case '+':
+  case '&':
+  case '|':
+    // ++, &&, ||, +=, &=, |=
+    if (next == c || next == '=')
+      ++m_offset;
+    return TokenKind::Operator;
+  case '*':
+  case '/':
+  case '%':
+  case '^':
+  case '!':
+    if (next == '=')
+      ++m_offset;
+    return TokenKind::Operator;
+  case '~':
+  case '$':
+  case '@':
+  case '#':
+    return TokenKind::Operator;
+  default:
+    return TokenKind::Unknown;
+  }
+}
+
+std::vector<Token> lex(std::string_view text) {
+  std::vector<Token> tokens;
+  Lexer lexer(text, 0);
+  while (auto const token = lexer.next())
+    tokens.push_back(*token);
+  return tokens;
+}
+
+} // namespace syntax
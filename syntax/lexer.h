@@ -0,0 +1,201 @@
+#pragma once
+#include "numbers.h"
+#include <documents/rope.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lexing and parsing of Jakt source, for the features that don't need the
+// compiler: they must stay fast, and keep working while the code doesn't
+// compile.
+namespace syntax {
+
+enum class TokenKind : u8 {
+  Identifier,
+  Keyword,
+  Number,
+  String,
+  // 'c', b'c' or c'c'
+  Character,
+  Comment,
+  OpenParen,
+  CloseParen,
+  OpenBrace,
+  CloseBrace,
+  OpenBracket,
+  CloseBracket,
+  Comma,
+  Dot,
+  Colon,
+  ColonColon,
+  Semicolon,
+  Arrow,
+  FatArrow,
+  // any other operator
+  Operator,
+  // bytes that don't start any token
+  Unknown,
+};
+
+// In alphabetical order, see `keyword_of`.
+enum class Keyword : u8 {
+  None,
+  And,
+  Anon,
+  As,
+  Boxed,
+  Break,
+  Catch,
+  Class,
+  Comptime,
+  Continue,
+  Cpp,
+  Defer,
+  Destructor,
+  Else,
+  Enum,
+  Export,
+  Extern,
+  False,
+  Fn,
+  For,
+  Function,
+  Guard,
+  If,
+  Implements,
+  Import,
+  In,
+  Is,
+  Let,
+  Loop,
+  Match,
+  Must,
+  Mut,
+  Namespace,
+  Not,
+  Or,
+  Override,
+  Private,
+  Public,
+  Raw,
+  Reflect,
+  Relative,
+  Requires,
+  Restricted,
+  Return,
+  Sizeof,
+  Struct,
+  This,
+  Throw,
+  Throws,
+  Trait,
+  True,
+  Try,
+  Unsafe,
+  Use,
+  Virtual,
+  Weak,
+  While,
+  Yield,
+};
+
+// `Keyword::None` if `word` isn't one.
+Keyword keyword_of(std::string_view word) noexcept;
+// How `keyword` is spelled, empty for `Keyword::None`.
+std::string_view spelling(Keyword keyword) noexcept;
+
+struct Token {
+  // byte offset in the text
+  u64 start;
+  u32 length;
+  TokenKind kind;
+  // for `TokenKind::Keyword`
+  Keyword keyword = Keyword::None;
+
+  u64 end() const noexcept { return start + length; }
+};
+
+// Reads tokens out of a rope, or of bytes that aren't in one such as a mapped
+// file, from `offset` on. `offset` must not be inside of a token.
+//
+// Lexing a token only depends on the text from its start up to
+// `LOOKAHEAD` bytes past its end, which is what allows relexing only
+// around an edit (see `Tokens`).
+//
+// Errors don't stop the lexer: unterminated strings and characters end at
+// the end of the line, and bytes that don't start a token make `Unknown`
+// ones.
+class Lexer {
+public:
+  static constexpr u64 LOOKAHEAD = 2;
+
+  Lexer(documents::Rope const &text, u64 offset) noexcept
+      : m_rope(&text), m_size(text.size()), m_offset(offset) {}
+  // `text` must outlive the lexer.
+  Lexer(std::string_view text, u64 offset) noexcept
+      : m_window(text), m_size(text.size()), m_offset(offset) {}
+
+  // Nothing at the end of the text.
+  std::optional<Token> next();
+
+private:
+  // Reads a rope by windows, since lexing goes forward a byte at a time.
+  // Other text is one window. Returns '\0' past the end of the text.
+  char peek(u64 ahead = 0) {
+    auto const offset = m_offset + ahead;
+    if (offset - m_window_start >= m_window.size()) {
+      if (!m_rope || offset >= m_size)
+        return '\0';
+      m_window_start = offset;
+      m_buffer = m_rope->substr(offset, WINDOW);
+      m_window = m_buffer;
+    }
+    return m_window[offset - m_window_start];
+  }
+
+  void skip_line();
+  void skip_block_comment();
+  void skip_quoted(char quote);
+  void skip_number();
+  TokenKind punctuation();
+
+  static constexpr u64 WINDOW = 4096;
+
+  documents::Rope const *m_rope = nullptr;
+  std::string m_buffer;
+  std::string_view m_window;
+  u64 m_window_start = 0;
+  u64 m_size;
+  u64 m_offset;
+};
+
+// Every token of `text`, for text that's lexed once and never edited.
+std::vector<Token> lex(std::string_view text);
+
+// Jakt strings are formatted with fmt-style `{...}` placeholders, `{{` and
+// `}}` being literal braces. Calls `visit(u64 offset, u64 length)` for every
+// placeholder of the string token `literal`, relative to its start.
+template <typename Visitor>
+void visit_interpolations(std::string_view literal, Visitor &&visit) {
+  for (u64 i = 0; i < literal.size(); ++i) {
+    auto const c = literal[i];
+    if (c == '\\') {
+      ++i;
+      continue;
+    }
+    if (c != '{')
+      continue;
+    if (i + 1 < literal.size() && literal[i + 1] == '{') {
+      ++i;
+      continue;
+    }
+    auto const close = literal.find('}', i);
+    if (close == std::string_view::npos)
+      return;
+    visit(i, close + 1 - i);
+    i = close;
+  }
+}
+
+} // namespace syntax
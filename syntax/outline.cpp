@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <syntax/outline.h>
+
+namespace syntax {
+
+namespace {
+bool is_modifier(Keyword keyword) noexcept {
+  switch (keyword) {
+  case Keyword::Boxed:
+  case Keyword::Comptime:
+  case Keyword::Extern:
+  case Keyword::Override:
+  case Keyword::Private:
+  case Keyword::Public:
+  case Keyword::Restricted:
+  case Keyword::Virtual:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::optional<DeclarationKind> declaration_kind(Keyword keyword) noexcept {
+  switch (keyword) {
+  case Keyword::Fn:
+  case Keyword::Function:
+    return DeclarationKind::Function;
+  case Keyword::Struct:
+    return DeclarationKind::Struct;
+  case Keyword::Class:
+    return DeclarationKind::Class;
+  case Keyword::Enum:
+    return DeclarationKind::Enum;
+  case Keyword::Namespace:
+    return DeclarationKind::Namespace;
+  case Keyword::Trait:
+    return DeclarationKind::Trait;
+  default:
+    return std::nullopt;
+  }
+}
+
+bool is_opening(TokenKind kind) noexcept {
+  return kind == TokenKind::OpenParen || kind == TokenKind::OpenBrace ||
+         kind == TokenKind::OpenBracket;
+}
+
+bool is_closing(TokenKind kind) noexcept {
+  return kind == TokenKind::CloseParen || kind == TokenKind::CloseBrace ||
+         kind == TokenKind::CloseBracket;
+}
+
+TokenKind closing_of(TokenKind kind) noexcept {
+  switch (kind) {
+  case TokenKind::OpenParen:
+    return TokenKind::CloseParen;
+  case TokenKind::OpenBrace:
+    return TokenKind::CloseBrace;
+  default:
+    return TokenKind::CloseBracket;
+  }
+}
+
+// Calls `match(open, close)` with the indexes in `tokens` of every pair of
+// brackets that match: a closing bracket matches the innermost opening one
+// of its kind, and whatever was opened after that is left unmatched.
+template <typename Match>
+void pair_brackets(std::span<Token const> tokens, Match &&match) {
+  std::vector<u64> open;
+  for (u64 i = 0; i != tokens.size(); ++i) {
+    auto const kind = tokens[i].kind;
+    if (is_opening(kind)) {
+      open.push_back(i);
+      continue;
+    }
+    if (!is_closing(kind))
+      continue;
+    auto const found = std::find_if(open.rbegin(), open.rend(), [&](u64 o) {
+      return closing_of(tokens[o].kind) == kind;
+    });
+    if (found == open.rend())
+      continue;
+    match(*found, i);
+    open.erase(std::prev(found.base()), open.end());
+  }
+}
+
+std::vector<Bracket> match_brackets(std::span<Token const> tokens) {
+  std::vector<Bracket> brackets;
+  pair_brackets(tokens, [&](u64 open, u64 close) {
+    brackets.push_back({tokens[open].start, tokens[close].start});
+  });
+  std::sort(brackets.begin(), brackets.end(),
+            [](Bracket a, Bracket b) { return a.open < b.open; });
+  return brackets;
+}
+
+class Parser {
+public:
+  // `spelling(start, length)` reads from the text.
+  using Spelling = std::function<std::string(u64 start, u64 length)>;
+  Parser(std::span<Token const> tokens, u64 size, Spelling spelling)
+      : m_tokens(tokens), m_size(size), m_spelling(std::move(spelling)) {}
+
+  Outline run();
+
+private:
+  struct Header {
+    DeclarationKind kind;
+    bool is_extern;
+    // token indexes
+    u64 first;
+    u64 name;
+  };
+  // A `{`, and the declaration it's the body of, if any.
+  struct Frame {
+    i64 declaration;
+    // parentheses and square brackets open inside of it
+    u64 nesting = 0;
+  };
+  struct Flat {
+    Declaration declaration;
+    i64 parent;
+  };
+
+  bool is(u64 index, TokenKind kind) const noexcept {
+    return index < m_tokens.size() && m_tokens[index].kind == kind;
+  }
+  u64 skip_modifiers(u64 index, bool *is_extern, bool *is_comptime) const;
+  std::optional<Header> header(u64 index) const;
+  // The name of the field starting at `index`, if one does.
+  std::optional<u64> field(u64 index) const;
+  // Whether `index` starts a member of the innermost body.
+  bool starts_member(u64 index) const;
+  std::optional<DeclarationKind> container() const noexcept;
+
+  i64 add(DeclarationKind kind, bool is_extern, u64 first, u64 name);
+  // Each returns where parsing goes on.
+  u64 declaration(Header const &header);
+  u64 expression_body(i64 declaration, u64 index);
+  u64 field(u64 index, u64 name);
+  u64 variant(u64 index);
+
+  std::span<Token const> m_tokens;
+  u64 m_size;
+  Spelling m_spelling;
+  std::vector<Frame> m_frames;
+  std::vector<Flat> m_flat;
+};
+
+u64 Parser::skip_modifiers(u64 index, bool *is_extern,
+                           bool *is_comptime) const {
+  while (is(index, TokenKind::Keyword) &&
+         is_modifier(m_tokens[index].keyword)) {
+    auto const keyword = m_tokens[index].keyword;
+    if (is_extern && keyword == Keyword::Extern)
+      *is_extern = true;
+    if (is_comptime && keyword == Keyword::Comptime)
+      *is_comptime = true;
+    ++index;
+    // restricted(A, B)
+    if (keyword == Keyword::Restricted && is(index, TokenKind::OpenParen)) {
+      while (index < m_tokens.size() &&
+             m_tokens[index].kind != TokenKind::CloseParen)
+        ++index;
+      ++index;
+    }
+  }
+  return index;
+}
+
+auto Parser::header(u64 index) const -> std::optional<Header> {
+  auto const &first = m_tokens[index];
+  if (first.kind != TokenKind::Keyword)
+    return std::nullopt;
+
+  bool is_extern = false, is_comptime = false;
+  auto const keyword = skip_modifiers(index, &is_extern, &is_comptime);
+  if (keyword >= m_tokens.size())
+    return std::nullopt;
+
+  // comptime functions have no `fn`.
+  if (is_comptime && is(keyword, TokenKind::Identifier))
+    return Header{DeclarationKind::Function, is_extern, index, keyword};
+
+  if (m_tokens[keyword].kind != TokenKind::Keyword)
+    return std::nullopt;
+  auto const kind = declaration_kind(m_tokens[keyword].keyword);
+  // `fn` without a name is a function type or an anonymous function.
+  if (!kind || !is(keyword + 1, TokenKind::Identifier))
+    return std::nullopt;
+  return Header{*kind, is_extern, index, keyword + 1};
+}
+
+std::optional<u64> Parser::field(u64 index) const {
+  auto const name = skip_modifiers(index, nullptr, nullptr);
+  if (!is(name, TokenKind::Identifier) || !is(name + 1, TokenKind::Colon))
+    return std::nullopt;
+  return name;
+}
+
+std::optional<DeclarationKind> Parser::container() const noexcept {
+  if (m_frames.empty() || m_frames.back().declaration < 0)
+    return std::nullopt;
+  return m_flat[m_frames.back().declaration].declaration.kind;
+}
+
+bool Parser::starts_member(u64 index) const {
+  if (header(index))
+    return true;
+  auto const kind = container();
+  return (kind == DeclarationKind::Struct || kind == DeclarationKind::Class) &&
+         field(index);
+}
+
+i64 Parser::add(DeclarationKind kind, bool is_extern, u64 first, u64 name) {
+  // the innermost declaration whose body we're in.
+  i64 parent = -1;
+  for (auto frame = m_frames.rbegin(); frame != m_frames.rend(); ++frame) {
+    if (frame->declaration >= 0) {
+      parent = frame->declaration;
+      break;
+    }
+  }
+  auto const &name_token = m_tokens[name];
+  m_flat.push_back(
+      {Declaration{kind, is_extern,
+                   m_spelling(name_token.start, name_token.length),
+                   m_tokens[first].start, name_token.end(), name_token.start,
+                   name_token.end(), {}},
+       parent});
+  return static_cast<i64>(m_flat.size() - 1);
+}
+
+u64 Parser::declaration(Header const &header) {
+  auto const declaration =
+      add(header.kind, header.is_extern, header.first, header.name);
+
+  // the rest of the header, up to the body. Without a body, the
+  // declaration ends before whatever comes next.
+  u64 nesting = 0;
+  auto index = header.name + 1;
+  for (; index < m_tokens.size(); ++index) {
+    auto const kind = m_tokens[index].kind;
+    if (kind == TokenKind::OpenBrace) {
+      m_frames.push_back({declaration});
+      return index + 1;
+    }
+    if (kind == TokenKind::FatArrow && nesting == 0 &&
+        header.kind == DeclarationKind::Function)
+      return expression_body(declaration, index + 1);
+    // brackets left open in the header don't hold a closing brace.
+    if (kind == TokenKind::CloseBrace || starts_member(index))
+      break;
+    if (kind == TokenKind::OpenParen || kind == TokenKind::OpenBracket)
+      ++nesting;
+    else if (nesting != 0 && (kind == TokenKind::CloseParen ||
+                              kind == TokenKind::CloseBracket))
+      --nesting;
+  }
+  m_flat[declaration].declaration.end = m_tokens[index - 1].end();
+  return index;
+}
+
+u64 Parser::expression_body(i64 declaration, u64 index) {
+  u64 nesting = 0;
+  for (; index < m_tokens.size(); ++index) {
+    auto const kind = m_tokens[index].kind;
+    if (nesting == 0 &&
+        (kind == TokenKind::CloseBrace || starts_member(index)))
+      break;
+    if (is_opening(kind))
+      ++nesting;
+    else if (nesting != 0 && is_closing(kind))
+      --nesting;
+  }
+  m_flat[declaration].declaration.end = m_tokens[index - 1].end();
+  return index;
+}
+
+u64 Parser::field(u64 index, u64 name) {
+  auto const declaration = add(DeclarationKind::Field, false, index, name);
+  // the type and default value, up to the next member.
+  u64 nesting = 0;
+  for (index = name + 2; index < m_tokens.size(); ++index) {
+    auto const kind = m_tokens[index].kind;
+    if (nesting == 0 &&
+        (kind == TokenKind::CloseBrace || kind == TokenKind::Comma ||
+         starts_member(index)))
+      break;
+    if (is_opening(kind))
+      ++nesting;
+    else if (nesting != 0 && is_closing(kind))
+      --nesting;
+  }
+  m_flat[declaration].declaration.end = m_tokens[index - 1].end();
+  return index;
+}
+
+u64 Parser::variant(u64 index) {
+  auto const declaration = add(DeclarationKind::Variant, false, index, index);
+  // Variant(field: Type, ...)
+  if (is(index + 1, TokenKind::OpenParen)) {
+    u64 nesting = 0;
+    for (auto next = index + 1; next < m_tokens.size(); ++next) {
+      auto const kind = m_tokens[next].kind;
+      if (kind == TokenKind::OpenParen)
+        ++nesting;
+      else if (kind == TokenKind::CloseParen && --nesting == 0) {
+        m_flat[declaration].declaration.end = m_tokens[next].end();
+        return next + 1;
+      } else if (kind == TokenKind::CloseBrace || starts_member(next)) {
+        m_flat[declaration].declaration.end = m_tokens[next - 1].end();
+        return next;
+      }
+    }
+    m_flat[declaration].declaration.end = m_size;
+    return m_tokens.size();
+  }
+  return index + 1;
+}
+
+Outline Parser::run() {
+  for (u64 index = 0; index < m_tokens.size();) {
+    auto const &token = m_tokens[index];
+    if (token.kind == TokenKind::OpenBrace) {
+      m_frames.push_back({-1});
+      ++index;
+      continue;
+    }
+    if (token.kind == TokenKind::CloseBrace) {
+      if (!m_frames.empty()) {
+        if (auto const declaration = m_frames.back().declaration;
+            declaration >= 0)
+          m_flat[declaration].declaration.end = token.end();
+        m_frames.pop_back();
+      }
+      ++index;
+      continue;
+    }
+    if (auto const found = header(index)) {
+      index = declaration(*found);
+      continue;
+    }
+
+    auto const kind = container();
+    auto const nesting = m_frames.empty() ? 0 : m_frames.back().nesting;
+    if (nesting == 0 &&
+        (kind == DeclarationKind::Struct || kind == DeclarationKind::Class)) {
+      if (auto const name = field(index)) {
+        index = field(index, *name);
+        continue;
+      }
+    }
+    // variants are the names that aren't part of an expression, such as the
+    // value of a previous variant.
+    if (nesting == 0 && kind == DeclarationKind::Enum &&
+        token.kind == TokenKind::Identifier && index > 0 &&
+        m_tokens[index - 1].kind != TokenKind::Operator &&
+        m_tokens[index - 1].kind != TokenKind::ColonColon &&
+        m_tokens[index - 1].kind != TokenKind::Dot &&
+        m_tokens[index - 1].kind != TokenKind::Colon &&
+        !is(index + 1, TokenKind::ColonColon) &&
+        !is(index + 1, TokenKind::Dot)) {
+      index = variant(index);
+      continue;
+    }
+
+    if (!m_frames.empty()) {
+      if (token.kind == TokenKind::OpenParen ||
+          token.kind == TokenKind::OpenBracket)
+        ++m_frames.back().nesting;
+      else if (nesting != 0 && (token.kind == TokenKind::CloseParen ||
+                                token.kind == TokenKind::CloseBracket))
+        --m_frames.back().nesting;
+    }
+    ++index;
+  }
+  // bodies left open end with the text.
+  for (auto const &frame : m_frames)
+    if (frame.declaration >= 0)
+      m_flat[frame.declaration].declaration.end = m_size;
+
+  // declarations were added in order of their start, so going backwards
+  // every one is complete before it moves into its parent, and siblings come
+  // in reverse.
+  Outline outline;
+  for (auto flat = m_flat.rbegin(); flat != m_flat.rend(); ++flat) {
+    auto &children = flat->declaration.children;
+    std::reverse(children.begin(), children.end());
+    auto &siblings = flat->parent < 0
+                         ? outline.declarations
+                         : m_flat[flat->parent].declaration.children;
+    siblings.push_back(std::move(flat->declaration));
+  }
+  std::reverse(outline.declarations.begin(), outline.declarations.end());
+  outline.brackets = match_brackets(m_tokens);
+  return outline;
+}
+} // namespace
+
+Outline outline(documents::Rope const &text, Tokens const &tokens) {
+  std::vector<Token> all;
+  all.reserve(tokens.size());
+  tokens.visit(0, text.size(), [&](Token const &token) {
+    all.push_back(token);
+    return true;
+  });
+  return Parser(all, text.size(), [&](u64 start, u64 length) {
+           return text.substr(start, length);
+         }).run();
+}
+
+Outline outline(std::string_view text, std::span<Token const> tokens) {
+  return Parser(tokens, text.size(), [&](u64 start, u64 length) {
+           return std::string(text.substr(start, length));
+         }).run();
+}
+
+std::vector<bool> matched_brackets(std::span<Token const> tokens) {
+  std::vector<bool> matched(tokens.size());
+  pair_brackets(tokens, [&](u64 open, u64 close) {
+    matched[open] = matched[close] = true;
+  });
+  return matched;
+}
+
+} // namespace syntax
@@ -0,0 +1,64 @@
+#pragma once
+#include <documents/rope.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <syntax/tokens.h>
+#include <vector>
+
+namespace syntax {
+
+enum class DeclarationKind : u8 {
+  Function,
+  Struct,
+  Class,
+  Enum,
+  Namespace,
+  Trait,
+  // of a struct or class
+  Field,
+  // of an enum
+  Variant,
+};
+
+struct Declaration {
+  DeclarationKind kind;
+  bool is_extern;
+  std::string name;
+  // byte offsets of the whole declaration, from its first modifier to the
+  // end of its body
+  u64 start, end;
+  // of its name
+  u64 name_start, name_end;
+  std::vector<Declaration> children;
+};
+
+// A pair of matching brackets, by offset of the opening and closing ones.
+struct Bracket {
+  u64 open;
+  u64 close;
+};
+
+struct Outline {
+  std::vector<Declaration> declarations;
+  // in order of their opening bracket; unmatched brackets are left out.
+  std::vector<Bracket> brackets;
+};
+
+// Finds the declarations of a document from its tokens alone, without
+// resolving or checking anything, so that it works on code that doesn't
+// compile.
+//
+// The parser only knows declaration headers and bracket nesting, and
+// recovers from errors by letting any declaration keyword (or a closing
+// brace) end the declaration it is in the header of. Bodies that are never
+// closed end with the text.
+Outline outline(documents::Rope const &text, Tokens const &tokens);
+// The same for text lexed once with `lex`.
+Outline outline(std::string_view text, std::span<Token const> tokens);
+
+// Whether each of `tokens` is a bracket that matches another, as brackets
+// of the outline do.
+std::vector<bool> matched_brackets(std::span<Token const> tokens);
+
+} // namespace syntax
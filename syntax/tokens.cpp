@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <syntax/tokens.h>
+
+namespace syntax {
+
+Tokens::Tokens(documents::Rope const &text) {
+  std::vector<Token> tokens;
+  Lexer lexer(text, 0);
+  while (auto token = lexer.next())
+    tokens.push_back(*token);
+  pack(tokens, m_blocks);
+  m_count = tokens.size();
+}
+
+void Tokens::pack(std::vector<Token> const &tokens,
+                  std::vector<Block> &blocks) {
+  for (u64 first = 0; first < tokens.size(); first += BLOCK_SIZE) {
+    auto const last = std::min<u64>(first + BLOCK_SIZE, tokens.size());
+    auto const start = tokens[first].start;
+    auto packed = std::make_shared<std::vector<Packed>>();
+    packed->reserve(last - first);
+    for (auto i = first; i != last; ++i)
+      packed->push_back({static_cast<u32>(tokens[i].start - start),
+                         tokens[i].length, tokens[i].kind, tokens[i].keyword});
+    blocks.push_back({start, std::move(packed)});
+  }
+}
+
+auto Tokens::find(u64 offset) const noexcept -> Location {
+  auto const block = std::partition_point(
+      m_blocks.begin(), m_blocks.end(),
+      [&](Block const &block) { return block.end() <= offset; });
+  if (block == m_blocks.end())
+    return {m_blocks.size(), 0};
+
+  auto const &tokens = *block->tokens;
+  auto const token = std::partition_point(
+      tokens.begin(), tokens.end(), [&](Packed const &packed) {
+        return block->start + packed.start + packed.length <= offset;
+      });
+  return {static_cast<u64>(block - m_blocks.begin()),
+          static_cast<u64>(token - tokens.begin())};
+}
+
+std::optional<Token> Tokens::at(u64 offset) const noexcept {
+  auto const [block, index] = find(offset);
+  if (block == m_blocks.size())
+    return std::nullopt;
+  auto const token = m_blocks[block].token(index);
+  if (token.start > offset)
+    return std::nullopt;
+  return token;
+}
+
+void Tokens::edit(documents::Rope const &text, u64 offset, u64 removed,
+                  u64 inserted) {
+  // the first token that may have looked at the edited bytes, and the end of
+  // the one before it, where lexing starts over.
+  auto const first =
+      find(offset > Lexer::LOOKAHEAD ? offset - Lexer::LOOKAHEAD : 0);
+  std::vector<Token> tokens;
+  u64 restart = 0;
+  if (first.block < m_blocks.size()) {
+    auto const &block = m_blocks[first.block];
+    for (u64 i = 0; i != first.index; ++i)
+      tokens.push_back(block.token(i));
+  }
+  if (!tokens.empty())
+    restart = tokens.back().end();
+  else if (first.block != 0)
+    restart = m_blocks[first.block - 1].end();
+
+  // walks the old tokens along the new ones, to find where they line up.
+  auto old = first;
+  auto const old_start = [&] {
+    return m_blocks[old.block].token(old.index).start;
+  };
+  auto const advance = [&] {
+    if (++old.index == m_blocks[old.block].tokens->size()) {
+      ++old.block;
+      old.index = 0;
+    }
+  };
+
+  bool synced = false;
+  Lexer lexer(text, restart);
+  while (auto token = lexer.next()) {
+    if (token->start >= offset + inserted) {
+      auto const before = token->start - inserted + removed;
+      while (old.block < m_blocks.size() && old_start() < before)
+        advance();
+      if (old.block < m_blocks.size() && old_start() == before) {
+        synced = true;
+        break;
+      }
+    }
+    tokens.push_back(*token);
+  }
+
+  std::vector<Block> blocks(m_blocks.begin(),
+                            m_blocks.begin() +
+                                std::min(first.block, m_blocks.size()));
+  u64 count = 0;
+  for (auto const &block : blocks)
+    count += block.tokens->size();
+
+  // the rest of the block the lexer synced in goes with the relexed tokens,
+  // and the following blocks are shifted whole.
+  auto const shift = [&](u64 start) { return start + inserted - removed; };
+  if (synced) {
+    auto const &block = m_blocks[old.block];
+    for (auto i = old.index; i != block.tokens->size(); ++i) {
+      auto token = block.token(i);
+      token.start = shift(token.start);
+      tokens.push_back(token);
+    }
+  }
+  pack(tokens, blocks);
+  count += tokens.size();
+  if (synced) {
+    for (auto i = old.block + 1; i < m_blocks.size(); ++i) {
+      blocks.push_back({shift(m_blocks[i].start), m_blocks[i].tokens});
+      count += m_blocks[i].tokens->size();
+    }
+  }
+
+  m_blocks = std::move(blocks);
+  m_count = count;
+}
+
+} // namespace syntax
@@ -0,0 +1,107 @@
+#pragma once
+#include <documents/rope.h>
+#include <memory>
+#include <optional>
+#include <syntax/lexer.h>
+#include <vector>
+
+namespace syntax {
+
+// The tokens of a document, kept up to date as it's edited.
+//
+// An edit relexes from the token before the first one whose lexing could
+// have seen the edited bytes, up to the first token starting where one
+// started before the edit, past the edited bytes: lexing there reads the
+// same text as before, so every token from there on is the same, only
+// shifted by the edit.
+//
+// Tokens are stored in blocks of at most `BLOCK_SIZE`, with offsets relative
+// to the start of their block. The blocks after the relexed region are
+// shared with the previous version and get their start moved, so an edit
+// costs the relexed tokens plus one step per block. Like ropes, token lists
+// are then persistent and cheap to copy.
+class Tokens {
+public:
+  static constexpr u64 BLOCK_SIZE = 512;
+
+  Tokens() noexcept = default;
+  explicit Tokens(documents::Rope const &text);
+
+  u64 size() const noexcept { return m_count; }
+
+  // Updates the tokens after `removed` bytes at `offset` were replaced with
+  // `inserted` bytes. `text` is the already edited text.
+  void edit(documents::Rope const &text, u64 offset, u64 removed,
+            u64 inserted);
+
+  // The token containing `offset`, if any.
+  std::optional<Token> at(u64 offset) const noexcept;
+
+  // Calls `visit(Token const &)` for every token overlapping
+  // [offset, offset + count), in order. Stops early if `visit` returns
+  // false.
+  template <typename Visitor>
+  void visit(u64 offset, u64 count, Visitor &&visit) const {
+    auto const end = offset + count;
+    for (auto [block, index] = find(offset); block < m_blocks.size();
+         ++block, index = 0) {
+      auto const &tokens = *m_blocks[block].tokens;
+      for (; index < tokens.size(); ++index) {
+        auto const token = m_blocks[block].token(index);
+        if (token.start >= end || !visit(token))
+          return;
+      }
+    }
+  }
+
+  // Blocks are shared with the versions an edit derived this one from, for
+  // as long as no edit relexes them: what's derived from the tokens of a
+  // block alone, relative to its start, can be kept by its id meanwhile.
+  u64 blocks() const noexcept { return m_blocks.size(); }
+  u64 block_start(u64 block) const noexcept { return m_blocks[block].start; }
+  std::shared_ptr<void const> block_id(u64 block) const noexcept {
+    return m_blocks[block].tokens;
+  }
+  // Calls `visit(Token const &)` for every token of `block`, in order.
+  template <typename Visitor>
+  void visit_block(u64 block, Visitor &&visit) const {
+    auto const &found = m_blocks[block];
+    for (u64 index = 0; index != found.tokens->size(); ++index)
+      visit(found.token(index));
+  }
+
+private:
+  struct Packed {
+    // relative to the start of the block
+    u32 start;
+    u32 length;
+    TokenKind kind;
+    Keyword keyword;
+  };
+  struct Block {
+    u64 start;
+    std::shared_ptr<std::vector<Packed> const> tokens;
+
+    Token token(u64 index) const noexcept {
+      auto const &packed = (*tokens)[index];
+      return {start + packed.start, packed.length, packed.kind,
+              packed.keyword};
+    }
+    u64 end() const noexcept { return token(tokens->size() - 1).end(); }
+  };
+  struct Location {
+    u64 block;
+    u64 index;
+  };
+
+  // The first token ending after `offset`, or past the last block if none.
+  Location find(u64 offset) const noexcept;
+  // Appends `tokens` to `blocks`, packed.
+  static void pack(std::vector<Token> const &tokens,
+                   std::vector<Block> &blocks);
+
+  std::vector<Block> m_blocks;
+  u64 m_count = 0;
+};
+
+} // namespace syntax
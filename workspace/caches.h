@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include <workspace/file_ids.h>
+
+namespace workspace {
+
+// https://microsoft.github.io/language-server-protocol/specifications/lsp/3.17/specification/#fileChangeType
+enum class ChangeKind { Created = 1, Changed = 2, Deleted = 3 };
+
+struct FileChange {
+  std::filesystem::path path;
+  ChangeKind kind;
+};
+
+// Something holding results derived from files of the workspace (compiler
+// outputs, symbols, import edges...), which must go when the files change.
+class FileCache {
+public:
+  virtual ~FileCache() = default;
+  // Drops whatever was derived from `file`.
+  virtual void invalidate(FileId file) noexcept = 0;
+  // Drops everything, for when changes were lost.
+  virtual void invalidate_all() noexcept = 0;
+};
+
+// Caches of the server, to tell them about file changes. Caches are owned
+// elsewhere and must outlive this.
+class Caches {
+  std::vector<FileCache *> m_caches;
+
+public:
+  void add(FileCache &cache) { m_caches.push_back(&cache); }
+
+  void invalidate(FileId file) noexcept {
+    for (auto const cache : m_caches)
+      cache->invalidate(file);
+  }
+  void invalidate_all() noexcept {
+    for (auto const cache : m_caches)
+      cache->invalidate_all();
+  }
+};
+
+// Where what's kept across sessions goes: $XDG_CACHE_HOME/jakt-lsp, or
+// ~/.cache/jakt-lsp. Nothing if neither is set.
+inline std::optional<std::filesystem::path> cache_directory() {
+  if (auto const cache = std::getenv("XDG_CACHE_HOME"); cache && *cache)
+    return std::filesystem::path(cache) / "jakt-lsp";
+  if (auto const home = std::getenv("HOME"); home && *home)
+    return std::filesystem::path(home) / ".cache" / "jakt-lsp";
+  return std::nullopt;
+}
+
+} // namespace workspace
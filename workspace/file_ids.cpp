@@ -0,0 +1,72 @@
+#include <mutex>
+#include <workspace/file_ids.h>
+#include <workspace/uri.h>
+
+namespace workspace {
+
+FileIds::~FileIds() {
+  for (auto &block : m_blocks)
+    delete[] block.load(std::memory_order_relaxed);
+}
+
+json::string FileIds::key_of(std::u16string_view uri) {
+  if (auto const path = path_of(uri); path)
+    return uri_of(*path);
+  return json::string(uri);
+}
+
+FileId FileIds::intern(std::u16string_view uri) {
+  return intern_key(key_of(uri), uri);
+}
+
+FileId FileIds::intern_path(std::filesystem::path const &path) {
+  auto uri = uri_of(path);
+  return intern_key(uri, uri);
+}
+
+std::optional<FileId> FileIds::find(std::u16string_view uri) const {
+  auto const key = key_of(uri);
+  std::shared_lock lock(m_mutex);
+  auto const found = m_ids.find(key);
+  if (found == m_ids.end())
+    return std::nullopt;
+  return found->second;
+}
+
+std::optional<FileId>
+FileIds::find_path(std::filesystem::path const &path) const {
+  return find(uri_of(path));
+}
+
+FileId FileIds::intern_key(json::string key, std::u16string_view uri) {
+  {
+    std::shared_lock lock(m_mutex);
+    if (auto const found = m_ids.find(key); found != m_ids.end())
+      return found->second;
+  }
+
+  std::unique_lock lock(m_mutex);
+  if (auto const found = m_ids.find(key); found != m_ids.end())
+    return found->second;
+
+  auto const index = static_cast<u32>(m_ids.size());
+  auto const [block, offset] = slot_of(index);
+  auto entries = m_blocks[block].load(std::memory_order_relaxed);
+  if (!entries) {
+    entries = new Entry[FIRST_BLOCK << block];
+    m_blocks[block].store(entries, std::memory_order_release);
+  }
+  // nobody reads this entry until its id is handed out, which happens after
+  // the lock (and its release) is done.
+  entries[offset] = Entry{json::string(uri), path_of(uri)};
+  auto const id = static_cast<FileId>(index);
+  m_ids.emplace(std::move(key), id);
+  return id;
+}
+
+FileIds &file_ids() noexcept {
+  static FileIds ids;
+  return ids;
+}
+
+} // namespace workspace
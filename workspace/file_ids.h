@@ -0,0 +1,79 @@
+#pragma once
+#include "json.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace workspace {
+
+// Compact name for a document URI. Internal structures (locations, index
+// postings, cache keys) use these, and URIs are only written back when
+// serializing to the client.
+enum class FileId : u32 {};
+
+// Interns document URIs into `FileId`s, for the whole process.
+//
+// Going from an id to its URI never locks: entries live in blocks that never
+// move (each twice as big as the previous one), and are published before
+// their id is handed out. Going from a URI to its id takes a shared lock, and
+// interning a new URI an exclusive one.
+class FileIds {
+public:
+  FileIds() = default;
+  FileIds(FileIds const &) = delete;
+  FileIds &operator=(FileIds const &) = delete;
+  ~FileIds();
+
+  FileId intern(std::u16string_view uri);
+  FileId intern_path(std::filesystem::path const &path);
+  std::optional<FileId> find(std::u16string_view uri) const;
+  std::optional<FileId> find_path(std::filesystem::path const &path) const;
+
+  // As first interned.
+  json::string const &uri(FileId id) const noexcept { return entry(id).uri; }
+  // Nothing for URIs that aren't `file://`.
+  std::optional<std::filesystem::path> const &
+  path(FileId id) const noexcept {
+    return entry(id).path;
+  }
+
+private:
+  struct Entry {
+    json::string uri;
+    std::optional<std::filesystem::path> path;
+  };
+  // block `b` holds `FIRST_BLOCK << b` entries.
+  static constexpr u64 FIRST_BLOCK = 256;
+  static constexpr u32 MAX_BLOCKS = 25;
+
+  struct Slot {
+    u32 block;
+    u64 offset;
+  };
+  static constexpr Slot slot_of(u32 index) noexcept {
+    auto const block =
+        static_cast<u32>(std::bit_width(index / FIRST_BLOCK + 1) - 1);
+    return {block, index - FIRST_BLOCK * ((u64(1) << block) - 1)};
+  }
+  Entry const &entry(FileId id) const noexcept {
+    auto const [block, offset] = slot_of(static_cast<u32>(id));
+    return m_blocks[block].load(std::memory_order_acquire)[offset];
+  }
+  // Same URI with any percent-encoding normalized, so that the client and
+  // the file watcher spelling a path differently still get the same id.
+  static json::string key_of(std::u16string_view uri);
+  FileId intern_key(json::string key, std::u16string_view uri);
+
+  std::array<std::atomic<Entry *>, MAX_BLOCKS> m_blocks{};
+  mutable std::shared_mutex m_mutex;
+  std::unordered_map<json::string, FileId> m_ids;
+};
+
+FileIds &file_ids() noexcept;
+
+} // namespace workspace
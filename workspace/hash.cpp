@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstring>
+#include <workspace/hash.h>
+
+namespace workspace {
+
+namespace {
+constexpr u64 SEED = 0x9e3779b97f4a7c15;
+constexpr u64 MULTIPLIER = 0xff51afd7ed558ccd;
+
+u64 mix(u64 hash, u64 word) noexcept {
+  hash ^= word;
+  hash *= MULTIPLIER;
+  return hash ^ (hash >> 32);
+}
+
+// Mixes the 32 bytes at `data` in `lanes`.
+void mix_block(u64 (&lanes)[4], char const *data) noexcept {
+  for (u64 lane = 0; lane != 4; ++lane) {
+    u64 word;
+    std::memcpy(&word, data + lane * 8, 8);
+    lanes[lane] = mix(lanes[lane], word);
+  }
+}
+} // namespace
+
+u64 hash_bytes(std::string_view bytes) noexcept {
+  Hasher hasher;
+  hasher.add(bytes);
+  return hasher.finish();
+}
+
+Hasher::Hasher() noexcept : m_lanes{SEED, SEED + 1, SEED + 2, SEED + 3} {}
+
+void Hasher::add(std::string_view bytes) noexcept {
+  m_size += bytes.size();
+  if (m_pending_size != 0) {
+    auto const taken = std::min<u64>(32 - m_pending_size, bytes.size());
+    std::memcpy(m_pending + m_pending_size, bytes.data(), taken);
+    m_pending_size += taken;
+    bytes.remove_prefix(taken);
+    if (m_pending_size != 32)
+      return;
+    mix_block(m_lanes, m_pending);
+    m_pending_size = 0;
+  }
+  // four independent lanes, so that the multiplications overlap.
+  for (; bytes.size() >= 32; bytes.remove_prefix(32))
+    mix_block(m_lanes, bytes.data());
+  std::memcpy(m_pending, bytes.data(), bytes.size());
+  m_pending_size = bytes.size();
+}
+
+u64 Hasher::finish() const noexcept {
+  auto hash = mix(mix(m_lanes[0], m_lanes[1]), mix(m_lanes[2], m_lanes[3]));
+  u64 i = 0;
+  for (; i + 8 <= m_pending_size; i += 8) {
+    u64 word;
+    std::memcpy(&word, m_pending + i, 8);
+    hash = mix(hash, word);
+  }
+  u64 tail = 0;
+  if (i != m_pending_size)
+    std::memcpy(&tail, m_pending + i, m_pending_size - i);
+  hash = mix(hash, tail);
+  return mix(hash, m_size);
+}
+
+} // namespace workspace
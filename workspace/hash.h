@@ -0,0 +1,29 @@
+#pragma once
+#include "numbers.h"
+#include <string_view>
+
+namespace workspace {
+
+// A 64-bit hash of file contents, to tell whether they changed. Not meant to
+// resist anyone crafting collisions, only to be fast over large files.
+u64 hash_bytes(std::string_view bytes) noexcept;
+
+// The same hash over bytes given in pieces, such as the chunks of a rope,
+// whatever their sizes.
+class Hasher {
+public:
+  Hasher() noexcept;
+
+  void add(std::string_view bytes) noexcept;
+  u64 finish() const noexcept;
+
+private:
+  // lanes of 8 bytes each, mixed in turn with every 32 bytes
+  u64 m_lanes[4];
+  // bytes short of 32 since the last mix
+  char m_pending[32];
+  u64 m_pending_size = 0;
+  u64 m_size = 0;
+};
+
+} // namespace workspace
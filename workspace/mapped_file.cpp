@@ -0,0 +1,140 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <workspace/mapped_file.h>
+
+namespace workspace {
+
+std::optional<MappedFile> MappedFile::open(std::filesystem::path const &path,
+                                           Access access) {
+  auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return std::nullopt;
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(fd);
+    return std::nullopt;
+  }
+  // empty files can't be mapped, but there's nothing to map anyway.
+  if (info.st_size == 0) {
+    ::close(fd);
+    return MappedFile(nullptr, 0);
+  }
+
+  auto const size = static_cast<u64>(info.st_size);
+  auto const address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file.
+  ::close(fd);
+  if (address == MAP_FAILED)
+    return std::nullopt;
+  ::madvise(address, size,
+            access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  return MappedFile(static_cast<char const *>(address), size);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (m_data)
+    ::munmap(const_cast<char *>(m_data), m_size);
+}
+
+namespace {
+thread_local TruncationGuard *t_guard = nullptr;
+struct sigaction g_previous_handler;
+} // namespace
+
+// SIGBUS is raised in the thread reading, so the fault is in the file of its
+// innermost guard if anywhere. The page is replaced with one of zeros, then
+// the read starts over.
+struct TruncationHandler {
+  static void handle(int signal, siginfo_t *info, void *context) {
+    auto const address = static_cast<char const *>(info->si_addr);
+    for (auto guard = t_guard; guard; guard = guard->m_previous) {
+      if (address < guard->m_start ||
+          address >= guard->m_start + guard->m_size)
+        continue;
+      auto const page_size = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+      auto const page = reinterpret_cast<uintptr_t>(address) & ~(page_size - 1);
+      auto const saved_errno = errno;
+      auto const zeros =
+          ::mmap(reinterpret_cast<void *>(page), page_size, PROT_READ,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+      errno = saved_errno;
+      if (zeros == MAP_FAILED)
+        break;
+      guard->m_truncated = true;
+      return;
+    }
+    // not ours: as if nothing handled it.
+    if (g_previous_handler.sa_flags & SA_SIGINFO) {
+      g_previous_handler.sa_sigaction(signal, info, context);
+      return;
+    }
+    if (g_previous_handler.sa_handler != SIG_DFL &&
+        g_previous_handler.sa_handler != SIG_IGN) {
+      g_previous_handler.sa_handler(signal);
+      return;
+    }
+    ::signal(signal, SIG_DFL);
+  }
+
+  static void install() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+      struct sigaction action = {};
+      action.sa_sigaction = handle;
+      action.sa_flags = SA_SIGINFO;
+      sigemptyset(&action.sa_mask);
+      ::sigaction(SIGBUS, &action, &g_previous_handler);
+    });
+  }
+};
+
+TruncationGuard::TruncationGuard(MappedFile const &file) noexcept
+    : m_previous(t_guard), m_start(file.bytes().data()),
+      m_size(file.bytes().size()) {
+  TruncationHandler::install();
+  t_guard = this;
+}
+
+TruncationGuard::~TruncationGuard() { t_guard = m_previous; }
+
+bool TruncationGuard::truncated() const noexcept { return m_truncated != 0; }
+
+std::optional<std::string> read_file(std::filesystem::path const &path) {
+  auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return std::nullopt;
+  std::string bytes;
+  char buffer[64 * 1024];
+  for (;;) {
+    auto const count = ::read(fd, buffer, sizeof buffer);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0) {
+      ::close(fd);
+      return std::nullopt;
+    }
+    if (count == 0)
+      break;
+    bytes.append(buffer, static_cast<u64>(count));
+  }
+  ::close(fd);
+  return bytes;
+}
+
+} // namespace workspace
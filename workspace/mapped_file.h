@@ -0,0 +1,83 @@
+#pragma once
+#include "numbers.h"
+#include <csignal>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace workspace {
+
+// Read-only view of the bytes of a file the client hasn't opened. Files are
+// mapped instead of read, and analysed in place as UTF-8, so they only take
+// memory while being looked at and the kernel can drop their pages at will.
+class MappedFile {
+  char const *m_data = nullptr;
+  u64 m_size = 0;
+
+  constexpr MappedFile(char const *data, u64 size) noexcept
+      : m_data(data), m_size(size) {}
+
+public:
+  // How the file will be read, for the kernel to read ahead or not.
+  enum class Access { Sequential, Random };
+
+  // Maps the whole file.
+  static std::optional<MappedFile>
+  open(std::filesystem::path const &path, Access access = Access::Sequential);
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  std::string_view bytes() const noexcept { return {m_data, m_size}; }
+};
+
+// Reading a mapped file that shrinks past the page read raises SIGBUS. While
+// a guard is alive, such pages of its file read as zeros instead, and the
+// guard tells.
+class TruncationGuard {
+public:
+  explicit TruncationGuard(MappedFile const &file) noexcept;
+  ~TruncationGuard();
+  TruncationGuard(TruncationGuard const &) = delete;
+  TruncationGuard &operator=(TruncationGuard const &) = delete;
+
+  bool truncated() const noexcept;
+
+private:
+  // the guard of the same thread it replaced, if any
+  TruncationGuard *m_previous;
+  char const *m_start;
+  u64 m_size;
+  // set by the signal handler
+  std::sig_atomic_t volatile m_truncated = 0;
+
+  friend struct TruncationHandler;
+};
+
+// The whole file, read rather than mapped.
+std::optional<std::string> read_file(std::filesystem::path const &path);
+
+// Maps `path` for the duration of `visit(std::string_view)` only, returning
+// its result, or nothing if the file couldn't be mapped. A file truncated
+// meanwhile is visited again, read this time.
+template <typename Visitor>
+auto with_mapped_file(std::filesystem::path const &path, Visitor &&visit)
+    -> std::optional<decltype(visit(std::string_view{}))> {
+  auto const file = MappedFile::open(path);
+  if (!file)
+    return std::nullopt;
+  {
+    TruncationGuard guard(*file);
+    auto result = visit(file->bytes());
+    if (!guard.truncated())
+      return result;
+  }
+  auto const bytes = read_file(path);
+  if (!bytes)
+    return std::nullopt;
+  return visit(std::string_view(*bytes));
+}
+
+} // namespace workspace
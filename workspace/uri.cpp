@@ -0,0 +1,60 @@
+#include <workspace/uri.h>
+
+namespace workspace {
+
+static constexpr std::u16string_view file_scheme = u"file://";
+
+static std::optional<u8> from_hex(char c) noexcept {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return std::nullopt;
+}
+
+std::optional<std::filesystem::path> path_of(std::u16string_view uri) {
+  if (!uri.starts_with(file_scheme))
+    return std::nullopt;
+  uri.remove_prefix(file_scheme.size());
+
+  // escapes encode UTF-8 bytes, so undo them after converting the rest.
+  auto const encoded = json::to_utf8(uri);
+  std::string path;
+  path.reserve(encoded.size());
+  for (u64 i = 0; i != encoded.size(); ++i) {
+    if (encoded[i] == '%' && i + 2 < encoded.size()) {
+      auto const high = from_hex(encoded[i + 1]);
+      auto const low = from_hex(encoded[i + 2]);
+      if (high && low) {
+        path.push_back(static_cast<char>(*high << 4 | *low));
+        i += 2;
+        continue;
+      }
+    }
+    path.push_back(encoded[i]);
+  }
+  return std::filesystem::path(path);
+}
+
+json::string uri_of(std::filesystem::path const &path) {
+  static constexpr char hex[] = "0123456789ABCDEF";
+  json::string uri(file_scheme);
+  for (auto const c : path.generic_string()) {
+    auto const byte = static_cast<u8>(c);
+    // RFC 3986 unreserved characters, plus the path separator.
+    if ((byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') ||
+        (byte >= '0' && byte <= '9') || byte == '-' || byte == '.' ||
+        byte == '_' || byte == '~' || byte == '/') {
+      uri.push_back(byte);
+    } else {
+      uri.push_back('%');
+      uri.push_back(hex[byte >> 4]);
+      uri.push_back(hex[byte & 0xf]);
+    }
+  }
+  return uri;
+}
+
+} // namespace workspace
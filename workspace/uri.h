@@ -0,0 +1,14 @@
+#pragma once
+#include "json.h"
+#include <filesystem>
+#include <optional>
+
+namespace workspace {
+
+// Path of a `file://` URI, with its percent-encoding undone. Other schemes
+// have no path.
+std::optional<std::filesystem::path> path_of(std::u16string_view uri);
+// `file://` URI of an absolute path.
+json::string uri_of(std::filesystem::path const &path);
+
+} // namespace workspace
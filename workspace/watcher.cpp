@@ -0,0 +1,182 @@
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <workspace/watcher.h>
+
+namespace workspace {
+
+namespace fs = std::filesystem;
+
+static constexpr u32 WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE |
+                                  IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+static bool is_hidden(fs::path const &path) {
+  auto const name = path.filename().native();
+  return !name.empty() && name[0] == '.';
+}
+
+std::unique_ptr<Watcher> Watcher::start(std::vector<fs::path> const &roots,
+                                        Channel<Batch> &out) {
+  auto const inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify < 0)
+    return nullptr;
+  auto const wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake < 0) {
+    ::close(inotify);
+    return nullptr;
+  }
+
+  std::unique_ptr<Watcher> watcher(new Watcher(inotify, wake, out));
+  // the roots are walked from there too, which takes a while in large trees.
+  watcher->m_thread = std::jthread(
+      [watcher = watcher.get(), roots](std::stop_token stop) {
+        for (auto const &root : roots)
+          if (!stop.stop_requested())
+            watcher->add_directory(root, false);
+        watcher->run(std::move(stop));
+      });
+  return watcher;
+}
+
+Watcher::~Watcher() {
+  if (m_thread.joinable()) {
+    m_thread.request_stop();
+    u64 const one = 1;
+    [[maybe_unused]] auto const written = ::write(m_wake, &one, sizeof one);
+    m_thread.join();
+  }
+  ::close(m_inotify);
+  ::close(m_wake);
+}
+
+void Watcher::run(std::stop_token stop) {
+  using clock = std::chrono::steady_clock;
+  auto batching = false;
+  clock::time_point first_event, last_event;
+
+  while (!stop.stop_requested()) {
+    // sleep until there's something to read, or the pending batch is due.
+    auto timeout = -1;
+    if (batching) {
+      auto const due =
+          std::min(last_event + QUIET_PERIOD, first_event + MAX_DELAY);
+      timeout = static_cast<int>(std::max<i64>(
+          0, std::chrono::ceil<std::chrono::milliseconds>(due - clock::now())
+                 .count()));
+    }
+    pollfd fds[] = {{m_inotify, POLLIN, 0}, {m_wake, POLLIN, 0}};
+    if (::poll(fds, 2, timeout) < 0 && errno != EINTR)
+      return;
+
+    auto const now = clock::now();
+    if (fds[0].revents & POLLIN) {
+      read_events();
+      if (!m_pending.empty() || m_overflowed) {
+        if (!batching)
+          first_event = now;
+        batching = true;
+        last_event = now;
+      }
+    }
+    if (batching && (now - last_event >= QUIET_PERIOD ||
+                     now - first_event >= MAX_DELAY)) {
+      flush();
+      batching = false;
+    }
+  }
+}
+
+void Watcher::add_directory(fs::path const &directory, bool report_files) {
+  auto const add_watch = [&](fs::path const &path) {
+    auto const watch =
+        ::inotify_add_watch(m_inotify, path.c_str(), WATCH_MASK);
+    if (watch >= 0)
+      m_directories[watch] = path;
+  };
+
+  add_watch(directory);
+  std::error_code error;
+  fs::recursive_directory_iterator it(
+      directory, fs::directory_options::skip_permission_denied, error);
+  for (; !error && it != fs::recursive_directory_iterator();
+       it.increment(error)) {
+    auto const &entry = *it;
+    if (entry.is_symlink(error))
+      continue;
+    if (entry.is_directory(error)) {
+      if (is_hidden(entry.path()))
+        it.disable_recursion_pending();
+      else
+        add_watch(entry.path());
+    } else if (report_files) {
+      record(entry.path(), ChangeKind::Created);
+    }
+  }
+}
+
+void Watcher::read_events() {
+  alignas(inotify_event) char buffer[16 * 1024];
+  for (;;) {
+    auto const length = ::read(m_inotify, buffer, sizeof buffer);
+    if (length <= 0)
+      return;
+
+    for (auto cursor = buffer; cursor < buffer + length;) {
+      auto const event = reinterpret_cast<inotify_event const *>(cursor);
+      cursor += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        m_overflowed = true;
+        continue;
+      }
+      if (event->mask & IN_IGNORED) {
+        m_directories.erase(event->wd);
+        continue;
+      }
+      auto const directory = m_directories.find(event->wd);
+      if (directory == m_directories.end() || event->len == 0)
+        continue;
+      auto path = directory->second / event->name;
+
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          if (!is_hidden(path))
+            add_directory(path, true);
+        } else if (event->mask & IN_MOVED_FROM) {
+          // its files went away without events of their own.
+          m_overflowed = true;
+        }
+        continue;
+      }
+
+      if (event->mask & (IN_CREATE | IN_MOVED_TO))
+        record(std::move(path), ChangeKind::Created);
+      else if (event->mask & IN_CLOSE_WRITE)
+        record(std::move(path), ChangeKind::Changed);
+      else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+        record(std::move(path), ChangeKind::Deleted);
+    }
+  }
+}
+
+void Watcher::record(fs::path path, ChangeKind kind) {
+  auto [found, inserted] = m_pending.try_emplace(std::move(path), kind);
+  // a file created and then written to in the same batch is still new.
+  if (!inserted &&
+      !(found->second == ChangeKind::Created && kind == ChangeKind::Changed))
+    found->second = kind;
+}
+
+void Watcher::flush() {
+  Batch batch{{}, m_overflowed};
+  batch.changes.reserve(m_pending.size());
+  for (auto &[path, kind] : m_pending)
+    batch.changes.push_back({path, kind});
+  m_pending.clear();
+  m_overflowed = false;
+  m_out.send(std::move(batch));
+}
+
+} // namespace workspace
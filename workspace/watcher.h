@@ -0,0 +1,58 @@
+#pragma once
+#include "channel.h"
+#include "numbers.h"
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <workspace/caches.h>
+
+namespace workspace {
+
+// Watches the workspace roots for file changes through inotify, from its own
+// thread, which also walks them to begin with. Bursts of changes (a `git
+// checkout`, a build) are debounced: they are sent as one batch once no event
+// arrived for `QUIET_PERIOD`, or at most `MAX_DELAY` after the first one.
+class Watcher {
+public:
+  static constexpr std::chrono::milliseconds QUIET_PERIOD{100};
+  static constexpr std::chrono::milliseconds MAX_DELAY{1000};
+
+  struct Batch {
+    std::vector<FileChange> changes;
+    // The kernel dropped events (or a directory moved away), so any file may
+    // have changed.
+    bool overflowed;
+  };
+
+  // Returns nothing if inotify isn't available.
+  static std::unique_ptr<Watcher>
+  start(std::vector<std::filesystem::path> const &roots, Channel<Batch> &out);
+  ~Watcher();
+
+private:
+  Watcher(int inotify, int wake, Channel<Batch> &out) noexcept
+      : m_inotify(inotify), m_wake(wake), m_out(out) {}
+
+  void run(std::stop_token stop);
+  // Watches `directory` and the ones below it, skipping hidden ones. Files
+  // found are reported as created if `report_files`.
+  void add_directory(std::filesystem::path const &directory,
+                     bool report_files);
+  void read_events();
+  void record(std::filesystem::path path, ChangeKind kind);
+  void flush();
+
+  int m_inotify;
+  // written to when stopping, to wake up `run`.
+  int m_wake;
+  Channel<Batch> &m_out;
+  std::unordered_map<int, std::filesystem::path> m_directories;
+  std::map<std::filesystem::path, ChangeKind> m_pending;
+  bool m_overflowed = false;
+  std::jthread m_thread;
+};
+
+} // namespace workspace